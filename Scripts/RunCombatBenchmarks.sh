@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+# Runs the shooter combat micro benchmarks headless and writes ns/op and allocations/op to JSON.
+# Compare the JSON of two builds to spot regressions in the combat hot paths.
+#
+# Usage: Scripts/RunCombatBenchmarks.sh [Iterations] [JsonPath]
+# Set UE_EDITOR_CMD to the UnrealEditor-Cmd binary if it isn't on the PATH.
+
+set -euo pipefail
+
+ITERATIONS="${1:-1000}"
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+JSON_PATH="${2:-$PROJECT_DIR/Saved/Profiling/CombatBenchmark-$(date +%Y%m%d-%H%M%S).json}"
+UE_EDITOR_CMD="${UE_EDITOR_CMD:-UnrealEditor-Cmd}"
+PROJECT="$PROJECT_DIR/FirstPersonCity.uproject"
+MAP="/Game/Variant_Shooter/Lvl_Shooter"
+LOG_DIR="$PROJECT_DIR/Saved/Logs/CombatBenchmark"
+
+mkdir -p "$LOG_DIR" "$(dirname "$JSON_PATH")"
+
+echo "Running combat benchmarks with $ITERATIONS iterations"
+"$UE_EDITOR_CMD" "$PROJECT" "$MAP" -game -nullrhi -nosound -unattended \
+	-ExecCmds="Shooter.Bench.Combat $ITERATIONS $JSON_PATH, quit" \
+	-log -abslog="$LOG_DIR/CombatBenchmark.log"
+
+if [[ ! -f "$JSON_PATH" ]]; then
+	echo "Combat benchmarks didn't produce $JSON_PATH, see $LOG_DIR/CombatBenchmark.log" >&2
+	exit 1
+fi
+
+echo "Benchmark results written to $JSON_PATH"
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Runs the shooter network benchmark on this machine: a dedicated server plus headless bot clients over loopback.
+# The server writes per connection bandwidth, server tick time and replication time to a CSV and exits when done.
+#
+# Usage: Scripts/RunNetBenchmark.sh [NumClients] [DurationSeconds] [CsvPath]
+# Set UE_EDITOR_CMD to the UnrealEditor-Cmd binary if it isn't on the PATH.
+
+set -euo pipefail
+
+NUM_CLIENTS="${1:-8}"
+DURATION="${2:-60}"
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+CSV_PATH="${3:-$PROJECT_DIR/Saved/Profiling/NetBenchmark-$(date +%Y%m%d-%H%M%S).csv}"
+UE_EDITOR_CMD="${UE_EDITOR_CMD:-UnrealEditor-Cmd}"
+PROJECT="$PROJECT_DIR/FirstPersonCity.uproject"
+MAP="/Game/Variant_Shooter/Lvl_Shooter"
+PORT="${NET_BENCH_PORT:-7777}"
+LOG_DIR="$PROJECT_DIR/Saved/Logs/NetBenchmark"
+
+mkdir -p "$LOG_DIR" "$(dirname "$CSV_PATH")"
+
+CLIENT_PIDS=()
+
+cleanup()
+{
+	for PID in "${CLIENT_PIDS[@]}"; do
+		kill "$PID" 2>/dev/null || true
+	done
+}
+trap cleanup EXIT
+
+echo "Starting dedicated server on port $PORT for ${DURATION}s"
+"$UE_EDITOR_CMD" "$PROJECT" "$MAP" -server -nullrhi -nosound -unattended -port="$PORT" \
+	-NetBench -NetBenchDuration="$DURATION" -NetBenchCSV="$CSV_PATH" \
+	-log -abslog="$LOG_DIR/Server.log" &
+SERVER_PID=$!
+
+# give the server time to load the map before clients connect
+sleep "${NET_BENCH_SERVER_WARMUP:-15}"
+
+for ((CLIENT = 0; CLIENT < NUM_CLIENTS; ++CLIENT)); do
+	"$UE_EDITOR_CMD" "$PROJECT" "127.0.0.1:$PORT" -game -nullrhi -nosound -unattended -NetBenchBot \
+		-log -abslog="$LOG_DIR/Client$CLIENT.log" &
+	CLIENT_PIDS+=($!)
+done
+
+echo "Running $NUM_CLIENTS bot clients"
+
+# the server exits on its own once the benchmark duration has elapsed
+wait "$SERVER_PID"
+
+echo "Benchmark results written to $CSV_PATH"
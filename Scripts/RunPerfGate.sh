@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+# Runs the shooter perf gate headless: scripted firefight, explosion and pickup scenarios checked against frame budgets.
+# Exits nonzero if any scenario went over budget. Failing scenarios leave a .utrace snapshot next to the report.
+#
+# Usage: Scripts/RunPerfGate.sh [Scenarios] [CsvPath]
+#   Scenarios is a comma separated list, e.g. Firefight50,Explosions50. Runs every scenario by default
+# Set UE_EDITOR_CMD to the UnrealEditor-Cmd binary if it isn't on the PATH.
+# Set PERF_GATE_MAP to run the scenarios on a different map.
+
+set -euo pipefail
+
+SCENARIOS="${1:-}"
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+CSV_PATH="${2:-$PROJECT_DIR/Saved/Profiling/PerfGate-$(date +%Y%m%d-%H%M%S).csv}"
+UE_EDITOR_CMD="${UE_EDITOR_CMD:-UnrealEditor-Cmd}"
+PROJECT="$PROJECT_DIR/FirstPersonCity.uproject"
+MAP="${PERF_GATE_MAP:-/Game/Variant_Shooter/Lvl_Shooter}"
+LOG_DIR="$PROJECT_DIR/Saved/Logs/PerfGate"
+
+mkdir -p "$LOG_DIR" "$(dirname "$CSV_PATH")"
+
+SCENARIO_ARGS=()
+if [[ -n "$SCENARIOS" ]]; then
+	SCENARIO_ARGS+=(-PerfGateScenarios="$SCENARIOS")
+fi
+
+echo "Running perf gate on $MAP"
+
+# cpu and frame trace channels feed the snapshot written when a scenario fails
+set +e
+"$UE_EDITOR_CMD" "$PROJECT" "$MAP" -game -nullrhi -nosound -unattended \
+	-PerfGate -PerfGateReport="$CSV_PATH" ${SCENARIO_ARGS[@]+"${SCENARIO_ARGS[@]}"} \
+	-trace=cpu,frame,bookmark -log -abslog="$LOG_DIR/PerfGate.log"
+RESULT=$?
+set -e
+
+if [[ $RESULT -eq 0 ]]; then
+	echo "Perf gate passed, report written to $CSV_PATH"
+else
+	echo "Perf gate failed with code $RESULT, see $CSV_PATH and $LOG_DIR/PerfGate.log" >&2
+fi
+
+exit $RESULT
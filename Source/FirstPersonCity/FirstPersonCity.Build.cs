@@ -18,10 +18,12 @@ public class FirstPersonCity : ModuleRules
 			"StateTreeModule",
 			"GameplayStateTreeModule",
 			"UMG",
-			"Slate"
+			"Slate",
+			"NetCore",
+			"ReplicationGraph"
 		});
 
-		PrivateDependencyModuleNames.AddRange(new string[] { });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json" });
 
 		PublicIncludePaths.AddRange(new string[] {
 			"FirstPersonCity",
@@ -30,7 +32,8 @@ public class FirstPersonCity : ModuleRules
 			"FirstPersonCity/Variant_Shooter",
 			"FirstPersonCity/Variant_Shooter/AI",
 			"FirstPersonCity/Variant_Shooter/UI",
-			"FirstPersonCity/Variant_Shooter/Weapons"
+			"FirstPersonCity/Variant_Shooter/Weapons",
+			"FirstPersonCity/Variant_Shooter/Profiling"
 		});
 
 		// Uncomment if you are using Slate UI
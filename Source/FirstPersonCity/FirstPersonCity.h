@@ -3,6 +3,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 
 /** Main log category used across the project */
-DECLARE_LOG_CATEGORY_EXTERN(LogFirstPersonCity, Log, All);
\ No newline at end of file
+DECLARE_LOG_CATEGORY_EXTERN(LogFirstPersonCity, Log, All);
+
+/** Stat group for project gameplay systems. Use 'stat FirstPersonCity' to display */
+DECLARE_STATS_GROUP(TEXT("FirstPersonCity"), STATGROUP_FirstPersonCity, STATCAT_Advanced);
@@ -1,8 +1,10 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "EmotionReactActor.h"
+#include "EmotionReactionSubsystem.h"
 #include "Components/StaticMeshComponent.h"
 #include "Engine/Engine.h"
+#include "Engine/World.h"
 #include "Engine/DamageEvents.h"
 #include "GameFramework/DamageType.h"
 #include "Variant_Shooter/Weapons/CustomDamageTypes.h"
@@ -10,24 +12,45 @@
 // Sets default values
 AEmotionReactActor::AEmotionReactActor()
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Reactors never tick. The emotion subsystem updates them in a single batched pass
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Create and set up the mesh component
 	MeshComponent = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MeshComponent"));
 	RootComponent = MeshComponent;
+
+	// default emotion colors
+	EmotionColors.Add(EEmotionType::Joy, FLinearColor(1.0f, 0.85f, 0.0f));
+	EmotionColors.Add(EEmotionType::Trust, FLinearColor(0.45f, 0.85f, 0.2f));
+	EmotionColors.Add(EEmotionType::Terror, FLinearColor(0.0f, 0.5f, 0.2f));
+	EmotionColors.Add(EEmotionType::Amazing, FLinearColor(0.0f, 0.6f, 1.0f));
+	EmotionColors.Add(EEmotionType::Sadness, FLinearColor(0.1f, 0.2f, 0.9f));
+	EmotionColors.Add(EEmotionType::Loathing, FLinearColor(0.6f, 0.2f, 0.8f));
+	EmotionColors.Add(EEmotionType::Rage, FLinearColor(1.0f, 0.05f, 0.05f));
+	EmotionColors.Add(EEmotionType::Expect, FLinearColor(1.0f, 0.45f, 0.0f));
 }
 
 // Called when the game starts or when spawned
 void AEmotionReactActor::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// hand our emotional state over to the subsystem
+	if (UEmotionReactionSubsystem* EmotionSubsystem = GetWorld()->GetSubsystem<UEmotionReactionSubsystem>())
+	{
+		EmotionSubsystem->RegisterReactor(this);
+	}
 }
 
-// Called every frame
-void AEmotionReactActor::Tick(float DeltaTime)
+// Called when the actor is removed from the game
+void AEmotionReactActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (UEmotionReactionSubsystem* EmotionSubsystem = GetWorld()->GetSubsystem<UEmotionReactionSubsystem>())
+	{
+		EmotionSubsystem->UnregisterReactor(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Implementation of TakeDamage function
@@ -37,32 +60,45 @@ float AEmotionReactActor::TakeDamage(float Damage, struct FDamageEvent const& Da
 	float ActualDamage = Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 
 	// Log the damage received
-	UE_LOG(LogTemp, Warning, TEXT("%s received %.1f damage"), *GetName(), ActualDamage);
-	/*
-	// Display on screen for debugging
-	if (GEngine)
-	{
-		FString DamageMessage = FString::Printf(TEXT("%s took %.1f damage!"), *GetName(), ActualDamage);
-		GEngine->AddOnScreenDebugMessage(-1, 3.0f, FColor::Red, DamageMessage);
-	}
-	*/
-	// Check damage type and apply visual effects
+	UE_LOG(LogTemp, Verbose, TEXT("%s received %.1f damage"), *GetName(), ActualDamage);
+
+	// Check damage type and queue the reaction
 	if (DamageEvent.DamageTypeClass)
 	{
+		UEmotionReactionSubsystem* EmotionSubsystem = GetWorld()->GetSubsystem<UEmotionReactionSubsystem>();
 
-	BP_OnProjectileHit(DamageEvent.DamageTypeClass);
-
-		if (DamageEvent.DamageTypeClass->IsChildOf<UFireDamageType>())
+		if (EmotionSubsystem && EmotionReactorIndex != INDEX_NONE)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Fire damage detected!"));
-			// Add your fire visual effect here
+			// the subsystem accumulates the emotion and drives visuals in its batched update
+			EmotionSubsystem->AddReaction(this, DamageEvent.DamageTypeClass, ActualDamage);
+
+		} else {
+
+			// not managed by a subsystem, so react right away
+			BP_OnProjectileHit(DamageEvent.DamageTypeClass);
 		}
-		else
+	}
+
+	return ActualDamage;
+}
+
+void AEmotionReactActor::ApplyEmotionVisuals(EEmotionType DominantEmotion, float Intensity)
+{
+	// create the dynamic material on first use
+	if (!EmotionMaterial)
+	{
+		EmotionMaterial = MeshComponent->CreateAndSetMaterialInstanceDynamic(0);
+
+		if (!EmotionMaterial)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Other damage type: %s"), *DamageEvent.DamageTypeClass->GetName());
-			// Add other damage type handling here
+			return;
 		}
 	}
 
-	return ActualDamage;
-}
\ No newline at end of file
+	if (const FLinearColor* EmotionColor = EmotionColors.Find(DominantEmotion))
+	{
+		EmotionMaterial->SetVectorParameterValue(EmotionColorParameter, *EmotionColor);
+	}
+
+	EmotionMaterial->SetScalarParameterValue(EmotionIntensityParameter, Intensity);
+}
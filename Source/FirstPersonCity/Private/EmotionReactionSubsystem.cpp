@@ -0,0 +1,498 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EmotionReactionSubsystem.h"
+#include "EmotionReactActor.h"
+#include "Engine/World.h"
+#include "GameFramework/DamageType.h"
+#include "FirstPersonCity.h"
+
+DECLARE_CYCLE_STAT(TEXT("Emotion Reactions Update"), STAT_EmotionReactionsUpdate, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Emotion Reactors"), STAT_EmotionReactors, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Emotion Reactors Active"), STAT_EmotionReactorsActive, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Emotion Contagion Checks"), STAT_EmotionContagionChecks, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Emotion Contagion Pending"), STAT_EmotionContagionPending, STATGROUP_FirstPersonCity);
+
+bool UEmotionReactionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UEmotionReactionSubsystem::IsTickable() const
+{
+	// only update while there's something to react to
+	return ActiveReactors.Num() > 0 || HitReactors.Num() > 0 || HasPendingContagion();
+}
+
+void UEmotionReactionSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EmotionReactionsUpdate);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	// spread emotions first so this frame's visual pass picks them up
+	UpdateContagion(Time);
+
+	UpdateReactors(Time);
+
+	SET_DWORD_STAT(STAT_EmotionReactors, Reactors.Num());
+	SET_DWORD_STAT(STAT_EmotionReactorsActive, ActiveReactors.Num());
+	SET_DWORD_STAT(STAT_EmotionContagionPending, ContagionQueue.Num() - ContagionQueueHead);
+}
+
+TStatId UEmotionReactionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEmotionReactionSubsystem, STATGROUP_Tickables);
+}
+
+void UEmotionReactionSubsystem::RegisterReactor(AEmotionReactActor* Reactor)
+{
+	check(Reactor);
+
+	// ignore if already registered
+	if (Reactor->EmotionReactorIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	Reactor->EmotionReactorIndex = Reactors.Add(Reactor);
+
+	EmotionLevels.AddZeroed(EmotionTypeCount);
+	EvaluationTimes.Add(GetWorld()->GetTimeSeconds());
+	DecayRates.Add(Reactor->EmotionDecayRate);
+	EmotionPerDamage.Add(Reactor->EmotionPerDamage);
+	PendingHitTypes.AddDefaulted();
+	ReactorFlags.Add(0);
+
+	// add the reactor to the contagion grid. Reactors are expected to stay in place
+	const FVector3f Location(Reactor->GetActorLocation());
+	const FIntVector Cell = GetGridCell(Location);
+
+	ReactorLocations.Add(Location);
+	ReactorCells.Add(Cell);
+	ReactorGrid.FindOrAdd(Cell).Add(Reactor->EmotionReactorIndex);
+
+	// waves already spreading haven't reached the new reactor
+	for (TPair<uint32, FEmotionContagionWave>& Wave : ContagionWaves)
+	{
+		Wave.Value.Visited.Add(false);
+	}
+}
+
+void UEmotionReactionSubsystem::UnregisterReactor(AEmotionReactActor* Reactor)
+{
+	check(Reactor);
+
+	const int32 Index = Reactor->EmotionReactorIndex;
+
+	if (!Reactors.IsValidIndex(Index) || Reactors[Index] != Reactor)
+	{
+		return;
+	}
+
+	// drop the reactor from the work lists
+	if (ReactorFlags[Index] & ReactorFlag_Active)
+	{
+		ActiveReactors.RemoveSingleSwap(Index);
+	}
+
+	if (ReactorFlags[Index] & ReactorFlag_Hit)
+	{
+		HitReactors.RemoveSingleSwap(Index);
+	}
+
+	// drop the reactor from its grid cell
+	if (TArray<int32>* CellReactors = ReactorGrid.Find(ReactorCells[Index]))
+	{
+		CellReactors->RemoveSingleSwap(Index);
+
+		if (CellReactors->IsEmpty())
+		{
+			ReactorGrid.Remove(ReactorCells[Index]);
+		}
+	}
+
+	// move the last reactor into the freed slot to keep the arrays packed
+	const int32 LastIndex = Reactors.Num() - 1;
+
+	// fix up pending spreads from the removed and moved reactors
+	for (int32 QueueIndex = ContagionQueueHead; QueueIndex < ContagionQueue.Num(); ++QueueIndex)
+	{
+		FEmotionContagion& Contagion = ContagionQueue[QueueIndex];
+
+		if (Contagion.SourceIndex == Index)
+		{
+			Contagion.SourceIndex = INDEX_NONE;
+
+		} else if (Contagion.SourceIndex == LastIndex) {
+
+			Contagion.SourceIndex = Index;
+		}
+	}
+
+	if (Index != LastIndex)
+	{
+		Reactors[Index] = Reactors[LastIndex];
+		Reactors[Index]->EmotionReactorIndex = Index;
+
+		FMemory::Memcpy(&EmotionLevels[Index * EmotionTypeCount], &EmotionLevels[LastIndex * EmotionTypeCount], sizeof(float) * EmotionTypeCount);
+		EvaluationTimes[Index] = EvaluationTimes[LastIndex];
+		DecayRates[Index] = DecayRates[LastIndex];
+		EmotionPerDamage[Index] = EmotionPerDamage[LastIndex];
+		PendingHitTypes[Index] = PendingHitTypes[LastIndex];
+		ReactorFlags[Index] = ReactorFlags[LastIndex];
+		ReactorLocations[Index] = ReactorLocations[LastIndex];
+		ReactorCells[Index] = ReactorCells[LastIndex];
+
+		for (TPair<uint32, FEmotionContagionWave>& Wave : ContagionWaves)
+		{
+			Wave.Value.Visited[Index] = Wave.Value.Visited[LastIndex];
+		}
+
+		// point the moved reactor's grid entry at its new index
+		TArray<int32>& MovedCellReactors = ReactorGrid.FindChecked(ReactorCells[Index]);
+		MovedCellReactors[MovedCellReactors.Find(LastIndex)] = Index;
+
+		// fix up the moved reactor's work list entries
+		if (ReactorFlags[Index] & ReactorFlag_Active)
+		{
+			ActiveReactors[ActiveReactors.Find(LastIndex)] = Index;
+		}
+
+		if (ReactorFlags[Index] & ReactorFlag_Hit)
+		{
+			HitReactors[HitReactors.Find(LastIndex)] = Index;
+		}
+	}
+
+	Reactors.Pop(EAllowShrinking::No);
+	EmotionLevels.SetNum(LastIndex * EmotionTypeCount, EAllowShrinking::No);
+	EvaluationTimes.Pop(EAllowShrinking::No);
+	DecayRates.Pop(EAllowShrinking::No);
+	EmotionPerDamage.Pop(EAllowShrinking::No);
+	PendingHitTypes.Pop(EAllowShrinking::No);
+	ReactorFlags.Pop(EAllowShrinking::No);
+	ReactorLocations.Pop(EAllowShrinking::No);
+	ReactorCells.Pop(EAllowShrinking::No);
+
+	for (TPair<uint32, FEmotionContagionWave>& Wave : ContagionWaves)
+	{
+		Wave.Value.Visited.RemoveAt(LastIndex);
+	}
+
+	Reactor->EmotionReactorIndex = INDEX_NONE;
+}
+
+void UEmotionReactionSubsystem::AddReaction(AEmotionReactActor* Reactor, TSubclassOf<UDamageType> DamageTypeClass, float Damage)
+{
+	const int32 Index = Reactor->EmotionReactorIndex;
+
+	if (!Reactors.IsValidIndex(Index) || !DamageTypeClass)
+	{
+		return;
+	}
+
+	// emotional damage types raise their emotion. Other damage types only notify Blueprint
+	if (const UEmotionDamageType* EmotionDamageType = Cast<UEmotionDamageType>(DamageTypeClass->GetDefaultObject()))
+	{
+		const float Amount = Damage * EmotionPerDamage[Index];
+
+		AddEmotionByIndex(Index, EmotionDamageType->Emotion, Amount, GetWorld()->GetTimeSeconds());
+
+		// spread the emotion to nearby reactors
+		StartContagion(Index, EmotionDamageType->Emotion, Amount);
+	}
+
+	// queue a single hit notification for this update
+	PendingHitTypes[Index] = DamageTypeClass;
+
+	if (!(ReactorFlags[Index] & ReactorFlag_Hit))
+	{
+		ReactorFlags[Index] |= ReactorFlag_Hit;
+		HitReactors.Add(Index);
+	}
+}
+
+void UEmotionReactionSubsystem::AddEmotion(AEmotionReactActor* Reactor, EEmotionType Emotion, float Amount)
+{
+	if (Reactors.IsValidIndex(Reactor->EmotionReactorIndex))
+	{
+		AddEmotionByIndex(Reactor->EmotionReactorIndex, Emotion, Amount, GetWorld()->GetTimeSeconds());
+	}
+}
+
+float UEmotionReactionSubsystem::GetEmotionLevel(const AEmotionReactActor* Reactor, EEmotionType Emotion) const
+{
+	const int32 Index = Reactor->EmotionReactorIndex;
+
+	if (!Reactors.IsValidIndex(Index))
+	{
+		return 0.0f;
+	}
+
+	return EmotionLevels[Index * EmotionTypeCount + static_cast<int32>(Emotion)] * GetDecayFactor(Index, GetWorld()->GetTimeSeconds());
+}
+
+float UEmotionReactionSubsystem::GetDecayFactor(int32 ReactorIndex, double Time) const
+{
+	const float Elapsed = static_cast<float>(Time - EvaluationTimes[ReactorIndex]);
+
+	return FMath::Exp(-DecayRates[ReactorIndex] * Elapsed);
+}
+
+void UEmotionReactionSubsystem::EvaluateReactor(int32 ReactorIndex, double Time)
+{
+	const float DecayFactor = GetDecayFactor(ReactorIndex, Time);
+
+	float* Levels = &EmotionLevels[ReactorIndex * EmotionTypeCount];
+
+	for (int32 EmotionIndex = 0; EmotionIndex < EmotionTypeCount; ++EmotionIndex)
+	{
+		Levels[EmotionIndex] *= DecayFactor;
+	}
+
+	EvaluationTimes[ReactorIndex] = Time;
+}
+
+void UEmotionReactionSubsystem::AddEmotionByIndex(int32 ReactorIndex, EEmotionType Emotion, float Amount, double Time)
+{
+	if (Amount <= 0.0f)
+	{
+		return;
+	}
+
+	// bring the stored levels up to date before adding to them
+	EvaluateReactor(ReactorIndex, Time);
+
+	float& Level = EmotionLevels[ReactorIndex * EmotionTypeCount + static_cast<int32>(Emotion)];
+	Level = FMath::Min(Level + Amount, 1.0f);
+
+	// the reactor needs visual updates until it calms down
+	if (!(ReactorFlags[ReactorIndex] & ReactorFlag_Active))
+	{
+		ReactorFlags[ReactorIndex] |= ReactorFlag_Active;
+		ActiveReactors.Add(ReactorIndex);
+	}
+}
+
+void UEmotionReactionSubsystem::UpdateReactors(double Time)
+{
+	// update the visuals of every reactor with a visible emotion
+	for (int32 ActiveIndex = ActiveReactors.Num() - 1; ActiveIndex >= 0; --ActiveIndex)
+	{
+		const int32 ReactorIndex = ActiveReactors[ActiveIndex];
+		const float* Levels = &EmotionLevels[ReactorIndex * EmotionTypeCount];
+
+		// all emotions on a reactor decay at the same rate, so the dominant one can be picked from the stored levels
+		int32 DominantEmotion = 0;
+
+		for (int32 EmotionIndex = 1; EmotionIndex < EmotionTypeCount; ++EmotionIndex)
+		{
+			if (Levels[EmotionIndex] > Levels[DominantEmotion])
+			{
+				DominantEmotion = EmotionIndex;
+			}
+		}
+
+		float Intensity = Levels[DominantEmotion] * GetDecayFactor(ReactorIndex, Time);
+
+		// has the reactor calmed down?
+		if (Intensity < MinVisibleIntensity)
+		{
+			Intensity = 0.0f;
+
+			FMemory::Memzero(&EmotionLevels[ReactorIndex * EmotionTypeCount], sizeof(float) * EmotionTypeCount);
+			EvaluationTimes[ReactorIndex] = Time;
+
+			ReactorFlags[ReactorIndex] &= ~ReactorFlag_Active;
+			ActiveReactors.RemoveAtSwap(ActiveIndex, EAllowShrinking::No);
+		}
+
+		Reactors[ReactorIndex]->ApplyEmotionVisuals(static_cast<EEmotionType>(DominantEmotion), Intensity);
+	}
+
+	// collect the hit notifications before dispatching them, since Blueprint may add or remove reactors
+	HitNotifications.Reset();
+
+	for (const int32 ReactorIndex : HitReactors)
+	{
+		HitNotifications.Emplace(Reactors[ReactorIndex], PendingHitTypes[ReactorIndex]);
+
+		PendingHitTypes[ReactorIndex] = nullptr;
+		ReactorFlags[ReactorIndex] &= ~ReactorFlag_Hit;
+	}
+
+	HitReactors.Reset();
+
+	// call the BP handlers once per reactor for this update
+	for (const TPair<TWeakObjectPtr<AEmotionReactActor>, TSubclassOf<UDamageType>>& Notification : HitNotifications)
+	{
+		if (AEmotionReactActor* Reactor = Notification.Key.Get())
+		{
+			Reactor->BP_OnProjectileHit(Notification.Value);
+		}
+	}
+}
+
+FIntVector UEmotionReactionSubsystem::GetGridCell(const FVector3f& Location) const
+{
+	const float InvCellSize = 1.0f / FMath::Max(ContagionRadius, 1.0f);
+
+	return FIntVector(
+		FMath::FloorToInt32(Location.X * InvCellSize),
+		FMath::FloorToInt32(Location.Y * InvCellSize),
+		FMath::FloorToInt32(Location.Z * InvCellSize));
+}
+
+void UEmotionReactionSubsystem::StartContagion(int32 ReactorIndex, EEmotionType Emotion, float Amount)
+{
+	if (Amount < MinContagionAmount || ContagionRadius <= 0.0f || ContagionStrength <= 0.0f)
+	{
+		return;
+	}
+
+	// every hit starts its own wave. The source doesn't get re-infected by its neighbours
+	FEmotionContagion& Contagion = ContagionQueue.AddDefaulted_GetRef();
+	Contagion.SourceIndex = ReactorIndex;
+	Contagion.Emotion = Emotion;
+	Contagion.Amount = Amount;
+	Contagion.WaveId = ++LastWaveId;
+
+	// waves overlap, so each one tracks the reactors it has reached on its own
+	FEmotionContagionWave& Wave = ContagionWaves.Add(Contagion.WaveId);
+	Wave.Visited.Init(false, Reactors.Num());
+	Wave.Visited[ReactorIndex] = true;
+	Wave.NumPending = 1;
+}
+
+void UEmotionReactionSubsystem::UpdateContagion(double Time)
+{
+	const float RadiusSquared = FMath::Square(ContagionRadius);
+	const float InvRadius = 1.0f / FMath::Max(ContagionRadius, 1.0f);
+
+	int32 NumChecks = 0;
+
+	// process spreads in FIFO order until we run out of budget. A spread that runs out of budget
+	// resumes from the same cell and reactor next frame, so the order of infections only depends on the order of the hits
+	while (ContagionQueueHead < ContagionQueue.Num())
+	{
+		// copy the spread, since enqueueing new ones may reallocate the queue
+		const FEmotionContagion Contagion = ContagionQueue[ContagionQueueHead];
+
+		// skip spreads from reactors that have been removed
+		if (Contagion.SourceIndex == INDEX_NONE)
+		{
+			FinishContagion();
+			continue;
+		}
+
+		const FVector3f SourceLocation = ReactorLocations[Contagion.SourceIndex];
+		const FIntVector SourceCell = ReactorCells[Contagion.SourceIndex];
+		FEmotionContagionWave& Wave = ContagionWaves.FindChecked(Contagion.WaveId);
+
+		bool bOutOfBudget = false;
+
+		// the cells are as big as the contagion radius, so the surrounding 3x3x3 cells cover every neighbour in range
+		for (; ContagionCellIndex < 27; ++ContagionCellIndex, ContagionReactorOffset = 0)
+		{
+			const FIntVector CellOffset(ContagionCellIndex / 9 - 1, (ContagionCellIndex / 3) % 3 - 1, ContagionCellIndex % 3 - 1);
+			const TArray<int32>* CellReactors = ReactorGrid.Find(SourceCell + CellOffset);
+
+			if (!CellReactors)
+			{
+				continue;
+			}
+
+			for (; ContagionReactorOffset < CellReactors->Num(); ++ContagionReactorOffset)
+			{
+				if (NumChecks >= MaxContagionChecksPerFrame)
+				{
+					bOutOfBudget = true;
+					break;
+				}
+
+				++NumChecks;
+
+				const int32 NeighbourIndex = (*CellReactors)[ContagionReactorOffset];
+
+				// has this wave already reached this reactor?
+				if (Wave.Visited[NeighbourIndex])
+				{
+					continue;
+				}
+
+				const float DistanceSquared = FVector3f::DistSquared(SourceLocation, ReactorLocations[NeighbourIndex]);
+
+				if (DistanceSquared > RadiusSquared)
+				{
+					continue;
+				}
+
+				// fall off linearly with distance
+				const float Falloff = 1.0f - FMath::Sqrt(DistanceSquared) * InvRadius;
+				const float Amount = Contagion.Amount * ContagionStrength * Falloff;
+
+				if (Amount < MinContagionAmount)
+				{
+					continue;
+				}
+
+				Wave.Visited[NeighbourIndex] = true;
+
+				AddEmotionByIndex(NeighbourIndex, Contagion.Emotion, Amount, Time);
+
+				// keep spreading. Amounts shrink geometrically, so every wave dies out
+				FEmotionContagion& NextContagion = ContagionQueue.AddDefaulted_GetRef();
+				NextContagion.SourceIndex = NeighbourIndex;
+				NextContagion.Emotion = Contagion.Emotion;
+				NextContagion.Amount = Amount;
+				NextContagion.WaveId = Contagion.WaveId;
+
+				++Wave.NumPending;
+			}
+
+			if (bOutOfBudget)
+			{
+				break;
+			}
+		}
+
+		// leave the spread at the head of the queue to pick up where it stopped
+		if (bOutOfBudget)
+		{
+			break;
+		}
+
+		FinishContagion();
+	}
+
+	// reclaim the queue once it's drained
+	if (ContagionQueueHead >= ContagionQueue.Num())
+	{
+		ContagionQueue.Reset();
+		ContagionQueueHead = 0;
+
+	} else if (ContagionQueueHead > ContagionQueue.Num() / 2) {
+
+		// compact the queue so it doesn't grow without bounds during long chains
+		ContagionQueue.RemoveAt(0, ContagionQueueHead, EAllowShrinking::No);
+		ContagionQueueHead = 0;
+	}
+
+	SET_DWORD_STAT(STAT_EmotionContagionChecks, NumChecks);
+}
+
+void UEmotionReactionSubsystem::FinishContagion()
+{
+	const uint32 WaveId = ContagionQueue[ContagionQueueHead++].WaveId;
+
+	ContagionCellIndex = 0;
+	ContagionReactorOffset = 0;
+
+	// release the wave's visited set once it has drained
+	FEmotionContagionWave& Wave = ContagionWaves.FindChecked(WaveId);
+
+	if (--Wave.NumPending <= 0)
+	{
+		ContagionWaves.Remove(WaveId);
+	}
+}
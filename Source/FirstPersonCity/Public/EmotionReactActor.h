@@ -8,16 +8,23 @@
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Engine/Engine.h"
 #include "Engine/DamageEvents.h"
+#include "Variant_Shooter/Weapons/CustomDamageTypes.h"
 #include "EmotionReactActor.generated.h"
 
-class UFireDamageType;
+class UEmotionReactionSubsystem;
 
+/**
+ *  Actor that reacts visually to emotional damage types
+ *  Does not tick. Its emotional state is owned and updated by the UEmotionReactionSubsystem
+ */
 UCLASS()
 class FIRSTPERSONCITY_API AEmotionReactActor : public AActor
 {
 	GENERATED_BODY()
-	
-public:	
+
+	friend class UEmotionReactionSubsystem;
+
+public:
 	// Sets default values for this actor's properties
 	AEmotionReactActor();
 
@@ -25,18 +32,48 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the actor is removed from the game
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/** Static mesh component for visual representation */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	UStaticMeshComponent* MeshComponent;
 
+	/** Emotion intensity gained per point of emotional damage received */
+	UPROPERTY(EditAnywhere, Category = "Emotion", meta = (ClampMin = 0, ClampMax = 1))
+	float EmotionPerDamage = 0.01f;
+
+	/** Exponential decay rate of emotion intensity, per second */
+	UPROPERTY(EditAnywhere, Category = "Emotion", meta = (ClampMin = 0, ClampMax = 10))
+	float EmotionDecayRate = 0.5f;
+
+	/** Material parameter set to the color of the dominant emotion */
+	UPROPERTY(EditAnywhere, Category = "Emotion|Visuals")
+	FName EmotionColorParameter = FName("EmotionColor");
+
+	/** Material parameter set to the intensity of the dominant emotion */
+	UPROPERTY(EditAnywhere, Category = "Emotion|Visuals")
+	FName EmotionIntensityParameter = FName("EmotionIntensity");
+
+	/** Color to display for each emotion */
+	UPROPERTY(EditAnywhere, Category = "Emotion|Visuals")
+	TMap<EEmotionType, FLinearColor> EmotionColors;
+
+	/** Dynamic material driven by the emotion subsystem. Created on the first reaction */
+	UPROPERTY(Transient)
+	TObjectPtr<UMaterialInstanceDynamic> EmotionMaterial;
+
+	/** Index of this actor in the emotion subsystem's packed arrays */
+	int32 EmotionReactorIndex = INDEX_NONE;
+
 	/** Passes control to Blueprint to implement any effects on hit. */
 	UFUNCTION(BlueprintImplementableEvent, Category="Projectile", meta = (DisplayName = "On Projectile Hit"))
 	void BP_OnProjectileHit(TSubclassOf<UDamageType> DamageTypeClass);
 
+	/** Pushes the dominant emotion to the dynamic material. Called from the emotion subsystem's batched update */
+	void ApplyEmotionVisuals(EEmotionType DominantEmotion, float Intensity);
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+public:
 
 	/** Handle incoming damage and trigger visual effects based on damage type */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
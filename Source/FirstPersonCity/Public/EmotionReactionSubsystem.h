@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Variant_Shooter/Weapons/CustomDamageTypes.h"
+#include "EmotionReactionSubsystem.generated.h"
+
+class AEmotionReactActor;
+class UDamageType;
+
+/**
+ *  A pending spread of an emotion from one reactor to its neighbours
+ */
+struct FEmotionContagion
+{
+	/** Index of the reactor spreading the emotion */
+	int32 SourceIndex = INDEX_NONE;
+
+	/** Emotion being spread */
+	EEmotionType Emotion = EEmotionType::Joy;
+
+	/** Amount of emotion the source received */
+	float Amount = 0.0f;
+
+	/** Contagion wave this spread belongs to. Each reactor is affected at most once per wave */
+	uint32 WaveId = 0;
+};
+
+/**
+ *  Bookkeeping for a contagion wave that's still spreading
+ */
+struct FEmotionContagionWave
+{
+	/** One bit per reactor, set once the wave has reached it */
+	TBitArray<> Visited;
+
+	/** Number of the wave's spreads still in the queue. The wave is released once this drops to zero */
+	int32 NumPending = 0;
+};
+
+/**
+ *  Owns the emotional state of every AEmotionReactActor in the world
+ *  State is kept in packed arrays indexed by reactor and decays lazily from the last time it was touched,
+ *  so reactors cost nothing until they're hit and update cost scales with the number of active reactions
+ *  Visual parameters and Blueprint hit events are driven in a single batched pass per frame
+ *  Emotions spread to neighbouring reactors through a uniform grid, processed in FIFO order under a fixed per-frame budget
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UEmotionReactionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Max distance emotions spread between reactors. Also the size of the grid cells */
+	UPROPERTY(Config)
+	float ContagionRadius = 600.0f;
+
+	/** Fraction of the received emotion passed on to a reactor at zero distance. Falls off linearly to zero at ContagionRadius */
+	UPROPERTY(Config)
+	float ContagionStrength = 0.5f;
+
+	/** Smallest amount of emotion worth spreading */
+	UPROPERTY(Config)
+	float MinContagionAmount = 0.02f;
+
+	/** Max number of neighbour checks done per frame while spreading emotions */
+	UPROPERTY(Config)
+	int32 MaxContagionChecksPerFrame = 2048;
+
+	/** Registered reactors. Indices match the packed state arrays below */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AEmotionReactActor>> Reactors;
+
+	/** Emotion levels as of each reactor's evaluation time. EmotionTypeCount entries per reactor */
+	TArray<float> EmotionLevels;
+
+	/** World time each reactor's emotion levels were last evaluated at */
+	TArray<double> EvaluationTimes;
+
+	/** Exponential decay rate per reactor */
+	TArray<float> DecayRates;
+
+	/** Emotion gained per point of damage, per reactor */
+	TArray<float> EmotionPerDamage;
+
+	/** Damage type of the last hit received since the previous update, per reactor */
+	TArray<TSubclassOf<UDamageType>> PendingHitTypes;
+
+	/** Bitmask of EReactorFlags per reactor */
+	TArray<uint8> ReactorFlags;
+
+	/** Reactors with visible emotions that still need visual updates */
+	TArray<int32> ActiveReactors;
+
+	/** Reactors hit since the previous update */
+	TArray<int32> HitReactors;
+
+	/** World location of each reactor, captured on registration */
+	TArray<FVector3f> ReactorLocations;
+
+	/** Grid cell of each reactor */
+	TArray<FIntVector> ReactorCells;
+
+	/** Reactor indices bucketed by grid cell */
+	TMap<FIntVector, TArray<int32>> ReactorGrid;
+
+	/** Pending emotion spreads, consumed from ContagionQueueHead */
+	TArray<FEmotionContagion> ContagionQueue;
+
+	/** Index of the next spread to process */
+	int32 ContagionQueueHead = 0;
+
+	/** Neighbour cell the spread at the head of the queue resumes from, when it ran out of budget mid-spread */
+	int32 ContagionCellIndex = 0;
+
+	/** Offset into that cell's reactors the spread resumes from */
+	int32 ContagionReactorOffset = 0;
+
+	/** Waves still spreading, by id */
+	TMap<uint32, FEmotionContagionWave> ContagionWaves;
+
+	/** Id of the last contagion wave started */
+	uint32 LastWaveId = 0;
+
+	/** Scratch list of hit notifications dispatched during the update */
+	TArray<TPair<TWeakObjectPtr<AEmotionReactActor>, TSubclassOf<UDamageType>>> HitNotifications;
+
+	/** Emotion intensity below which a reactor is considered calm again */
+	float MinVisibleIntensity = 0.01f;
+
+	/** Per reactor flags */
+	enum EReactorFlags : uint8
+	{
+		ReactorFlag_Active = 1 << 0,
+		ReactorFlag_Hit = 1 << 1,
+	};
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Adds a reactor to the packed state arrays */
+	void RegisterReactor(AEmotionReactActor* Reactor);
+
+	/** Removes a reactor from the packed state arrays */
+	void UnregisterReactor(AEmotionReactActor* Reactor);
+
+	/** Records a hit on a reactor. Emotional damage types raise the matching emotion */
+	void AddReaction(AEmotionReactActor* Reactor, TSubclassOf<UDamageType> DamageTypeClass, float Damage);
+
+	/** Raises an emotion on a reactor by the given amount */
+	void AddEmotion(AEmotionReactActor* Reactor, EEmotionType Emotion, float Amount);
+
+	/** Returns the current level of an emotion on a reactor */
+	float GetEmotionLevel(const AEmotionReactActor* Reactor, EEmotionType Emotion) const;
+
+	/** Returns the number of registered reactors */
+	int32 GetNumReactors() const { return Reactors.Num(); }
+
+	/** Returns the number of reactors with visible emotions */
+	int32 GetNumActiveReactors() const { return ActiveReactors.Num(); }
+
+	/** Returns true if emotions are still spreading */
+	bool HasPendingContagion() const { return ContagionQueueHead < ContagionQueue.Num(); }
+
+protected:
+
+	/** Returns the emotion decay factor for a reactor at the given time */
+	float GetDecayFactor(int32 ReactorIndex, double Time) const;
+
+	/** Applies pending decay to a reactor's stored levels so they're current as of the given time */
+	void EvaluateReactor(int32 ReactorIndex, double Time);
+
+	/** Raises an emotion on a reactor by index */
+	void AddEmotionByIndex(int32 ReactorIndex, EEmotionType Emotion, float Amount, double Time);
+
+	/** Updates visuals for all active reactors and dispatches hit notifications */
+	void UpdateReactors(double Time);
+
+	/** Returns the grid cell containing a location */
+	FIntVector GetGridCell(const FVector3f& Location) const;
+
+	/** Starts spreading an emotion from a reactor */
+	void StartContagion(int32 ReactorIndex, EEmotionType Emotion, float Amount);
+
+	/** Processes pending emotion spreads until the per-frame budget runs out */
+	void UpdateContagion(double Time);
+
+	/** Pops the spread at the head of the queue, releasing its wave once it has no spreads left */
+	void FinishContagion();
+};
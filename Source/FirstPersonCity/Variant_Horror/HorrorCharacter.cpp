@@ -29,21 +29,21 @@ void AHorrorCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	// initialize sprint meter to max
-	SprintMeter = SprintTime;
+	SprintMeterStart = SprintTime;
+	SprintMeterStartTime = GetWorld()->GetTimeSeconds();
+	SprintMeterRate = 0.0f;
 
 	// Initialize the walk speed
 	GetCharacterMovement()->MaxWalkSpeed = WalkSpeed;
-
-	// start the sprint tick timer
-	GetWorld()->GetTimerManager().SetTimer(SprintTimer, this, &AHorrorCharacter::SprintFixedTick, SprintFixedTickTime, true);
 }
 
 void AHorrorCharacter::EndPlay(EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
-	// clear the sprint timer
+	// clear the sprint timers
 	GetWorld()->GetTimerManager().ClearTimer(SprintTimer);
+	GetWorld()->GetTimerManager().ClearTimer(SprintMovementTimer);
 }
 
 void AHorrorCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -77,6 +77,10 @@ void AHorrorCharacter::DoStartSprint()
 		OnSprintStateChanged.Broadcast(true);
 	}
 
+	// watch for movement changes while the sprint input is held
+	GetWorld()->GetTimerManager().SetTimer(SprintMovementTimer, this, &AHorrorCharacter::UpdateSprintMeterRate, SprintFixedTickTime, true);
+
+	UpdateSprintMeterRate();
 }
 
 void AHorrorCharacter::DoEndSprint()
@@ -93,51 +97,121 @@ void AHorrorCharacter::DoEndSprint()
 		// call the sprint state changed delegate
 		OnSprintStateChanged.Broadcast(false);
 	}
+
+	// we no longer need to watch movement
+	GetWorld()->GetTimerManager().ClearTimer(SprintMovementTimer);
+
+	UpdateSprintMeterRate();
 }
 
-void AHorrorCharacter::SprintFixedTick()
+float AHorrorCharacter::GetSprintMeter() const
 {
-	// are we out of recovery, still have stamina and are moving faster than our walk speed?
-	if (bSprinting && !bRecovering && GetVelocity().Length() > WalkSpeed)
+	// evaluate the meter from the start of the current segment
+	const float Elapsed = static_cast<float>(GetWorld()->GetTimeSeconds() - SprintMeterStartTime);
+
+	return FMath::Clamp(SprintMeterStart + SprintMeterRate * Elapsed, 0.0f, SprintTime);
+}
+
+float AHorrorCharacter::GetSprintMeterPercent() const
+{
+	return SprintTime > 0.0f ? GetSprintMeter() / SprintTime : 0.0f;
+}
+
+void AHorrorCharacter::SetSprintMeterRate(float NewRate)
+{
+	// start a new segment from the current meter value
+	SprintMeterStart = GetSprintMeter();
+	SprintMeterStartTime = GetWorld()->GetTimeSeconds();
+	SprintMeterRate = NewRate;
+
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	TimerManager.ClearTimer(SprintTimer);
+
+	if (SprintMeterRate < 0.0f)
 	{
+		// schedule the moment the meter runs out
+		TimerManager.SetTimer(SprintTimer, this, &AHorrorCharacter::OnSprintMeterDepleted, FMath::Max(SprintMeterStart / -SprintMeterRate, KINDA_SMALL_NUMBER), false);
 
-		// do we still have meter to burn?
-		if (SprintMeter > 0.0f)
-		{
-			// update the sprint meter
-			SprintMeter = FMath::Max(SprintMeter - SprintFixedTickTime, 0.0f);
-
-			// have we run out of stamina?
-			if (SprintMeter <= 0.0f)
-			{
-				// raise the recovering flag
-				bRecovering = true;
-
-				// set the recovering walk speed
-				GetCharacterMovement()->MaxWalkSpeed = RecoveringWalkSpeed;
-			}
-		}
-		
-	} else {
+	} else if (SprintMeterRate > 0.0f) {
 
-		// recover stamina
-		SprintMeter = FMath::Min(SprintMeter + SprintFixedTickTime, SprintTime);
+		// schedule the moment the meter is full again
+		TimerManager.SetTimer(SprintTimer, this, &AHorrorCharacter::OnSprintMeterRecovered, FMath::Max((SprintTime - SprintMeterStart) / SprintMeterRate, KINDA_SMALL_NUMBER), false);
+	}
 
-		if (SprintMeter >= SprintTime)
-		{
-			// lower the recovering flag
-			bRecovering = false;
+	// broadcast the sprint meter updated delegate
+	OnSprintMeterUpdated.Broadcast(GetSprintMeterPercent());
+}
 
-			// set the walk or sprint speed depending on whether the sprint button is down
-			GetCharacterMovement()->MaxWalkSpeed = bSprinting ? SprintSpeed : WalkSpeed;
+void AHorrorCharacter::UpdateSprintMeterRate()
+{
+	float NewRate = 0.0f;
 
-			// update the sprint state depending on whether the button is down or not
-			OnSprintStateChanged.Broadcast(bSprinting);
-		}
+	// are we out of recovery, holding sprint and moving faster than our walk speed?
+	if (bSprinting && !bRecovering && GetVelocity().Length() > WalkSpeed)
+	{
+		// burn one second of stamina per second
+		NewRate = -1.0f;
+
+	} else if (GetSprintMeter() < SprintTime || bRecovering) {
+
+		// recover one second of stamina per second
+		NewRate = 1.0f;
+	}
 
+	// only start a new segment if the rate actually changed
+	if (NewRate != SprintMeterRate)
+	{
+		SetSprintMeterRate(NewRate);
 	}
+}
+
+void AHorrorCharacter::OnSprintMeterDepleted()
+{
+	// raise the recovering flag
+	bRecovering = true;
+
+	// set the recovering walk speed
+	GetCharacterMovement()->MaxWalkSpeed = RecoveringWalkSpeed;
+
+	// no need to watch movement until we've recovered
+	GetWorld()->GetTimerManager().ClearTimer(SprintMovementTimer);
+
+	// start recovering from an empty meter
+	SprintMeterStart = 0.0f;
+	SprintMeterStartTime = GetWorld()->GetTimeSeconds();
+	SprintMeterRate = 0.0f;
+
+	SetSprintMeterRate(1.0f);
+}
+
+void AHorrorCharacter::OnSprintMeterRecovered()
+{
+	// the meter is full, so it stays constant until we sprint again
+	SprintMeterStart = SprintTime;
+	SprintMeterStartTime = GetWorld()->GetTimeSeconds();
+	SprintMeterRate = 0.0f;
 
 	// broadcast the sprint meter updated delegate
-	OnSprintMeterUpdated.Broadcast(SprintMeter / SprintTime);
+	OnSprintMeterUpdated.Broadcast(1.0f);
+
+	// were we recovering from an empty meter?
+	if (bRecovering)
+	{
+		// lower the recovering flag
+		bRecovering = false;
+
+		// set the walk or sprint speed depending on whether the sprint button is down
+		GetCharacterMovement()->MaxWalkSpeed = bSprinting ? SprintSpeed : WalkSpeed;
 
+		// update the sprint state depending on whether the button is down or not
+		OnSprintStateChanged.Broadcast(bSprinting);
+
+		// resume watching movement if the sprint button is still held
+		if (bSprinting)
+		{
+			GetWorld()->GetTimerManager().SetTimer(SprintMovementTimer, this, &AHorrorCharacter::UpdateSprintMeterRate, SprintFixedTickTime, true);
+
+			UpdateSprintMeterRate();
+		}
+	}
 }
@@ -15,6 +15,8 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSprintStateChangedDelegate, bool, b
 /**
  *  Simple first person horror character
  *  Provides stamina-based sprinting
+ *  The sprint meter is evaluated analytically from the start of its current drain or recovery segment,
+ *  so it only does work when the sprint state changes, the meter runs out or it finishes recovering
  */
 UCLASS(abstract)
 class FIRSTPERSONCITY_API AHorrorCharacter : public AFirstPersonCityCharacter
@@ -41,12 +43,18 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Walk")
 	float WalkSpeed = 250.0f;
 
-	/** Time interval for sprinting stamina ticks */
+	/** Time interval for checking whether we're actually moving while the sprint input is held */
 	UPROPERTY(EditAnywhere, Category="Sprint", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
 	float SprintFixedTickTime = 0.03333f;
 
-	/** Sprint stamina amount. Maxes at SprintTime */
-	float SprintMeter = 0.0f;
+	/** Sprint stamina amount at the start of the current meter segment. Maxes at SprintTime */
+	float SprintMeterStart = 0.0f;
+
+	/** Game time when the current meter segment started */
+	double SprintMeterStartTime = 0.0;
+
+	/** Rate of change of the sprint meter during the current segment, in stamina per second */
+	float SprintMeterRate = 0.0f;
 
 	/** How long we can sprint for, in seconds */
 	UPROPERTY(EditAnywhere, Category="Sprint", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
@@ -64,9 +72,12 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Recovery", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
 	float RecoveryTime = 0.0f;
 
-	/** Sprint tick timer */
+	/** Fires when the current meter segment runs out or finishes recovering */
 	FTimerHandle SprintTimer;
 
+	/** Checks for movement changes while the sprint input is held */
+	FTimerHandle SprintMovementTimer;
+
 public:
 
 	/** Delegate called when the sprint meter should be updated */
@@ -99,6 +110,27 @@ protected:
 	UFUNCTION(BlueprintCallable, Category="Input")
 	void DoEndSprint();
 
-	/** Called while sprinting at a fixed time interval */
-	void SprintFixedTick();
+	/** Starts a new sprint meter segment at the current meter value with the given rate */
+	void SetSprintMeterRate(float NewRate);
+
+	/** Picks the drain or recovery rate for the current sprint and movement state */
+	void UpdateSprintMeterRate();
+
+	/** Called when the sprint meter runs out while draining */
+	void OnSprintMeterDepleted();
+
+	/** Called when the sprint meter finishes recovering */
+	void OnSprintMeterRecovered();
+
+public:
+
+	/** Returns the current sprint meter value */
+	float GetSprintMeter() const;
+
+	/** Returns the current sprint meter value as a percentage of the max */
+	UFUNCTION(BlueprintPure, Category="Sprint")
+	float GetSprintMeterPercent() const;
+
+	/** Returns true if the sprint meter is currently draining or recovering */
+	bool IsSprintMeterChanging() const { return SprintMeterRate != 0.0f; }
 };
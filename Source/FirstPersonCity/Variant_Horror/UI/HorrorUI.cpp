@@ -6,6 +6,8 @@
 
 void UHorrorUI::SetupCharacter(AHorrorCharacter* HorrorCharacter)
 {
+	DisplayedCharacter = HorrorCharacter;
+
 	HorrorCharacter->OnSprintMeterUpdated.AddDynamic(this, &UHorrorUI::OnSprintMeterUpdated);
 	HorrorCharacter->OnSprintStateChanged.AddDynamic(this, &UHorrorUI::OnSprintStateChanged);
 }
@@ -21,3 +23,17 @@ void UHorrorUI::OnSprintStateChanged(bool bSprinting)
 	// call the BP handler
 	BP_SprintStateChanged(bSprinting);
 }
+
+void UHorrorUI::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+	Super::NativeTick(MyGeometry, InDeltaTime);
+
+	// the meter only needs to be redrawn while it's moving
+	if (const AHorrorCharacter* HorrorCharacter = DisplayedCharacter.Get())
+	{
+		if (HorrorCharacter->IsSprintMeterChanging())
+		{
+			BP_SprintMeterUpdated(HorrorCharacter->GetSprintMeterPercent());
+		}
+	}
+}
@@ -11,6 +11,7 @@ class AHorrorCharacter;
 /**
  *  Simple UI for a first person horror game
  *  Manages character sprint meter display
+ *  Reads the sprint meter lazily from the character and only while it's changing
  */
 UCLASS(abstract)
 class FIRSTPERSONCITY_API UHorrorUI : public UUserWidget
@@ -32,6 +33,12 @@ public:
 
 protected:
 
+	/** Character whose sprint meter is displayed */
+	TWeakObjectPtr<AHorrorCharacter> DisplayedCharacter;
+
+	/** Updates the sprint meter display while the meter is draining or recovering */
+	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+
 	/** Passes control to Blueprint to update the sprint meter widgets */
 	UFUNCTION(BlueprintImplementableEvent, Category="Horror", meta = (DisplayName = "Sprint Meter Updated"))
 	void BP_SprintMeterUpdated(float Percent);
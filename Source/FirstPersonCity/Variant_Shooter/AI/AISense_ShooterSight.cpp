@@ -0,0 +1,383 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "AISense_ShooterSight.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "Perception/AIPerceptionSystem.h"
+#include "AITypes.h"
+#include "Math/VectorRegister.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+#include "ShooterFrameBudget.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shooter Sight Update"), STAT_ShooterSightUpdate, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Candidates"), STAT_ShooterSightCandidates, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Traces"), STAT_ShooterSightTraces, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Traces Deferred"), STAT_ShooterSightTracesDeferred, STATGROUP_FirstPersonCity);
+
+namespace ShooterSight
+{
+	/** Max number of updates a pair's wait counts for when prioritising its trace */
+	constexpr uint32 MaxWaitUpdates = 8;
+
+	/** Tests four candidates at a time against a vision cone. Bit N of each output byte is set if candidate N of that batch passes */
+	static void ConeTest(const FVector& Origin, const FVector& Direction, float CosHalfAngle, const float* X, const float* Y, const float* Z, const float* RadiusSq, int32 Num, uint8* OutMasks)
+	{
+		const VectorRegister4Float OriginX = VectorSetFloat1(static_cast<float>(Origin.X));
+		const VectorRegister4Float OriginY = VectorSetFloat1(static_cast<float>(Origin.Y));
+		const VectorRegister4Float OriginZ = VectorSetFloat1(static_cast<float>(Origin.Z));
+
+		const VectorRegister4Float DirX = VectorSetFloat1(static_cast<float>(Direction.X));
+		const VectorRegister4Float DirY = VectorSetFloat1(static_cast<float>(Direction.Y));
+		const VectorRegister4Float DirZ = VectorSetFloat1(static_cast<float>(Direction.Z));
+
+		const VectorRegister4Float CosAngle = VectorSetFloat1(CosHalfAngle);
+
+		for (int32 Lane = 0; Lane < Num; Lane += 4)
+		{
+			const VectorRegister4Float DeltaX = VectorSubtract(VectorLoadAligned(X + Lane), OriginX);
+			const VectorRegister4Float DeltaY = VectorSubtract(VectorLoadAligned(Y + Lane), OriginY);
+			const VectorRegister4Float DeltaZ = VectorSubtract(VectorLoadAligned(Z + Lane), OriginZ);
+
+			const VectorRegister4Float DistSq = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaZ, DeltaZ)));
+			const VectorRegister4Float Dot = VectorMultiplyAdd(DeltaX, DirX, VectorMultiplyAdd(DeltaY, DirY, VectorMultiply(DeltaZ, DirZ)));
+
+			// in range, and the angle to the candidate is inside the cone: Dot >= Cos * Dist
+			const VectorRegister4Float InRange = VectorCompareLE(DistSq, VectorLoadAligned(RadiusSq + Lane));
+			const VectorRegister4Float InCone = VectorCompareGE(Dot, VectorMultiply(CosAngle, VectorSqrt(DistSq)));
+
+			OutMasks[Lane / 4] = static_cast<uint8>(VectorMaskBits(VectorBitwiseAnd(InRange, InCone)));
+		}
+	}
+}
+
+UAISenseConfig_ShooterSight::UAISenseConfig_ShooterSight(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	DebugColor = FColor::Green;
+	Implementation = UAISense_ShooterSight::StaticClass();
+}
+
+TSubclassOf<UAISense> UAISenseConfig_ShooterSight::GetSenseImplementation() const
+{
+	return Implementation;
+}
+
+UAISense_ShooterSight::UAISense_ShooterSight(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// only instances track listeners
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		OnNewListenerDelegate.BindUObject(this, &UAISense_ShooterSight::OnNewListenerImpl);
+		OnListenerUpdateDelegate.BindUObject(this, &UAISense_ShooterSight::OnListenerUpdateImpl);
+		OnListenerRemovedDelegate.BindUObject(this, &UAISense_ShooterSight::OnListenerRemovedImpl);
+	}
+
+	// report gained and lost sight like the engine sight sense
+	NotifyType = EAISenseNotifyType::OnPerceptionChange;
+	bAutoRegisterAllPawnsAsSources = true;
+	bNeedsForgettingNotification = true;
+	DefaultExpirationAge = FAISystem::InfiniteInterval;
+}
+
+void UAISense_ShooterSight::RegisterSource(AActor& SourceActor)
+{
+	Sources.AddUnique(&SourceActor);
+}
+
+void UAISense_ShooterSight::UnregisterSource(AActor& SourceActor)
+{
+	Sources.RemoveSwap(&SourceActor, EAllowShrinking::No);
+}
+
+float UAISense_ShooterSight::Update()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterSightUpdate);
+	SHOOTER_BUDGET_SCOPE(AI);
+
+	++UpdateCounter;
+
+	// drop sources that were destroyed without unregistering
+	Sources.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Source) { return !Source.IsValid(); }, EAllowShrinking::No);
+
+	RebuildGrids();
+
+	TraceRequests.Reset();
+
+	AIPerception::FListenerMap& ListenersMap = *GetListeners();
+
+	for (auto It = SightListeners.CreateIterator(); It; ++It)
+	{
+		FPerceptionListener* Listener = ListenersMap.Find(It.Key());
+
+		if (!Listener || !Listener->Listener.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		GatherCandidates(*Listener, It.Value());
+	}
+
+	ProcessTraces();
+
+	// update again next frame
+	return 0.0f;
+}
+
+void UAISense_ShooterSight::OnNewListenerImpl(const FPerceptionListener& NewListener)
+{
+	ConfigureListener(NewListener, SightListeners.FindOrAdd(NewListener.GetListenerID()));
+}
+
+void UAISense_ShooterSight::OnListenerUpdateImpl(const FPerceptionListener& UpdatedListener)
+{
+	if (UpdatedListener.HasSense(GetSenseID()))
+	{
+		ConfigureListener(UpdatedListener, SightListeners.FindOrAdd(UpdatedListener.GetListenerID()));
+
+	} else {
+
+		SightListeners.Remove(UpdatedListener.GetListenerID());
+	}
+}
+
+void UAISense_ShooterSight::OnListenerRemovedImpl(const FPerceptionListener& RemovedListener)
+{
+	SightListeners.Remove(RemovedListener.GetListenerID());
+}
+
+void UAISense_ShooterSight::ConfigureListener(const FPerceptionListener& Listener, FShooterSightListener& SightListener) const
+{
+	const UAIPerceptionComponent* PerceptionComponent = Listener.Listener.Get();
+	const UAISenseConfig_ShooterSight* Config = PerceptionComponent ? Cast<const UAISenseConfig_ShooterSight>(PerceptionComponent->GetSenseConfig(GetSenseID())) : nullptr;
+
+	if (!Config)
+	{
+		return;
+	}
+
+	SightListener.SightRadiusSq = FMath::Square(Config->SightRadius);
+	SightListener.LoseSightRadiusSq = FMath::Square(FMath::Max(Config->LoseSightRadius, Config->SightRadius));
+	SightListener.CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(Config->PeripheralVisionAngleDegrees));
+	SightListener.TargetTag = Config->TargetTag;
+}
+
+void UAISense_ShooterSight::RebuildGrids()
+{
+	// keep the cell arrays around between updates, just empty them
+	for (TPair<FName, TMap<FIntPoint, TArray<int32>>>& Grid : TargetGrids)
+	{
+		for (TPair<FIntPoint, TArray<int32>>& Cell : Grid.Value)
+		{
+			Cell.Value.Reset();
+		}
+	}
+
+	// make sure every tag being looked for has a grid
+	for (const TPair<FPerceptionListenerID, FShooterSightListener>& SightListener : SightListeners)
+	{
+		TargetGrids.FindOrAdd(SightListener.Value.TargetTag);
+	}
+
+	for (int32 SourceIndex = 0; SourceIndex < Sources.Num(); ++SourceIndex)
+	{
+		const AActor* Source = Sources[SourceIndex].Get();
+		const FIntPoint Cell = GetCell(Source->GetActorLocation());
+
+		for (TPair<FName, TMap<FIntPoint, TArray<int32>>>& Grid : TargetGrids)
+		{
+			if (Source->ActorHasTag(Grid.Key))
+			{
+				Grid.Value.FindOrAdd(Cell).Add(SourceIndex);
+			}
+		}
+	}
+}
+
+void UAISense_ShooterSight::GatherCandidates(FPerceptionListener& Listener, FShooterSightListener& SightListener)
+{
+	const TMap<FIntPoint, TArray<int32>>* Grid = TargetGrids.Find(SightListener.TargetTag);
+	const AActor* Body = Listener.GetBodyActor();
+
+	CandidateX.Reset();
+	CandidateY.Reset();
+	CandidateZ.Reset();
+	CandidateRadiusSq.Reset();
+	CandidateSources.Reset();
+
+	// only visit the cells a seen target could still be in
+	if (Grid && Body)
+	{
+		const float Reach = FMath::Sqrt(SightListener.LoseSightRadiusSq);
+		const FIntPoint MinCell = GetCell(Listener.CachedLocation - FVector(Reach, Reach, 0.0f));
+		const FIntPoint MaxCell = GetCell(Listener.CachedLocation + FVector(Reach, Reach, 0.0f));
+
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+		{
+			for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+			{
+				const TArray<int32>* CellSources = Grid->Find(FIntPoint(CellX, CellY));
+
+				if (!CellSources)
+				{
+					continue;
+				}
+
+				for (const int32 SourceIndex : *CellSources)
+				{
+					const AActor* Source = Sources[SourceIndex].Get();
+
+					if (Source == Body)
+					{
+						continue;
+					}
+
+					// targets already in sight are kept up to the lose sight radius
+					const FShooterSightPair* Pair = SightListener.Pairs.Find(Source);
+					const FVector Location = Source->GetActorLocation();
+
+					CandidateX.Add(static_cast<float>(Location.X));
+					CandidateY.Add(static_cast<float>(Location.Y));
+					CandidateZ.Add(static_cast<float>(Location.Z));
+					CandidateRadiusSq.Add(Pair && Pair->bSeen ? SightListener.LoseSightRadiusSq : SightListener.SightRadiusSq);
+					CandidateSources.Add(SourceIndex);
+				}
+			}
+		}
+	}
+
+	const int32 NumCandidates = CandidateSources.Num();
+	INC_DWORD_STAT_BY(STAT_ShooterSightCandidates, NumCandidates);
+
+	// pad to whole batches with lanes that always fail
+	const int32 NumLanes = Align(NumCandidates, 4);
+
+	for (int32 Lane = NumCandidates; Lane < NumLanes; ++Lane)
+	{
+		CandidateX.Add(0.0f);
+		CandidateY.Add(0.0f);
+		CandidateZ.Add(0.0f);
+		CandidateRadiusSq.Add(-1.0f);
+	}
+
+	TArray<uint8, TInlineAllocator<64>> Masks;
+	Masks.SetNumUninitialized(NumLanes / 4);
+
+	ShooterSight::ConeTest(Listener.CachedLocation, Listener.CachedDirection, SightListener.CosHalfAngle,
+		CandidateX.GetData(), CandidateY.GetData(), CandidateZ.GetData(), CandidateRadiusSq.GetData(), NumLanes, Masks.GetData());
+
+	// queue a trace for everything inside the cone
+	for (int32 Candidate = 0; Candidate < NumCandidates; ++Candidate)
+	{
+		if ((Masks[Candidate / 4] & (1 << (Candidate % 4))) == 0)
+		{
+			continue;
+		}
+
+		AActor* Source = Sources[CandidateSources[Candidate]].Get();
+
+		FShooterSightPair& Pair = SightListener.Pairs.FindOrAdd(Source);
+		Pair.Target = Source;
+		Pair.LastConeUpdate = UpdateCounter;
+
+		// closer targets first, then ones in sight, and anything left waiting catches up over a few updates
+		const float DistSq = FVector::DistSquared(Listener.CachedLocation, Source->GetActorLocation());
+		const uint32 WaitUpdates = Pair.LastTraceUpdate == 0 ? ShooterSight::MaxWaitUpdates : FMath::Min(UpdateCounter - Pair.LastTraceUpdate, ShooterSight::MaxWaitUpdates);
+
+		FShooterSightTraceRequest& Request = TraceRequests.AddDefaulted_GetRef();
+		Request.ListenerId = Listener.GetListenerID();
+		Request.TargetKey = Source;
+		Request.Priority = DistSq * (Pair.bSeen ? SeenTargetPriorityScale : 1.0f) / FMath::Square(1.0f + WaitUpdates);
+	}
+
+	// anything that left the cone, the lose sight radius or the world is out of sight without needing a trace
+	for (auto It = SightListener.Pairs.CreateIterator(); It; ++It)
+	{
+		FShooterSightPair& Pair = It.Value();
+
+		if (Pair.LastConeUpdate == UpdateCounter)
+		{
+			continue;
+		}
+
+		if (Pair.bSeen)
+		{
+			ReportSight(Listener, Pair.Target.Get(), false);
+		}
+
+		It.RemoveCurrent();
+	}
+}
+
+void UAISense_ShooterSight::ProcessTraces()
+{
+	const int32 NumTraces = FMath::Min(TraceRequests.Num(), MaxTracesPerUpdate);
+
+	SET_DWORD_STAT(STAT_ShooterSightTraces, NumTraces);
+	SET_DWORD_STAT(STAT_ShooterSightTracesDeferred, TraceRequests.Num() - NumTraces);
+
+	if (NumTraces == 0)
+	{
+		return;
+	}
+
+	// the budget goes to the highest priority requests
+	if (NumTraces < TraceRequests.Num())
+	{
+		TraceRequests.Sort([](const FShooterSightTraceRequest& A, const FShooterSightTraceRequest& B) { return A.Priority < B.Priority; });
+	}
+
+	AIPerception::FListenerMap& ListenersMap = *GetListeners();
+	UWorld* World = GetWorld();
+
+	for (int32 RequestIndex = 0; RequestIndex < NumTraces; ++RequestIndex)
+	{
+		const FShooterSightTraceRequest& Request = TraceRequests[RequestIndex];
+
+		FPerceptionListener* Listener = ListenersMap.Find(Request.ListenerId);
+		FShooterSightListener* SightListener = SightListeners.Find(Request.ListenerId);
+		FShooterSightPair* Pair = SightListener ? SightListener->Pairs.Find(Request.TargetKey) : nullptr;
+		AActor* Target = Pair ? Pair->Target.Get() : nullptr;
+
+		if (!Listener || !Target)
+		{
+			continue;
+		}
+
+		Pair->LastTraceUpdate = UpdateCounter;
+
+		// run a line trace between the listener's eyes and the target
+		FCollisionQueryParams QueryParams;
+		QueryParams.AddIgnoredActor(Listener->GetBodyActor());
+		QueryParams.AddIgnoredActor(Target);
+
+		FHitResult OutHit;
+
+		const bool bSeen = !World->LineTraceSingleByChannel(OutHit, Listener->CachedLocation, Target->GetActorLocation(), ECC_Visibility, QueryParams);
+
+		// only changes are reported
+		if (bSeen != Pair->bSeen)
+		{
+			Pair->bSeen = bSeen;
+			ReportSight(*Listener, Target, bSeen);
+		}
+	}
+}
+
+void UAISense_ShooterSight::ReportSight(FPerceptionListener& Listener, AActor* Target, bool bSeen) const
+{
+	if (!Target)
+	{
+		return;
+	}
+
+	// lost sight carries no strength, like the engine sight sense, so strength based consumers don't treat it as a sighting
+	Listener.RegisterStimulus(Target, FAIStimulus(*this, bSeen ? 1.0f : 0.0f, Target->GetActorLocation(), Listener.CachedLocation, bSeen ? FAIStimulus::SensingSucceeded : FAIStimulus::SensingFailed));
+}
+
+FIntPoint UAISense_ShooterSight::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
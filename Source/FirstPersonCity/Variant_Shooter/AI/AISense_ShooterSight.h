@@ -0,0 +1,196 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Perception/AISense.h"
+#include "Perception/AISenseConfig.h"
+#include "UObject/ObjectKey.h"
+#include "AISense_ShooterSight.generated.h"
+
+class UAISense_ShooterSight;
+
+/**
+ *  Configures a perception component's shooter sight sense
+ */
+UCLASS(meta = (DisplayName = "AI Shooter Sight config"))
+class FIRSTPERSONCITY_API UAISenseConfig_ShooterSight : public UAISenseConfig
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Sense implementation */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Sense", NoClear, config)
+	TSubclassOf<UAISense_ShooterSight> Implementation;
+
+	/** Max distance an unseen target can be spotted from */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config, meta = (UIMin = 0.0, ClampMin = 0.0, Units = "Centimeters"))
+	float SightRadius = 3000.0f;
+
+	/** Max distance a seen target stays in sight. Should be larger than SightRadius */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config, meta = (UIMin = 0.0, ClampMin = 0.0, Units = "Centimeters"))
+	float LoseSightRadius = 3500.0f;
+
+	/** Half angle of the vision cone */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config, meta = (UIMin = 0.0, ClampMin = 0.0, UIMax = 180.0, ClampMax = 180.0, Units = "Degrees"))
+	float PeripheralVisionAngleDegrees = 90.0f;
+
+	/** Only actors with this tag are looked for, so NPCs never spend time on their own team */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config)
+	FName TargetTag = FName("Player");
+
+	/** Constructor */
+	UAISenseConfig_ShooterSight(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Returns the sense this config drives */
+	virtual TSubclassOf<UAISense> GetSenseImplementation() const override;
+};
+
+/**
+ *  Sight state of a single listener and target pair
+ */
+struct FShooterSightPair
+{
+	/** Target actor */
+	TWeakObjectPtr<AActor> Target;
+
+	/** True if the last trace found the target in sight */
+	bool bSeen = false;
+
+	/** Update the pair was last found inside the vision cone */
+	uint32 LastConeUpdate = 0;
+
+	/** Update the pair was last traced, or 0 if it never was */
+	uint32 LastTraceUpdate = 0;
+};
+
+/**
+ *  A perception listener using the shooter sight sense
+ */
+struct FShooterSightListener
+{
+	/** Max distance an unseen target can be spotted from, squared */
+	float SightRadiusSq = 0.0f;
+
+	/** Max distance a seen target stays in sight, squared */
+	float LoseSightRadiusSq = 0.0f;
+
+	/** Cosine of the vision cone half angle */
+	float CosHalfAngle = 0.0f;
+
+	/** Tag targets must have */
+	FName TargetTag;
+
+	/** Sight state of each target the listener has found in its cone */
+	TMap<TObjectKey<AActor>, FShooterSightPair> Pairs;
+};
+
+/**
+ *  A listener and target pair waiting for a line of sight trace
+ */
+struct FShooterSightTraceRequest
+{
+	/** Listener doing the looking */
+	FPerceptionListenerID ListenerId;
+
+	/** Key of the pair in the listener's pairs */
+	TObjectKey<AActor> TargetKey;
+
+	/** Lower values are traced first */
+	float Priority;
+};
+
+/**
+ *  Lightweight sight sense for shooter NPCs
+ *  Targets are bucketed by tag into a 2D grid each update, so a listener only considers nearby actors it would actually hunt.
+ *  Candidates are cone tested four at a time with vector math, and the line of sight traces the cone test lets through share a
+ *  global per update budget, closest, currently seen and longest waiting pairs first. Stimuli are registered just like the
+ *  engine sight sense's, so perception components report them through OnTargetPerceptionUpdated as usual
+ */
+UCLASS(ClassGroup=AI, Config=Game)
+class FIRSTPERSONCITY_API UAISense_ShooterSight : public UAISense
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Size of the target grid cells */
+	UPROPERTY(Config)
+	float CellSize = 2000.0f;
+
+	/** Max line of sight traces per update, across every listener */
+	UPROPERTY(Config)
+	int32 MaxTracesPerUpdate = 32;
+
+	/** Priority scale for targets the listener is currently seeing, so losing sight of a threat is noticed first */
+	UPROPERTY(Config)
+	float SeenTargetPriorityScale = 0.25f;
+
+	/** Listeners using this sense */
+	TMap<FPerceptionListenerID, FShooterSightListener> SightListeners;
+
+	/** Actors that can be seen */
+	TArray<TWeakObjectPtr<AActor>> Sources;
+
+	/** Source indices in each occupied grid cell, by target tag. Rebuilt every update */
+	TMap<FName, TMap<FIntPoint, TArray<int32>>> TargetGrids;
+
+	/** Pairs waiting for a trace this update */
+	TArray<FShooterSightTraceRequest> TraceRequests;
+
+	/** Candidate positions and radii for the vectorised cone test, padded to a multiple of four */
+	TArray<float, TAlignedHeapAllocator<16>> CandidateX;
+	TArray<float, TAlignedHeapAllocator<16>> CandidateY;
+	TArray<float, TAlignedHeapAllocator<16>> CandidateZ;
+	TArray<float, TAlignedHeapAllocator<16>> CandidateRadiusSq;
+
+	/** Source indices of the gathered candidates */
+	TArray<int32> CandidateSources;
+
+	/** Number of updates so far. Starts at one so zero can mean never */
+	uint32 UpdateCounter = 1;
+
+public:
+
+	/** Constructor */
+	UAISense_ShooterSight(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	//~Begin UAISense interface
+	virtual void RegisterSource(AActor& SourceActor) override;
+	virtual void UnregisterSource(AActor& SourceActor) override;
+	//~End UAISense interface
+
+protected:
+
+	//~Begin UAISense interface
+	virtual float Update() override;
+	//~End UAISense interface
+
+	/** Caches a new listener's settings */
+	void OnNewListenerImpl(const FPerceptionListener& NewListener);
+
+	/** Refreshes a listener's settings, or drops it if it no longer uses this sense */
+	void OnListenerUpdateImpl(const FPerceptionListener& UpdatedListener);
+
+	/** Forgets a removed listener */
+	void OnListenerRemovedImpl(const FPerceptionListener& RemovedListener);
+
+	/** Reads a listener's sense config into its cached settings */
+	void ConfigureListener(const FPerceptionListener& Listener, FShooterSightListener& SightListener) const;
+
+	/** Buckets every source into the grids of the tags listeners are looking for */
+	void RebuildGrids();
+
+	/** Cone tests the targets around a listener, queueing traces for the ones inside and losing sight of the ones outside */
+	void GatherCandidates(FPerceptionListener& Listener, FShooterSightListener& SightListener);
+
+	/** Runs the highest priority traces within the budget */
+	void ProcessTraces();
+
+	/** Registers a sight gained or lost stimulus on a listener */
+	void ReportSight(FPerceptionListener& Listener, AActor* Target, bool bSeen) const;
+
+	/** Returns the grid cell a location falls in */
+	FIntPoint GetCell(const FVector& Location) const;
+};
@@ -7,6 +7,9 @@
 #include "Perception/AIPerceptionComponent.h"
 #include "Navigation/PathFollowingComponent.h"
 #include "AI/Navigation/PathFollowingAgentInterface.h"
+#include "Engine/World.h"
+#include "ShooterFrameBudget.h"
+#include "ShooterSquadSubsystem.h"
 
 AShooterAIController::AShooterAIController()
 {
@@ -33,9 +36,29 @@ void AShooterAIController::OnPossess(APawn* InPawn)
 
 		// subscribe to the pawn's OnDeath delegate
 		NPC->OnPawnDeath.AddDynamic(this, &AShooterAIController::OnPawnDeath);
+
+		// join the team's squad
+		if (UShooterSquadSubsystem* Squad = GetWorld()->GetSubsystem<UShooterSquadSubsystem>())
+		{
+			Squad->RegisterMember(this, TeamTag);
+		}
 	}
 }
 
+void AShooterAIController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// fold this frame's perception events into the snapshot
+	if (PendingPerceptions.Num() > 0)
+	{
+		UpdatePerceptionSnapshot();
+	}
+
+	// pick up what the rest of the squad knows
+	SyncSquadKnowledge();
+}
+
 void AShooterAIController::OnPawnDeath()
 {
 	// stop movement
@@ -44,6 +67,12 @@ void AShooterAIController::OnPawnDeath()
 	// stop StateTree logic
 	StateTreeAI->StopLogic(FString(""));
 
+	// leave the squad
+	if (UShooterSquadSubsystem* Squad = GetWorld()->GetSubsystem<UShooterSquadSubsystem>())
+	{
+		Squad->UnregisterMember(this, TeamTag);
+	}
+
 	// unpossess the pawn
 	UnPossess();
 
@@ -61,14 +90,217 @@ void AShooterAIController::ClearCurrentTarget()
 	TargetEnemy = nullptr;
 }
 
+void AShooterAIController::ClearInvestigateLocation()
+{
+	PerceptionSnapshot.bHasInvestigateLocation = false;
+	PerceptionSnapshot.StimulusStrength = 0.0f;
+}
+
+void AShooterAIController::SetPerceptionSettings(FName InSenseTag, float InDirectLineOfSightCone)
+{
+	SenseTag = InSenseTag;
+	DirectLineOfSightCone = FMath::Clamp(InDirectLineOfSightCone, 0.0f, 180.0f);
+}
+
+bool AShooterAIController::IsSensing(const AActor* Actor) const
+{
+	if (!Actor)
+	{
+		return false;
+	}
+
+	const FActorPerceptionInfo* Info = AIPerception->GetActorInfo(*Actor);
+
+	return Info && Info->HasAnyCurrentStimulus();
+}
+
 void AShooterAIController::OnPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus)
 {
-	// pass the data to the StateTree delegate hook
-	OnShooterPerceptionUpdated.ExecuteIfBound(Actor, Stimulus);
+	// only the latest event for each actor matters, so replace any earlier one from this frame
+	FShooterPendingPerception* Pending = PendingPerceptions.FindByPredicate([Actor](const FShooterPendingPerception& Entry) { return Entry.Actor == Actor; });
+
+	if (!Pending)
+	{
+		Pending = &PendingPerceptions.AddDefaulted_GetRef();
+		Pending->Actor = Actor;
+	}
+
+	Pending->Location = Stimulus.StimulusLocation;
+	Pending->Strength = Stimulus.Strength;
+	Pending->bForgotten = false;
 }
 
 void AShooterAIController::OnPerceptionForgotten(AActor* Actor)
 {
-	// pass the data to the StateTree delegate hook
-	OnShooterPerceptionForgotten.ExecuteIfBound(Actor);
+	// a forget supersedes anything else sensed about the actor this frame
+	FShooterPendingPerception* Pending = PendingPerceptions.FindByPredicate([Actor](const FShooterPendingPerception& Entry) { return Entry.Actor == Actor; });
+
+	if (!Pending)
+	{
+		Pending = &PendingPerceptions.AddDefaulted_GetRef();
+		Pending->Actor = Actor;
+	}
+
+	Pending->Location = FVector::ZeroVector;
+	Pending->Strength = 0.0f;
+	Pending->bForgotten = true;
+}
+
+void AShooterAIController::UpdatePerceptionSnapshot()
+{
+	SHOOTER_BUDGET_SCOPE(AI);
+
+	FShooterPerceptionSnapshot& Snapshot = PerceptionSnapshot;
+	UShooterSquadSubsystem* Squad = GetWorld()->GetSubsystem<UShooterSquadSubsystem>();
+
+	for (const FShooterPendingPerception& Pending : PendingPerceptions)
+	{
+		AActor* SensedActor = Pending.Actor.Get();
+
+		if (Pending.bForgotten)
+		{
+			// forget the actor if it's our target, or if we only had a partial sense
+			if (SensedActor == Snapshot.TargetActor || !IsValid(Snapshot.TargetActor))
+			{
+				// reset the snapshot
+				Snapshot = FShooterPerceptionSnapshot();
+				bSquadLineOfSight = false;
+
+				// clear the target and focus
+				ClearCurrentTarget();
+				ClearFocus(EAIFocusPriority::Gameplay);
+			}
+
+			continue;
+		}
+
+		// ignore anything we're not supposed to be hunting
+		if (!SensedActor || !SensedActor->ActorHasTag(SenseTag))
+		{
+			continue;
+		}
+
+		// trust the squad's spotter if it's seeing this actor. Otherwise check ourselves and tell the squad what we see
+		bool bDirectLOS = false;
+		bool bTrustedSquad = false;
+
+		if (Squad && !Squad->IsSpotter(this, TeamTag) && Squad->CanShareTarget(SensedActor, GetPawn(), TeamTag))
+		{
+			bDirectLOS = true;
+			bTrustedSquad = true;
+
+		} else {
+
+			bDirectLOS = HasDirectLineOfSight(SensedActor, Pending.Location);
+
+			if (bDirectLOS && Squad)
+			{
+				Squad->ReportSighting(TeamTag, SensedActor, SensedActor->GetActorLocation());
+			}
+		}
+
+		// check if we have a direct line of sight to the stimulus
+		if (bDirectLOS)
+		{
+			// set the controller's target
+			SetCurrentTarget(SensedActor);
+
+			// update the snapshot
+			Snapshot.TargetActor = SensedActor;
+			Snapshot.bHasTarget = true;
+			Snapshot.bHasInvestigateLocation = false;
+			Snapshot.bHasLineOfSight = true;
+			bSquadLineOfSight = bTrustedSquad;
+
+		// no direct line of sight to target
+		} else {
+
+			if (SensedActor == Snapshot.TargetActor)
+			{
+				Snapshot.bHasLineOfSight = false;
+				bSquadLineOfSight = false;
+			}
+
+			// if we already have a target, ignore the partial sense and keep on them.
+			// Otherwise investigate the strongest stimulus we've had
+			if (!IsValid(Snapshot.TargetActor) && Pending.Strength > Snapshot.StimulusStrength)
+			{
+				Snapshot.StimulusStrength = Pending.Strength;
+				Snapshot.InvestigateLocation = Pending.Location;
+				Snapshot.bHasInvestigateLocation = true;
+			}
+		}
+	}
+
+	PendingPerceptions.Reset();
+}
+
+bool AShooterAIController::HasDirectLineOfSight(const AActor* SensedActor, const FVector& StimulusLocation) const
+{
+	const APawn* SensingPawn = GetPawn();
+
+	if (!SensingPawn)
+	{
+		return false;
+	}
+
+	// calculate the direction of the stimulus
+	const FVector StimulusDir = (StimulusLocation - SensingPawn->GetActorLocation()).GetSafeNormal();
+
+	// infer the angle from the dot product between the pawn facing and the stimulus direction
+	const float DirDot = FVector::DotProduct(StimulusDir, SensingPawn->GetActorForwardVector());
+	const float MaxDot = FMath::Cos(FMath::DegreesToRadians(DirectLineOfSightCone));
+
+	// is the direction outside our perception cone?
+	if (DirDot < MaxDot)
+	{
+		return false;
+	}
+
+	// run a line trace between the pawn and the sensed actor
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(SensingPawn);
+	QueryParams.AddIgnoredActor(SensedActor);
+
+	FHitResult OutHit;
+
+	// we have direct line of sight if this trace is unobstructed
+	return !GetWorld()->LineTraceSingleByChannel(OutHit, SensingPawn->GetActorLocation(), SensedActor->GetActorLocation(), ECC_Visibility, QueryParams);
+}
+
+void AShooterAIController::SyncSquadKnowledge()
+{
+	const UShooterSquadSubsystem* Squad = GetWorld()->GetSubsystem<UShooterSquadSubsystem>();
+	const FShooterSquadKnowledge* Knowledge = Squad ? Squad->GetKnowledge(TeamTag) : nullptr;
+
+	if (!Knowledge)
+	{
+		return;
+	}
+
+	AActor* SquadTarget = Knowledge->Target.Get();
+	FShooterPerceptionSnapshot& Snapshot = PerceptionSnapshot;
+
+	// follow the spotter's line of sight on a target we share, unless we traced it ourselves
+	if (SquadTarget && SquadTarget == Snapshot.TargetActor)
+	{
+		if (bSquadLineOfSight)
+		{
+			Snapshot.bHasLineOfSight = Knowledge->bHasLineOfSight;
+		}
+
+		return;
+	}
+
+	// pick up the squad's target if we're not hunting anything ourselves
+	if (!IsValid(Snapshot.TargetActor) && Squad->CanShareTarget(SquadTarget, GetPawn(), TeamTag))
+	{
+		SetCurrentTarget(SquadTarget);
+
+		Snapshot.TargetActor = SquadTarget;
+		Snapshot.bHasTarget = true;
+		Snapshot.bHasInvestigateLocation = false;
+		Snapshot.bHasLineOfSight = true;
+		bSquadLineOfSight = true;
+	}
 }
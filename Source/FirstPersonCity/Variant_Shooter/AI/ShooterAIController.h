@@ -10,8 +10,57 @@ class UStateTreeAIComponent;
 class UAIPerceptionComponent;
 struct FAIStimulus;
 
-DECLARE_DELEGATE_TwoParams(FShooterPerceptionUpdatedDelegate, AActor*, const FAIStimulus&);
-DECLARE_DELEGATE_OneParam(FShooterPerceptionForgottenDelegate, AActor*);
+/**
+ *  What an NPC currently knows about its enemies
+ *  Updated once per frame by the AI controller from the perception events it received, and read by StateTree nodes
+ */
+USTRUCT(BlueprintType)
+struct FShooterPerceptionSnapshot
+{
+	GENERATED_BODY()
+
+	/** Sensed enemy to target */
+	UPROPERTY(BlueprintReadOnly, Category="Perception")
+	TObjectPtr<AActor> TargetActor;
+
+	/** Location of the strongest partial sense to investigate */
+	UPROPERTY(BlueprintReadOnly, Category="Perception")
+	FVector InvestigateLocation = FVector::ZeroVector;
+
+	/** Strength of the stimulus behind the investigate location */
+	UPROPERTY(BlueprintReadOnly, Category="Perception")
+	float StimulusStrength = 0.0f;
+
+	/** True if a target was successfully sensed */
+	UPROPERTY(BlueprintReadOnly, Category="Perception")
+	bool bHasTarget = false;
+
+	/** True if an investigate location was successfully sensed */
+	UPROPERTY(BlueprintReadOnly, Category="Perception")
+	bool bHasInvestigateLocation = false;
+
+	/** True if the last check on the target, by this NPC or its squad's spotter, found direct line of sight */
+	UPROPERTY(BlueprintReadOnly, Category="Perception")
+	bool bHasLineOfSight = false;
+};
+
+/**
+ *  A perception event waiting for the controller's next update
+ */
+struct FShooterPendingPerception
+{
+	/** Actor the event is about */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Stimulus location */
+	FVector Location;
+
+	/** Stimulus strength */
+	float Strength;
+
+	/** If true, the actor was forgotten instead of sensed */
+	bool bForgotten;
+};
 
 /**
  *  Simple AI Controller for a first person shooter enemy
@@ -35,16 +84,26 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Shooter")
 	FName TeamTag = FName("Enemy");
 
+	/** Tag required on sensed actors. Replaced by the StateTree's Sense Enemies task when its state is entered */
+	UPROPERTY(EditAnywhere, Category="Shooter|Perception")
+	FName SenseTag = FName("Player");
+
+	/** Line of sight cone half angle to consider a full sense. Replaced by the StateTree's Sense Enemies task when its state is entered */
+	UPROPERTY(EditAnywhere, Category="Shooter|Perception", meta = (ClampMin = 0, ClampMax = 180, Units = "Degrees"))
+	float DirectLineOfSightCone = 85.0f;
+
 	/** Enemy currently being targeted */
 	TObjectPtr<AActor> TargetEnemy;
 
-public:
+	/** Current perception state, read by the StateTree */
+	UPROPERTY(Transient)
+	FShooterPerceptionSnapshot PerceptionSnapshot;
 
-	/** Called when an AI perception has been updated. StateTree task delegate hook */
-	FShooterPerceptionUpdatedDelegate OnShooterPerceptionUpdated;
+	/** Perception events received since the last update */
+	TArray<FShooterPendingPerception> PendingPerceptions;
 
-	/** Called when an AI perception has been forgotten. StateTree task delegate hook */
-	FShooterPerceptionForgottenDelegate OnShooterPerceptionForgotten;
+	/** If true, the snapshot's line of sight on the target came from the squad's spotter instead of our own trace */
+	bool bSquadLineOfSight = false;
 
 public:
 
@@ -56,6 +115,9 @@ protected:
 	/** Pawn initialization */
 	virtual void OnPossess(APawn* InPawn) override;
 
+	/** Updates the perception snapshot */
+	virtual void Tick(float DeltaTime) override;
+
 protected:
 
 	/** Called when the possessed pawn dies */
@@ -73,6 +135,18 @@ public:
 	/** Returns the targeted enemy */
 	AActor* GetCurrentTarget() const { return TargetEnemy; };
 
+	/** Returns the current perception state */
+	const FShooterPerceptionSnapshot& GetPerceptionSnapshot() const { return PerceptionSnapshot; }
+
+	/** Drops the investigate location so a new one can be sensed. Called once the NPC starts looking for a new target */
+	void ClearInvestigateLocation();
+
+	/** Sets the tag required on sensed actors and the line of sight cone. Pushed by the StateTree's Sense Enemies task */
+	void SetPerceptionSettings(FName InSenseTag, float InDirectLineOfSightCone);
+
+	/** Returns true if our own perception currently has an active stimulus from the actor */
+	bool IsSensing(const AActor* Actor) const;
+
 protected:
 
 	/** Called when the AI perception component updates a perception on a given actor */
@@ -82,4 +156,13 @@ protected:
 	/** Called when the AI perception component forgets a given actor */
 	UFUNCTION()
 	void OnPerceptionForgotten(AActor* Actor);
+
+	/** Processes the pending perception events into the snapshot */
+	void UpdatePerceptionSnapshot();
+
+	/** Returns true if the pawn can see the sensed actor directly, without any partial sense */
+	bool HasDirectLineOfSight(const AActor* SensedActor, const FVector& StimulusLocation) const;
+
+	/** Picks up the squad's target if we don't have one, and follows the spotter's line of sight on a target we didn't check ourselves */
+	void SyncSquadKnowledge();
 };
@@ -0,0 +1,179 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterEQSCacheSubsystem.h"
+#include "ShooterAIController.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "EnvironmentQuery/EnvQueryManager.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+#include "ShooterFrameBudget.h"
+
+DECLARE_CYCLE_STAT(TEXT("EQS Cache Update"), STAT_ShooterEQSCacheUpdate, STATGROUP_FirstPersonCity);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("EQS Query Time (ms)"), STAT_ShooterEQSQueryTime, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Queries Run"), STAT_ShooterEQSQueriesRun, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Queries Deferred"), STAT_ShooterEQSQueriesDeferred, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Cache Entries"), STAT_ShooterEQSCacheEntries, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EQS Cache Hits"), STAT_ShooterEQSCacheHits, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EQS Cache Misses"), STAT_ShooterEQSCacheMisses, STATGROUP_FirstPersonCity);
+
+bool UShooterEQSCacheSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UShooterEQSCacheSubsystem::IsTickable() const
+{
+	return Queue.Num() > 0 || Entries.Num() > 0;
+}
+
+void UShooterEQSCacheSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterEQSCacheUpdate);
+	SHOOTER_BUDGET_SCOPE(AI);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	// drop results that went stale. Queued entries stay until their query runs
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().bPending && Time - It.Value().Time > CacheTime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// run queued queries until the frame's budget is spent
+	const double StartTime = FPlatformTime::Seconds();
+	const double BudgetSeconds = BudgetMs * 0.001;
+
+	int32 NumRun = 0;
+
+	while (NumRun < Queue.Num())
+	{
+		if (NumRun > 0 && FPlatformTime::Seconds() - StartTime >= BudgetSeconds)
+		{
+			break;
+		}
+
+		RunQuery(Queue[NumRun]);
+		++NumRun;
+	}
+
+	Queue.RemoveAt(0, NumRun, EAllowShrinking::No);
+
+	SET_FLOAT_STAT(STAT_ShooterEQSQueryTime, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	SET_DWORD_STAT(STAT_ShooterEQSQueriesRun, NumRun);
+	SET_DWORD_STAT(STAT_ShooterEQSQueriesDeferred, Queue.Num());
+	SET_DWORD_STAT(STAT_ShooterEQSCacheEntries, Entries.Num());
+}
+
+TStatId UShooterEQSCacheSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterEQSCacheSubsystem, STATGROUP_Tickables);
+}
+
+EShooterEQSCacheResult UShooterEQSCacheSubsystem::RequestLocation(UEnvQuery* Query, AShooterAIController* Querier, FVector& OutLocation)
+{
+	check(Query && Querier);
+
+	// queries run around the controller's target. Without one, the target context falls back to the controller itself
+	AActor* Target = Querier->GetCurrentTarget();
+
+	if (!IsValid(Target))
+	{
+		Target = Querier;
+	}
+
+	// queries also score distance and visibility from the querier, so only queriers in the same cell can share a result
+	const FVector QuerierLocation = Querier->GetPawn() ? Querier->GetPawn()->GetActorLocation() : Querier->GetActorLocation();
+	const FVector TargetLocation = Target == Querier ? QuerierLocation : Target->GetActorLocation();
+
+	FShooterEQSCacheKey Key;
+	Key.Query = Query;
+	Key.Target = Target;
+	Key.Cell = GetCell(TargetLocation);
+	Key.QuerierCell = GetCell(QuerierLocation);
+
+	// share any result for the same query around the same spot, asked from the same spot
+	if (FShooterEQSCacheEntry* Entry = Entries.Find(Key))
+	{
+		if (Entry->bPending)
+		{
+			return EShooterEQSCacheResult::Pending;
+		}
+
+		INC_DWORD_STAT(STAT_ShooterEQSCacheHits);
+
+		if (Entry->Locations.Num() == 0)
+		{
+			return EShooterEQSCacheResult::Failed;
+		}
+
+		// hand out the locations in turn so NPCs don't all pick the same one
+		OutLocation = Entry->Locations[Entry->NextLocation % Entry->Locations.Num()];
+		++Entry->NextLocation;
+
+		return EShooterEQSCacheResult::Ready;
+	}
+
+	INC_DWORD_STAT(STAT_ShooterEQSCacheMisses);
+
+	// queue the query for the next frame with budget left
+	Entries.Add(Key);
+
+	FShooterEQSQueuedQuery& Queued = Queue.AddDefaulted_GetRef();
+	Queued.Key = Key;
+	Queued.Query = Query;
+	Queued.Querier = Querier;
+
+	return EShooterEQSCacheResult::Pending;
+}
+
+void UShooterEQSCacheSubsystem::RunQuery(const FShooterEQSQueuedQuery& Queued)
+{
+	FShooterEQSCacheEntry* Entry = Entries.Find(Queued.Key);
+
+	if (!Entry)
+	{
+		return;
+	}
+
+	UEnvQuery* Query = Queued.Query.Get();
+	AShooterAIController* Querier = Queued.Querier.Get();
+	UEnvQueryManager* QueryManager = UEnvQueryManager::GetCurrent(GetWorld());
+
+	// the requester left before the query could run, so drop the entry and let the next request queue it again
+	if (!Query || !Querier || !QueryManager)
+	{
+		Entries.Remove(Queued.Key);
+		return;
+	}
+
+	Entry->bPending = false;
+	Entry->Time = GetWorld()->GetTimeSeconds();
+
+	// run the query to completion. The manager's own time slicing would spread it over frames we've already budgeted
+	FEnvQueryRequest Request(Query, Querier);
+	const TSharedPtr<FEnvQueryResult> Result = QueryManager->RunInstantQuery(Request, EEnvQueryRunMode::AllMatching);
+
+	if (!Result.IsValid() || !Result->IsSuccessful())
+	{
+		return;
+	}
+
+	// keep the best scoring locations. All matching results come sorted by score
+	const int32 NumLocations = FMath::Min(Result->Items.Num(), MaxSharedLocations);
+	Entry->Locations.Reserve(NumLocations);
+
+	for (int32 ItemIndex = 0; ItemIndex < NumLocations; ++ItemIndex)
+	{
+		Entry->Locations.Add(Result->GetItemAsLocation(ItemIndex));
+	}
+}
+
+FIntVector UShooterEQSCacheSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize), FMath::FloorToInt32(Location.Z / CellSize));
+}
@@ -0,0 +1,144 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterEQSCacheSubsystem.generated.h"
+
+class UEnvQuery;
+class AShooterAIController;
+
+/**
+ *  State of a cached EQS query request
+ */
+enum class EShooterEQSCacheResult : uint8
+{
+	/** The query hasn't run yet. Ask again next frame */
+	Pending,
+
+	/** A location is available */
+	Ready,
+
+	/** The query ran and found nothing */
+	Failed
+};
+
+/**
+ *  Identifies queries whose results can be shared: same template, same target, target in the same grid cell
+ *  and querier in the same grid cell. Queries score around the querier too, so NPCs far apart never share a result
+ */
+struct FShooterEQSCacheKey
+{
+	/** Query template */
+	TObjectKey<UEnvQuery> Query;
+
+	/** Actor the query is run around */
+	TObjectKey<AActor> Target;
+
+	/** Grid cell the target was in */
+	FIntVector Cell;
+
+	/** Grid cell the querier's pawn was in */
+	FIntVector QuerierCell;
+
+	bool operator==(const FShooterEQSCacheKey& Other) const
+	{
+		return Query == Other.Query && Target == Other.Target && Cell == Other.Cell && QuerierCell == Other.QuerierCell;
+	}
+
+	friend uint32 GetTypeHash(const FShooterEQSCacheKey& Key)
+	{
+		return HashCombine(HashCombine(HashCombine(GetTypeHash(Key.Query), GetTypeHash(Key.Target)), GetTypeHash(Key.Cell)), GetTypeHash(Key.QuerierCell));
+	}
+};
+
+/**
+ *  Results of a shared query
+ */
+struct FShooterEQSCacheEntry
+{
+	/** Best scoring locations, best first */
+	TArray<FVector> Locations;
+
+	/** World time the query ran */
+	double Time = 0.0;
+
+	/** Index of the next location to hand out, so NPCs sharing the result spread over it */
+	int32 NextLocation = 0;
+
+	/** If true, the query is queued and has no results yet */
+	bool bPending = true;
+};
+
+/**
+ *  A query waiting for frame budget
+ */
+struct FShooterEQSQueuedQuery
+{
+	/** Cache entry the results go to */
+	FShooterEQSCacheKey Key;
+
+	/** Query template */
+	TWeakObjectPtr<UEnvQuery> Query;
+
+	/** Controller the query is run for */
+	TWeakObjectPtr<AShooterAIController> Querier;
+};
+
+/**
+ *  Runs the shooter AI's EQS queries within a per frame time budget, and shares their results between NPCs
+ *  Results are cached per query template, target, target grid cell and querier grid cell for a short time, so nearby NPCs
+ *  repositioning around the same player reuse one query and get handed different locations from it. Queries that miss the cache are queued and run
+ *  to completion only while the frame's EQS budget lasts
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterEQSCacheSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Size of the grid cells target locations are bucketed into */
+	UPROPERTY(Config)
+	float CellSize = 300.0f;
+
+	/** Time a query result stays valid */
+	UPROPERTY(Config)
+	float CacheTime = 0.5f;
+
+	/** Time per frame allowed for running queries, in milliseconds. At least one query runs every frame */
+	UPROPERTY(Config)
+	float BudgetMs = 1.0f;
+
+	/** Number of best scoring locations kept from each query to hand out */
+	UPROPERTY(Config)
+	int32 MaxSharedLocations = 8;
+
+	/** Cached and pending query results */
+	TMap<FShooterEQSCacheKey, FShooterEQSCacheEntry> Entries;
+
+	/** Queries waiting to run, oldest first */
+	TArray<FShooterEQSQueuedQuery> Queue;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Returns a location from the query's shared result for the controller's target, queueing the query if there's no fresh one */
+	EShooterEQSCacheResult RequestLocation(UEnvQuery* Query, AShooterAIController* Querier, FVector& OutLocation);
+
+protected:
+
+	/** Runs a queued query and stores its best locations */
+	void RunQuery(const FShooterEQSQueuedQuery& Queued);
+
+	/** Returns the grid cell a location falls in */
+	FIntVector GetCell(const FVector& Location) const;
+};
@@ -3,22 +3,32 @@
 
 #include "Variant_Shooter/AI/ShooterNPC.h"
 #include "ShooterWeapon.h"
+#include "ShooterSpreadPattern.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Camera/CameraComponent.h"
-#include "Kismet/KismetMathLibrary.h"
 #include "Engine/World.h"
 #include "ShooterGameMode.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "TimerManager.h"
 #include "Engine/Engine.h"
 #include "GameFramework/DamageType.h"
 #include "Engine/DamageEvents.h"
+#include "ShooterLagCompensationSubsystem.h"
+#include "ShooterPickupSubsystem.h"
+#include "ShooterRagdollBudgetSubsystem.h"
+#include "ShooterAllocationTracker.h"
+#include "ShooterFrameBudget.h"
 
 void AShooterNPC::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// the weapon is spawned on the server and replicated to clients
+	if (!HasAuthority())
+	{
+		return;
+	}
+
 	// spawn the weapon
 	FActorSpawnParameters SpawnParams;
 	SpawnParams.Owner = this;
@@ -26,18 +36,45 @@ void AShooterNPC::BeginPlay()
 	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
 	Weapon = GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, GetActorTransform(), SpawnParams);
+
+	// record our hitbox so the server can validate shots against it
+	if (UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+	{
+		LagCompensation->RegisterTarget(this, EShooterLagCompGroup::NPC);
+	}
+
+	// collect weapon pickups we walk over
+	if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+	{
+		PickupSubsystem->RegisterCollector(this);
+	}
 }
 
 void AShooterNPC::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
+	if (UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterTarget(this);
+	}
+
+	if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterCollector(this);
+	}
+
 	// clear the death timer
-	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Cancel(DeathTimer);
+	}
 }
 
 float AShooterNPC::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
+	SHOOTER_ALLOC_SCOPE(Damage);
+
 	// ignore if already dead
 	if (bIsDead)
 	{
@@ -173,6 +210,8 @@ void AShooterNPC::UpdateWeaponHUD(int32 CurrentAmmo, int32 MagazineSize)
 
 FVector AShooterNPC::GetWeaponTargetLocation()
 {
+	SHOOTER_BUDGET_SCOPE(AI);
+
 	// start aiming from the camera location
 	const FVector AimSource = GetFirstPersonCameraComponent()->GetComponentLocation();
 
@@ -189,13 +228,13 @@ FVector AShooterNPC::GetWeaponTargetLocation()
 
 		// get the aim direction and apply randomness in a cone
 		AimDir = (AimTarget - AimSource).GetSafeNormal();
-		AimDir = UKismetMathLibrary::RandomUnitVectorInConeInDegrees(AimDir, AimVarianceHalfAngle);
+		AimDir = ShooterSpread::RandomDirectionInCone(AimDir, AimVarianceHalfAngle);
 
 		
 	} else {
 
 		// no aim target, so just use the camera facing
-		AimDir = UKismetMathLibrary::RandomUnitVectorInConeInDegrees(GetFirstPersonCameraComponent()->GetForwardVector(), AimVarianceHalfAngle);
+		AimDir = ShooterSpread::RandomDirectionInCone(GetFirstPersonCameraComponent()->GetForwardVector(), AimVarianceHalfAngle);
 
 	}
 
@@ -239,8 +278,22 @@ void AShooterNPC::OnSemiWeaponRefire()
 	}
 }
 
+bool AShooterNPC::GetViewCorrection(FTransform& OutPosedView, FTransform& OutLatestView) const
+{
+	// NPCs aim from their posed view
+	return false;
+}
+
+float AShooterNPC::GetDamageResistance(const TSubclassOf<UDamageType>& DamageType) const
+{
+	const float* Resistance = DamageResistances.Find(DamageType);
+	return Resistance ? *Resistance : 0.0f;
+}
+
 void AShooterNPC::Die()
 {
+	SHOOTER_ALLOC_SCOPE(Death);
+
 	// ignore if already dead
 	if (bIsDead)
 	{
@@ -256,6 +309,35 @@ void AShooterNPC::Die()
 		GM->IncrementTeamScore(TeamByte);
 	}
 
+	// dead NPCs can't be hit anymore
+	if (UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterTarget(this);
+	}
+
+	// the dead don't collect pickups
+	if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterCollector(this);
+	}
+
+	// ragdoll on the server and all clients
+	MulticastRagdoll();
+
+	// schedule actor destruction
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Schedule<AShooterNPC, &AShooterNPC::DeferredDestruction>(DeathTimer, this, DeferredDestructionTime);
+	}
+}
+
+void AShooterNPC::MulticastRagdoll_Implementation()
+{
+	SHOOTER_ALLOC_SCOPE(Death);
+
+	// raise the dead flag on clients too
+	bIsDead = true;
+
 	// disable capsule collision
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
@@ -263,13 +345,17 @@ void AShooterNPC::Die()
 	GetCharacterMovement()->StopMovementImmediately();
 	GetCharacterMovement()->StopActiveMovement();
 
-	// enable ragdoll physics on the third person mesh
-	GetMesh()->SetCollisionProfileName(RagdollCollisionProfile);
-	GetMesh()->SetSimulatePhysics(true);
-	GetMesh()->SetPhysicsBlendWeight(1.0f);
+	// ragdoll the third person mesh, within the ragdoll budget
+	if (UShooterRagdollBudgetSubsystem* RagdollBudget = GetWorld()->GetSubsystem<UShooterRagdollBudgetSubsystem>())
+	{
+		RagdollBudget->RequestRagdoll(GetMesh(), RagdollCollisionProfile);
 
-	// schedule actor destruction
-	GetWorld()->GetTimerManager().SetTimer(DeathTimer, this, &AShooterNPC::DeferredDestruction, DeferredDestructionTime, false);
+	} else {
+
+		GetMesh()->SetCollisionProfileName(RagdollCollisionProfile);
+		GetMesh()->SetSimulatePhysics(true);
+		GetMesh()->SetPhysicsBlendWeight(1.0f);
+	}
 }
 
 void AShooterNPC::DeferredDestruction()
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "FirstPersonCityCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "ShooterDamageable.h"
+#include "ShooterLifetimeSubsystem.h"
 #include "ShooterNPC.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnDeathDelegate);
@@ -17,7 +19,7 @@ class AShooterWeapon;
  *  Holds and manages a weapon
  */
 UCLASS(abstract)
-class FIRSTPERSONCITY_API AShooterNPC : public AFirstPersonCityCharacter, public IShooterWeaponHolder
+class FIRSTPERSONCITY_API AShooterNPC : public AFirstPersonCityCharacter, public IShooterWeaponHolder, public IShooterDamageable
 {
 	GENERATED_BODY()
 
@@ -37,6 +39,10 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Damage")
 	float DeferredDestructionTime = 5.0f;
 
+	/** Fraction of damage ignored per damage type, from 0 to 1 */
+	UPROPERTY(EditAnywhere, Category="Damage")
+	TMap<TSubclassOf<UDamageType>, float> DamageResistances;
+
 	/** Team byte for this character */
 	UPROPERTY(EditAnywhere, Category="Team")
 	uint8 TeamByte = 1;
@@ -61,7 +67,7 @@ protected:
 	float AimRange = 10000.0f;
 
 	/** Cone variance to apply while aiming */
-	UPROPERTY(EditAnywhere, Category="Aim")
+	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 45, Units = "Degrees"))
 	float AimVarianceHalfAngle = 10.0f;
 
 	/** Minimum vertical offset from the target center to apply when aiming */
@@ -82,7 +88,7 @@ protected:
 	bool bIsDead = false;
 
 	/** Deferred destruction on death timer */
-	FTimerHandle DeathTimer;
+	FShooterLifetimeHandle DeathTimer;
 
 public:
 
@@ -133,18 +139,35 @@ public:
 	/** Notifies the owner that the weapon cooldown has expired and it's ready to shoot again */
 	virtual void OnSemiWeaponRefire() override;
 
+	/** Returns the view transform the weapon meshes were last posed with and the latest one from this frame's input */
+	virtual bool GetViewCorrection(FTransform& OutPosedView, FTransform& OutLatestView) const override;
+
 	//~End IShooterWeaponHolder interface
 
+	//~Begin IShooterDamageable interface
+
+	/** Returns the fraction of damage of the given type this character ignores */
+	virtual float GetDamageResistance(const TSubclassOf<UDamageType>& DamageType) const override;
+
+	//~End IShooterDamageable interface
+
 protected:
 
-	/** Called when HP is depleted and the character should die */
+	/** Called on the server when HP is depleted and the character should die */
 	void Die();
 
+	/** Disables collision and movement and requests a ragdoll from the ragdoll budget, on the server and all clients */
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastRagdoll();
+
 	/** Called after death to destroy the actor */
 	void DeferredDestruction();
 
 public:
 
+	/** Returns the team this character belongs to */
+	uint8 GetTeamByte() const { return TeamByte; }
+
 	/** Signals this character to start shooting at the passed actor */
 	void StartShooting(AActor* ActorToShoot);
 
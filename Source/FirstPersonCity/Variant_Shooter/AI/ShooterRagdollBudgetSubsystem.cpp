@@ -0,0 +1,148 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterRagdollBudgetSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ragdoll Budget Update"), STAT_ShooterRagdollBudget, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ragdolls Simulating"), STAT_ShooterRagdollsSimulating, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdolls Started"), STAT_ShooterRagdollsStarted, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdolls Skipped"), STAT_ShooterRagdollsSkipped, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdolls Settled"), STAT_ShooterRagdollsSettled, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdolls Evicted"), STAT_ShooterRagdollsEvicted, STATGROUP_FirstPersonCity);
+
+bool UShooterRagdollBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UShooterRagdollBudgetSubsystem::IsTickable() const
+{
+	return ActiveRagdolls.Num() > 0;
+}
+
+void UShooterRagdollBudgetSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterRagdollBudget);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	for (int32 RagdollIndex = ActiveRagdolls.Num() - 1; RagdollIndex >= 0; --RagdollIndex)
+	{
+		const FShooterActiveRagdoll& Ragdoll = ActiveRagdolls[RagdollIndex];
+		USkeletalMeshComponent* Mesh = Ragdoll.Mesh.Get();
+
+		// the owner was destroyed
+		if (!Mesh)
+		{
+			ActiveRagdolls.RemoveAt(RagdollIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		const double SimulationTime = Time - Ragdoll.StartTime;
+
+		if (SimulationTime < MinSimulationTime)
+		{
+			continue;
+		}
+
+		// freeze once the ragdoll comes to rest or runs out of time
+		const bool bSettled = Mesh->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(SettledSpeed);
+
+		if (bSettled || SimulationTime >= MaxSimulationTime)
+		{
+			FreezeRagdoll(Mesh);
+			ActiveRagdolls.RemoveAt(RagdollIndex, EAllowShrinking::No);
+
+			INC_DWORD_STAT(STAT_ShooterRagdollsSettled);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterRagdollsSimulating, ActiveRagdolls.Num());
+}
+
+TStatId UShooterRagdollBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterRagdollBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool UShooterRagdollBudgetSubsystem::RequestRagdoll(USkeletalMeshComponent* Mesh, FName CollisionProfile)
+{
+	check(Mesh);
+
+	// nobody's close enough to see it, so just hold the current pose
+	if (!IsSignificant(Mesh->GetComponentLocation()))
+	{
+		Mesh->bPauseAnims = true;
+
+		INC_DWORD_STAT(STAT_ShooterRagdollsSkipped);
+		return false;
+	}
+
+	// make room by freezing the oldest ragdoll
+	while (ActiveRagdolls.Num() >= FMath::Max(MaxSimulatingRagdolls, 1))
+	{
+		if (USkeletalMeshComponent* OldestMesh = ActiveRagdolls[0].Mesh.Get())
+		{
+			FreezeRagdoll(OldestMesh);
+
+			INC_DWORD_STAT(STAT_ShooterRagdollsEvicted);
+		}
+
+		ActiveRagdolls.RemoveAt(0, EAllowShrinking::No);
+	}
+
+	// enable ragdoll physics
+	Mesh->SetCollisionProfileName(CollisionProfile);
+	Mesh->SetSimulatePhysics(true);
+	Mesh->SetPhysicsBlendWeight(1.0f);
+
+	FShooterActiveRagdoll& Ragdoll = ActiveRagdolls.AddDefaulted_GetRef();
+	Ragdoll.Mesh = Mesh;
+	Ragdoll.StartTime = GetWorld()->GetTimeSeconds();
+
+	INC_DWORD_STAT(STAT_ShooterRagdollsStarted);
+	SET_DWORD_STAT(STAT_ShooterRagdollsSimulating, ActiveRagdolls.Num());
+
+	return true;
+}
+
+bool UShooterRagdollBudgetSubsystem::IsSignificant(const FVector& Location) const
+{
+	// check the distance to every local viewer. Dedicated servers have none, so they never ragdoll
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+
+		if (!PlayerController || !PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		if (FVector::DistSquared(ViewLocation, Location) <= FMath::Square(SignificanceRadius))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UShooterRagdollBudgetSubsystem::FreezeRagdoll(USkeletalMeshComponent* Mesh)
+{
+	// stop updating the skeleton so the last simulated pose is kept
+	Mesh->bNoSkeletonUpdate = true;
+	Mesh->SetComponentTickEnabled(false);
+
+	// then drop the physics bodies entirely
+	Mesh->PutAllRigidBodiesToSleep();
+	Mesh->SetSimulatePhysics(false);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+}
@@ -0,0 +1,80 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterRagdollBudgetSubsystem.generated.h"
+
+class USkeletalMeshComponent;
+
+/**
+ *  A ragdoll currently simulating under the budget
+ */
+struct FShooterActiveRagdoll
+{
+	/** Simulating mesh */
+	TWeakObjectPtr<USkeletalMeshComponent> Mesh;
+
+	/** World time the ragdoll started simulating */
+	double StartTime = 0.0;
+};
+
+/**
+ *  Caps the cost of death ragdolls
+ *  Only deaths close to a local viewer ragdoll at all, at most MaxSimulatingRagdolls simulate at once,
+ *  and ragdolls are frozen into a static pose once they settle, run out of time or get pushed out by newer ones
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterRagdollBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Max number of ragdolls simulating at the same time. The oldest one is frozen to make room */
+	UPROPERTY(Config)
+	int32 MaxSimulatingRagdolls = 8;
+
+	/** Max distance from a local viewer for a death to ragdoll */
+	UPROPERTY(Config)
+	float SignificanceRadius = 5000.0f;
+
+	/** Time a ragdoll always simulates before it can be considered settled */
+	UPROPERTY(Config)
+	float MinSimulationTime = 0.5f;
+
+	/** Max time a ragdoll simulates before it's frozen */
+	UPROPERTY(Config)
+	float MaxSimulationTime = 4.0f;
+
+	/** Speed under which a ragdoll's root body is considered settled */
+	UPROPERTY(Config)
+	float SettledSpeed = 15.0f;
+
+	/** Simulating ragdolls, oldest first */
+	TArray<FShooterActiveRagdoll> ActiveRagdolls;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Ragdolls a mesh if the budget allows it. Insignificant deaths just freeze in their current pose. Returns true if the mesh is ragdolling */
+	bool RequestRagdoll(USkeletalMeshComponent* Mesh, FName CollisionProfile);
+
+	/** Returns the number of ragdolls currently simulating */
+	int32 GetNumSimulatingRagdolls() const { return ActiveRagdolls.Num(); }
+
+protected:
+
+	/** Returns true if the location is close enough to a local viewer to be worth a ragdoll */
+	bool IsSignificant(const FVector& Location) const;
+
+	/** Stops simulating a ragdoll and holds its current pose */
+	static void FreezeRagdoll(USkeletalMeshComponent* Mesh);
+};
@@ -0,0 +1,222 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterSquadSubsystem.h"
+#include "ShooterAIController.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+#include "ShooterFrameBudget.h"
+
+DECLARE_CYCLE_STAT(TEXT("Squad Update"), STAT_ShooterSquadUpdate, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Squads"), STAT_ShooterSquads, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Squad LOS Traces"), STAT_ShooterSquadLOSTraces, STATGROUP_FirstPersonCity);
+
+bool UShooterSquadSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UShooterSquadSubsystem::IsTickable() const
+{
+	return Squads.Num() > 0;
+}
+
+void UShooterSquadSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterSquadUpdate);
+	SHOOTER_BUDGET_SCOPE(AI);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	for (auto It = Squads.CreateIterator(); It; ++It)
+	{
+		FShooterSquad& Squad = It.Value();
+
+		// drop members whose controllers are gone
+		Squad.Members.RemoveAll([](const TWeakObjectPtr<AShooterAIController>& Member) { return !Member.IsValid(); });
+
+		if (Squad.Members.Num() == 0)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// hand the spotter role to the next member
+		Squad.SpotterTime -= DeltaTime;
+
+		if (Squad.SpotterTime <= 0.0f || !Squad.Members.IsValidIndex(Squad.SpotterIndex))
+		{
+			RotateSpotter(Squad);
+			Squad.SpotterTime = SpotterRotationInterval;
+		}
+
+		FShooterSquadKnowledge& Knowledge = Squad.Knowledge;
+
+		// forget targets that are gone or haven't been seen in a while
+		if (!Knowledge.Target.IsValid() || Time - Knowledge.LastSeenTime > KnowledgeTimeout)
+		{
+			Knowledge = FShooterSquadKnowledge();
+			continue;
+		}
+
+		// check line of sight on the spotter's schedule
+		Squad.LineOfSightTime -= DeltaTime;
+
+		if (Squad.LineOfSightTime <= 0.0f)
+		{
+			UpdateLineOfSight(Squad, Time);
+			Squad.LineOfSightTime = LineOfSightInterval;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterSquads, Squads.Num());
+}
+
+TStatId UShooterSquadSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterSquadSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterSquadSubsystem::RegisterMember(AShooterAIController* Member, FName TeamTag)
+{
+	Squads.FindOrAdd(TeamTag).Members.AddUnique(Member);
+}
+
+void UShooterSquadSubsystem::UnregisterMember(AShooterAIController* Member, FName TeamTag)
+{
+	if (FShooterSquad* Squad = Squads.Find(TeamTag))
+	{
+		Squad->Members.Remove(Member);
+	}
+}
+
+void UShooterSquadSubsystem::ReportSighting(FName TeamTag, AActor* Target, const FVector& Location)
+{
+	FShooterSquad* Squad = Squads.Find(TeamTag);
+
+	if (!Squad)
+	{
+		return;
+	}
+
+	FShooterSquadKnowledge& Knowledge = Squad->Knowledge;
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	// keep hunting the current target while it's still being seen
+	if (Knowledge.Target.IsValid() && Knowledge.Target != Target && Time - Knowledge.LastSeenTime <= ShareTime)
+	{
+		return;
+	}
+
+	// a new target gets a spotter that can see it, and is checked straight away
+	if (Knowledge.Target != Target)
+	{
+		Squad->SpotterTime = 0.0f;
+		Squad->LineOfSightTime = 0.0f;
+	}
+
+	Knowledge.Target = Target;
+	Knowledge.LastKnownLocation = Location;
+	Knowledge.LastSeenTime = Time;
+	Knowledge.bHasLineOfSight = true;
+}
+
+const FShooterSquadKnowledge* UShooterSquadSubsystem::GetKnowledge(FName TeamTag) const
+{
+	const FShooterSquad* Squad = Squads.Find(TeamTag);
+
+	return Squad ? &Squad->Knowledge : nullptr;
+}
+
+bool UShooterSquadSubsystem::IsSpotter(const AShooterAIController* Member, FName TeamTag) const
+{
+	const FShooterSquad* Squad = Squads.Find(TeamTag);
+
+	return Squad && Squad->Members.IsValidIndex(Squad->SpotterIndex) && Squad->Members[Squad->SpotterIndex].Get() == Member;
+}
+
+bool UShooterSquadSubsystem::CanShareTarget(const AActor* Target, const APawn* MemberPawn, FName TeamTag) const
+{
+	const FShooterSquadKnowledge* Knowledge = GetKnowledge(TeamTag);
+
+	// the squad must be seeing this target right now
+	if (!Knowledge || !Target || Knowledge->Target.Get() != Target || !Knowledge->bHasLineOfSight)
+	{
+		return false;
+	}
+
+	if (GetWorld()->GetTimeSeconds() - Knowledge->LastSeenTime > ShareTime)
+	{
+		return false;
+	}
+
+	// members too far away wouldn't have heard the callout
+	return MemberPawn && FVector::DistSquared(MemberPawn->GetActorLocation(), Knowledge->LastKnownLocation) <= FMath::Square(ShareRadius);
+}
+
+void UShooterSquadSubsystem::RotateSpotter(FShooterSquad& Squad) const
+{
+	const AActor* Target = Squad.Knowledge.Target.Get();
+
+	// without a target there's nothing to spot
+	if (!Target)
+	{
+		Squad.SpotterIndex = INDEX_NONE;
+		return;
+	}
+
+	const float ShareRadiusSquared = FMath::Square(ShareRadius);
+
+	// find the next member close to the target that's sensing it. Starts from the first member if there's no spotter
+	for (int32 Step = 1; Step <= Squad.Members.Num(); ++Step)
+	{
+		const int32 Candidate = (FMath::Max(Squad.SpotterIndex, -1) + Step) % Squad.Members.Num();
+		const AShooterAIController* Member = Squad.Members[Candidate].Get();
+		const APawn* MemberPawn = Member ? Member->GetPawn() : nullptr;
+
+		if (!MemberPawn || FVector::DistSquared(MemberPawn->GetActorLocation(), Squad.Knowledge.LastKnownLocation) > ShareRadiusSquared)
+		{
+			continue;
+		}
+
+		if (Member->IsSensing(Target))
+		{
+			Squad.SpotterIndex = Candidate;
+			return;
+		}
+	}
+
+	// nobody can spot the target, so members check it themselves until the shared sighting runs out
+	Squad.SpotterIndex = INDEX_NONE;
+}
+
+void UShooterSquadSubsystem::UpdateLineOfSight(FShooterSquad& Squad, double Time) const
+{
+	const AShooterAIController* Spotter = Squad.Members.IsValidIndex(Squad.SpotterIndex) ? Squad.Members[Squad.SpotterIndex].Get() : nullptr;
+	const APawn* SpotterPawn = Spotter ? Spotter->GetPawn() : nullptr;
+	const AActor* Target = Squad.Knowledge.Target.Get();
+
+	if (!SpotterPawn || !Target)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_ShooterSquadLOSTraces);
+
+	// run a line trace between the spotter and the target
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(SpotterPawn);
+	QueryParams.AddIgnoredActor(Target);
+
+	FHitResult OutHit;
+
+	Squad.Knowledge.bHasLineOfSight = !GetWorld()->LineTraceSingleByChannel(OutHit, SpotterPawn->GetActorLocation(), Target->GetActorLocation(), ECC_Visibility, QueryParams);
+
+	// refresh the shared knowledge while the target is in sight
+	if (Squad.Knowledge.bHasLineOfSight)
+	{
+		Squad.Knowledge.LastKnownLocation = Target->GetActorLocation();
+		Squad.Knowledge.LastSeenTime = Time;
+	}
+}
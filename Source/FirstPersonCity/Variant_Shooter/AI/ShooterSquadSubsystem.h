@@ -0,0 +1,119 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterSquadSubsystem.generated.h"
+
+class AShooterAIController;
+
+/**
+ *  What a squad knows about its current target
+ */
+struct FShooterSquadKnowledge
+{
+	/** Target the squad is hunting */
+	TWeakObjectPtr<AActor> Target;
+
+	/** Where the target was last seen */
+	FVector LastKnownLocation = FVector::ZeroVector;
+
+	/** World time the target was last seen with direct line of sight */
+	double LastSeenTime = -1.0;
+
+	/** True if the spotter's last check found direct line of sight */
+	bool bHasLineOfSight = false;
+};
+
+/**
+ *  NPCs sharing a team tag, and what they know together
+ */
+struct FShooterSquad
+{
+	/** Controllers in the squad */
+	TArray<TWeakObjectPtr<AShooterAIController>> Members;
+
+	/** Shared target knowledge */
+	FShooterSquadKnowledge Knowledge;
+
+	/** Index of the member currently running the line of sight checks, or INDEX_NONE if no member can see the target */
+	int32 SpotterIndex = INDEX_NONE;
+
+	/** Time left before the spotter role moves to the next member */
+	float SpotterTime = 0.0f;
+
+	/** Time left before the spotter checks line of sight again */
+	float LineOfSightTime = 0.0f;
+};
+
+/**
+ *  Shares target knowledge between NPCs with the same team tag, so a squad facing the same enemy only validates it once
+ *  A single spotter, rotating through the members that are close to the squad's target and sensing it themselves, runs the
+ *  line of sight checks on it. Other members trust its result instead of tracing themselves, and pick up the target while they're close enough to it
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterSquadSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Time each member spends as the squad's spotter */
+	UPROPERTY(Config)
+	float SpotterRotationInterval = 1.0f;
+
+	/** Time between the spotter's line of sight checks */
+	UPROPERTY(Config)
+	float LineOfSightInterval = 0.2f;
+
+	/** Time after the target was last seen that members still pick it up from the squad */
+	UPROPERTY(Config)
+	float ShareTime = 0.5f;
+
+	/** Time without line of sight after which the squad drops its target */
+	UPROPERTY(Config)
+	float KnowledgeTimeout = 5.0f;
+
+	/** Max distance from the target's last known location for a member to pick it up from the squad */
+	UPROPERTY(Config)
+	float ShareRadius = 5000.0f;
+
+	/** Squads by team tag */
+	TMap<FName, FShooterSquad> Squads;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Adds a controller to its team's squad */
+	void RegisterMember(AShooterAIController* Member, FName TeamTag);
+
+	/** Removes a controller from its team's squad */
+	void UnregisterMember(AShooterAIController* Member, FName TeamTag);
+
+	/** Records a member's direct sighting of an enemy. Replaces the squad's target if it has lost track of it */
+	void ReportSighting(FName TeamTag, AActor* Target, const FVector& Location);
+
+	/** Returns the squad's knowledge, or nullptr if the team has no squad */
+	const FShooterSquadKnowledge* GetKnowledge(FName TeamTag) const;
+
+	/** Returns true if the member is its squad's current spotter */
+	bool IsSpotter(const AShooterAIController* Member, FName TeamTag) const;
+
+	/** Returns true if the squad has seen the target recently enough for the member to trust it without checking */
+	bool CanShareTarget(const AActor* Target, const APawn* MemberPawn, FName TeamTag) const;
+
+protected:
+
+	/** Moves the spotter role to the next member within ShareRadius of the target that's sensing it */
+	void RotateSpotter(FShooterSquad& Squad) const;
+
+	/** Has the squad's spotter check line of sight to the squad's target */
+	void UpdateLineOfSight(FShooterSquad& Squad, double Time) const;
+};
@@ -8,10 +8,14 @@
 #include "AIController.h"
 #include "Perception/AIPerceptionComponent.h"
 #include "ShooterAIController.h"
-#include "StateTreeAsyncExecutionContext.h"
+#include "ShooterFrameBudget.h"
+#include "ShooterEQSCacheSubsystem.h"
+#include "EnvironmentQuery/EnvQuery.h"
 
 bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionContext& Context) const
 {
+	SHOOTER_BUDGET_SCOPE(AI);
+
 	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 	// ensure the target is valid
@@ -19,54 +23,61 @@ bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionCo
 	{
 		return !InstanceData.bMustHaveLineOfSight;
 	}
-	
+
+	const bool bHasLineOfSight = HasLineOfSight(InstanceData.Character, InstanceData.Target, InstanceData.LineOfSightConeAngle, InstanceData.NumberOfVerticalLineOfSightChecks);
+
+	return bHasLineOfSight == InstanceData.bMustHaveLineOfSight;
+}
+
+bool FStateTreeLineOfSightToTargetCondition::HasLineOfSight(const AShooterNPC* Character, const AActor* Target, float ConeAngle, int32 NumVerticalChecks)
+{
 	// check if the character is facing towards the target
-	const FVector TargetDir = (InstanceData.Target->GetActorLocation() - InstanceData.Character->GetActorLocation()).GetSafeNormal();
+	const FVector TargetDir = (Target->GetActorLocation() - Character->GetActorLocation()).GetSafeNormal();
 
-	const float FacingDot = FVector::DotProduct(TargetDir, InstanceData.Character->GetActorForwardVector());
-	const float MaxDot = FMath::Cos(FMath::DegreesToRadians(InstanceData.LineOfSightConeAngle));
+	const float FacingDot = FVector::DotProduct(TargetDir, Character->GetActorForwardVector());
+	const float MaxDot = FMath::Cos(FMath::DegreesToRadians(ConeAngle));
 
 	// is the facing outside of our cone half angle?
 	if (FacingDot <= MaxDot)
 	{
-		return !InstanceData.bMustHaveLineOfSight;
+		return false;
 	}
 
 	// get the target's bounding box
 	FVector CenterOfMass, Extent;
-	InstanceData.Target->GetActorBounds(true, CenterOfMass, Extent, false);
+	Target->GetActorBounds(true, CenterOfMass, Extent, false);
 
 	// divide the vertical extent by the number of line of sight checks we'll do
-	const float ExtentZOffset = Extent.Z * 2.0f / InstanceData.NumberOfVerticalLineOfSightChecks;
+	const float ExtentZOffset = Extent.Z * 2.0f / NumVerticalChecks;
 
 	// get the character's camera location as the source for the line checks
-	const FVector Start = InstanceData.Character->GetFirstPersonCameraComponent()->GetComponentLocation();
+	const FVector Start = Character->GetFirstPersonCameraComponent()->GetComponentLocation();
 
 	// ignore the character and target. We want to ensure there's an unobstructed trace not counting them
 	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(InstanceData.Character);
-	QueryParams.AddIgnoredActor(InstanceData.Target);
+	QueryParams.AddIgnoredActor(Character);
+	QueryParams.AddIgnoredActor(Target);
 
 	FHitResult OutHit;
 
 	// run a number of vertically offset line traces to the target location
-	for (int32 i = 0; i < InstanceData.NumberOfVerticalLineOfSightChecks - 1; ++i)
+	for (int32 i = 0; i < NumVerticalChecks - 1; ++i)
 	{
 		// calculate the endpoint for the trace
 		const FVector End = CenterOfMass + FVector(0.0f, 0.0f, Extent.Z - ExtentZOffset * i);
 
-		InstanceData.Character->GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
+		Character->GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
 
 		// is the trace unobstructed?
 		if (!OutHit.bBlockingHit)
 		{
 			// we only need one unobstructed trace, so terminate early
-			return InstanceData.bMustHaveLineOfSight;
+			return true;
 		}
 	}
 
 	// no line of sight found
-	return !InstanceData.bMustHaveLineOfSight;
+	return false;
 }
 
 #if WITH_EDITOR
@@ -213,154 +224,131 @@ FText FStateTreeShootAtTargetTask::GetDescription(const FGuid& ID, FStateTreeDat
 
 EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// the controller filters and scores stimuli with this state's settings
+	InstanceData.Controller->SetPerceptionSettings(InstanceData.SenseTag, InstanceData.DirectLineOfSightCone);
+
 	// have we transitioned from another state?
 	if (Transition.ChangeType == EStateTreeStateChangeType::Changed)
 	{
-		// get the instance data
-		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
-
-		// bind the perception updated delegate on the controller
-		InstanceData.Controller->OnShooterPerceptionUpdated.BindLambda(
-			[WeakContext = Context.MakeWeakExecutionContext()](AActor* SensedActor, const FAIStimulus& Stimulus)
-			{
-				// get the instance data inside the lambda
-				const FStateTreeStrongExecutionContext StrongContext = WeakContext.MakeStrongExecutionContext();
-
-				if (FInstanceDataType* LambdaInstanceData = StrongContext.GetInstanceDataPtr<FInstanceDataType>())
-				{
-					if (SensedActor->ActorHasTag(LambdaInstanceData->SenseTag))
-					{
-						bool bDirectLOS = false;
-
-						// calculate the direction of the stimulus
-						const FVector StimulusDir = (Stimulus.StimulusLocation - LambdaInstanceData->Character->GetActorLocation()).GetSafeNormal();
-
-						// infer the angle from the dot product between the character facing and the stimulus direction
-						const float DirDot = FVector::DotProduct(StimulusDir, LambdaInstanceData->Character->GetActorForwardVector());
-						const float MaxDot = FMath::Cos(FMath::DegreesToRadians(LambdaInstanceData->DirectLineOfSightCone));
-
-						// is the direction within our perception cone?
-						if (DirDot >= MaxDot)
-						{
-							// run a line trace between the character and the sensed actor
-							FCollisionQueryParams QueryParams;
-							QueryParams.AddIgnoredActor(LambdaInstanceData->Character);
-							QueryParams.AddIgnoredActor(SensedActor);
-
-							FHitResult OutHit;
-
-							// we have direct line of sight if this trace is unobstructed
-							bDirectLOS = !LambdaInstanceData->Character->GetWorld()->LineTraceSingleByChannel(OutHit, LambdaInstanceData->Character->GetActorLocation(), SensedActor->GetActorLocation(), ECC_Visibility, QueryParams);
-
-						}
-
-						// check if we have a direct line of sight to the stimulus
-						if (bDirectLOS)
-						{
-							// set the controller's target
-							LambdaInstanceData->Controller->SetCurrentTarget(SensedActor);
-
-							// set the task output
-							LambdaInstanceData->TargetActor = SensedActor;
-
-							// set the flags
-							LambdaInstanceData->bHasTarget = true;
-							LambdaInstanceData->bHasInvestigateLocation = false;
-
-						// no direct line of sight to target
-						} else {
-
-							// if we already have a target, ignore the partial sense and keep on them
-							if (!IsValid(LambdaInstanceData->TargetActor))
-							{
-								// is this stimulus stronger than the last one we had?
-								if (Stimulus.Strength > LambdaInstanceData->LastStimulusStrength)
-								{
-									// update the stimulus strength
-									LambdaInstanceData->LastStimulusStrength = Stimulus.Strength;
-
-									// set the investigate location
-									LambdaInstanceData->InvestigateLocation = Stimulus.StimulusLocation;
-
-									// set the investigate flag
-									LambdaInstanceData->bHasInvestigateLocation = true;
-								}
-							}
-						}
-					}
-				}
-			}
-		);
-
-		// bind the perception forgotten delegate on the controller
-		InstanceData.Controller->OnShooterPerceptionForgotten.BindLambda(
-			[WeakContext = Context.MakeWeakExecutionContext()](AActor* SensedActor)
-			{
-				// get the instance data inside the lambda
-				FInstanceDataType* LambdaInstanceData = WeakContext.MakeStrongExecutionContext().GetInstanceDataPtr<FInstanceDataType>();
-
-				if (!LambdaInstanceData)
-				{
-					return;
-				}
-
-				bool bForget = false;
-
-				// are we forgetting the current target?
-				if (SensedActor == LambdaInstanceData->TargetActor)
-				{
-					bForget = true;
-
-				} else {
-
-					// are we forgetting about a partial sense?
-					if (!IsValid(LambdaInstanceData->TargetActor))
-					{
-						bForget = true;
-					}
-				}
-
-				if (bForget)
-				{
-					// clear the target
-					LambdaInstanceData->TargetActor = nullptr;
-
-					// clear the flags
-					LambdaInstanceData->bHasInvestigateLocation = false;
-					LambdaInstanceData->bHasTarget = false;
-
-					// reset the stimulus strength
-					LambdaInstanceData->LastStimulusStrength = 0.0f;
-
-					// clear the target on the controller
-					LambdaInstanceData->Controller->ClearCurrentTarget();
-					LambdaInstanceData->Controller->ClearFocus(EAIFocusPriority::Gameplay);
-				}
-
-			}
-		);
+		// start looking for a new investigate location
+		InstanceData.Controller->ClearInvestigateLocation();
 	}
 
+	return Tick(Context, 0.0f);
+}
+
+EStateTreeRunStatus FStateTreeSenseEnemiesTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	SHOOTER_BUDGET_SCOPE(AI);
+
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// copy the controller's perception state to the outputs
+	const FShooterPerceptionSnapshot& Snapshot = InstanceData.Controller->GetPerceptionSnapshot();
+
+	InstanceData.TargetActor = Snapshot.TargetActor;
+	InstanceData.InvestigateLocation = Snapshot.InvestigateLocation;
+	InstanceData.bHasTarget = Snapshot.bHasTarget;
+	InstanceData.bHasInvestigateLocation = Snapshot.bHasInvestigateLocation;
+
 	return EStateTreeRunStatus::Running;
 }
 
-void FStateTreeSenseEnemiesTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+#if WITH_EDITOR
+FText FStateTreeSenseEnemiesTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
 {
-	// have we transitioned to another state?
-	if (Transition.ChangeType == EStateTreeStateChangeType::Changed)
+	return FText::FromString("<b>Sense Enemies</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+void FStateTreeShooterPerceptionEvaluator::TreeStart(FStateTreeExecutionContext& Context) const
+{
+	ReadSnapshot(Context.GetInstanceData(*this));
+}
+
+void FStateTreeShooterPerceptionEvaluator::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	SHOOTER_BUDGET_SCOPE(AI);
+
+	ReadSnapshot(Context.GetInstanceData(*this));
+}
+
+void FStateTreeShooterPerceptionEvaluator::ReadSnapshot(FInstanceDataType& InstanceData)
+{
+	// ensure the controller is valid
+	if (!IsValid(InstanceData.Controller))
 	{
-		// get the instance data
-		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+		return;
+	}
+
+	// copy the controller's perception state to the outputs
+	const FShooterPerceptionSnapshot& Snapshot = InstanceData.Controller->GetPerceptionSnapshot();
+
+	InstanceData.TargetActor = Snapshot.TargetActor;
+	InstanceData.InvestigateLocation = Snapshot.InvestigateLocation;
+	InstanceData.StimulusStrength = Snapshot.StimulusStrength;
+	InstanceData.bHasTarget = Snapshot.bHasTarget;
+	InstanceData.bHasInvestigateLocation = Snapshot.bHasInvestigateLocation;
+	InstanceData.bHasLineOfSight = Snapshot.bHasLineOfSight;
+}
+
+#if WITH_EDITOR
+FText FStateTreeShooterPerceptionEvaluator::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Shooter Perception</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeRunCachedEnvQueryTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	return Tick(Context, 0.0f);
+}
+
+EStateTreeRunStatus FStateTreeRunCachedEnvQueryTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	SHOOTER_BUDGET_SCOPE(AI);
 
-		// unbind the perception delegates
-		InstanceData.Controller->OnShooterPerceptionUpdated.Unbind();
-		InstanceData.Controller->OnShooterPerceptionForgotten.Unbind();
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// ensure the controller and query are valid
+	if (!IsValid(InstanceData.Controller) || !IsValid(InstanceData.QueryTemplate))
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	UShooterEQSCacheSubsystem* EQSCache = InstanceData.Controller->GetWorld()->GetSubsystem<UShooterEQSCacheSubsystem>();
+
+	if (!EQSCache)
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	// ask the cache for a location, and keep waiting while the query is queued
+	switch (EQSCache->RequestLocation(InstanceData.QueryTemplate, InstanceData.Controller, InstanceData.ResultLocation))
+	{
+	case EShooterEQSCacheResult::Ready:
+		return EStateTreeRunStatus::Succeeded;
+
+	case EShooterEQSCacheResult::Failed:
+		return EStateTreeRunStatus::Failed;
+
+	default:
+		return EStateTreeRunStatus::Running;
 	}
 }
 
 #if WITH_EDITOR
-FText FStateTreeSenseEnemiesTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+FText FStateTreeRunCachedEnvQueryTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
 {
-	return FText::FromString("<b>Sense Enemies</b>");
+	return FText::FromString("<b>Run Cached Env Query</b>");
 }
-#endif // WITH_EDITOR
\ No newline at end of file
+#endif // WITH_EDITOR
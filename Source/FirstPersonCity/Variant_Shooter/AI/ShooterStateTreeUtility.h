@@ -5,12 +5,14 @@
 #include "CoreMinimal.h"
 #include "StateTreeTaskBase.h"
 #include "StateTreeConditionBase.h"
+#include "StateTreeEvaluatorBase.h"
 
 #include "ShooterStateTreeUtility.generated.h"
 
 class AShooterNPC;
 class AAIController;
 class AShooterAIController;
+class UEnvQuery;
 
 /**
  *  Instance data struct for the FStateTreeLineOfSightToTargetCondition condition
@@ -60,6 +62,9 @@ struct FStateTreeLineOfSightToTargetCondition : public FStateTreeConditionCommon
 	/** Tests the StateTree condition */
 	virtual bool TestCondition(FStateTreeExecutionContext& Context) const override;
 
+	/** Returns true if the target is inside the character's facing cone and at least one of the vertical traces to it is unobstructed */
+	static bool HasLineOfSight(const AShooterNPC* Character, const AActor* Target, float ConeAngle, int32 NumVerticalChecks);
+
 #if WITH_EDITOR
 	/** Provides the description string */
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
@@ -254,6 +259,14 @@ struct FStateTreeSenseEnemiesInstanceData
 	UPROPERTY(EditAnywhere, Category = Context)
 	TObjectPtr<AShooterNPC> Character;
 
+	/** Tag required on sensed actors. Pushed to the controller when the state is entered */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	FName SenseTag = FName("Player");
+
+	/** Line of sight cone half angle to consider a full sense. Pushed to the controller when the state is entered */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	float DirectLineOfSightCone = 85.0f;
+
 	/** Sensed actor to target */
 	UPROPERTY(EditAnywhere, Category = Output)
 	TObjectPtr<AActor> TargetActor;
@@ -269,41 +282,145 @@ struct FStateTreeSenseEnemiesInstanceData
 	/** True if an investigate location was successfully sensed */
 	UPROPERTY(EditAnywhere, Category = Output)
 	bool bHasInvestigateLocation = false;
+};
 
-	/** Tag required on sensed actors */
-	UPROPERTY(EditAnywhere, Category = Parameter)
-	FName SenseTag = FName("Player");
+/**
+ *  StateTree task to have an NPC sense nearby enemies
+ *  Reads the AI controller's perception snapshot, so entering and leaving states doesn't rebind any perception delegates
+ *  Entering the task's state pushes the sense tag and line of sight cone to the controller, and drops any old investigate location, so the NPC only investigates what it senses from then on
+ */
+USTRUCT(meta=(DisplayName="Sense Enemies", Category="Shooter"))
+struct FStateTreeSenseEnemiesTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeSenseEnemiesInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Shooter Perception StateTree evaluator
+ */
+USTRUCT()
+struct FStateTreeShooterPerceptionEvaluatorInstanceData
+{
+	GENERATED_BODY()
+
+	/** Sensing AI Controller */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterAIController> Controller;
+
+	/** Sensed actor to target */
+	UPROPERTY(EditAnywhere, Category = Output)
+	TObjectPtr<AActor> TargetActor;
+
+	/** Sensed location to investigate */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FVector InvestigateLocation = FVector::ZeroVector;
 
-	/** Line of sight cone half angle to consider a full sense */
+	/** Strength of the stimulus behind the investigate location */
+	UPROPERTY(EditAnywhere, Category = Output)
+	float StimulusStrength = 0.0f;
+
+	/** True if a target was successfully sensed */
+	UPROPERTY(EditAnywhere, Category = Output)
+	bool bHasTarget = false;
+
+	/** True if an investigate location was successfully sensed */
+	UPROPERTY(EditAnywhere, Category = Output)
+	bool bHasInvestigateLocation = false;
+
+	/** True if the last check on the target, by this NPC or its squad's spotter, found direct line of sight */
+	UPROPERTY(EditAnywhere, Category = Output)
+	bool bHasLineOfSight = false;
+};
+
+/**
+ *  StateTree evaluator that exposes the AI controller's perception snapshot to every state
+ *  The controller updates the snapshot once per frame, so states can bind to it without doing any perception work themselves
+ */
+USTRUCT(meta=(DisplayName="Shooter Perception", Category="Shooter"))
+struct FStateTreeShooterPerceptionEvaluator : public FStateTreeEvaluatorCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeShooterPerceptionEvaluatorInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the StateTree starts */
+	virtual void TreeStart(FStateTreeExecutionContext& Context) const override;
+
+	/** Runs every StateTree tick */
+	virtual void Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+	/** Copies the controller's perception snapshot to the outputs */
+	static void ReadSnapshot(FInstanceDataType& InstanceData);
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Run Cached Env Query StateTree task
+ */
+USTRUCT()
+struct FStateTreeRunCachedEnvQueryInstanceData
+{
+	GENERATED_BODY()
+
+	/** AI Controller running the query */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterAIController> Controller;
+
+	/** Query to run around the controller's target */
 	UPROPERTY(EditAnywhere, Category = Parameter)
-	float DirectLineOfSightCone = 85.0f;
+	TObjectPtr<UEnvQuery> QueryTemplate;
 
-	/** Strength of the last processed stimulus */
-	UPROPERTY(EditAnywhere)
-	float LastStimulusStrength = 0.0f;
+	/** Location picked from the query results */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FVector ResultLocation = FVector::ZeroVector;
 };
 
 /**
- *  StateTree task to have an NPC process AI Perceptions and sense nearby enemies
+ *  StateTree task to pick a location from an EQS query around the NPC's target
+ *  Goes through the EQS cache, so NPCs around the same target share query results and queries run within a frame budget.
+ *  Succeeds once a location is available and fails if the query finds nothing
  */
-USTRUCT(meta=(DisplayName="Sense Enemies", Category="Shooter"))
-struct FStateTreeSenseEnemiesTask : public FStateTreeTaskCommonBase
+USTRUCT(meta=(DisplayName="Run Cached Env Query", Category="Shooter"))
+struct FStateTreeRunCachedEnvQueryTask : public FStateTreeTaskCommonBase
 {
 	GENERATED_BODY()
 
 	/* Ensure we're using the correct instance data struct */
-	using FInstanceDataType = FStateTreeSenseEnemiesInstanceData;
+	using FInstanceDataType = FStateTreeRunCachedEnvQueryInstanceData;
 	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
 
 	/** Runs when the owning state is entered */
 	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 
-	/** Runs when the owning state is ended */
-	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
 
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 #endif // WITH_EDITOR
 };
 
-////////////////////////////////////////////////////////////////////
\ No newline at end of file
+////////////////////////////////////////////////////////////////////
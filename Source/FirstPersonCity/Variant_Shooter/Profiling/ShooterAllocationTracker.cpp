@@ -0,0 +1,251 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterAllocationTracker.h"
+
+#if SHOOTER_ALLOC_TRACKING
+
+#include "ShooterMallocProxy.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
+#include "FirstPersonCity.h"
+
+namespace
+{
+	/** Scope allocations on this thread are currently attributed to */
+	thread_local EShooterAllocScope CurrentScope = EShooterAllocScope::Untagged;
+
+	/** Totals gathered for a single scope */
+	struct FShooterScopeCounters
+	{
+		uint64 Bytes = 0;
+		uint64 Allocations = 0;
+		uint64 UObjects = 0;
+	};
+
+	/** Counts game thread allocations and UObject creations per scope while installed */
+	class FShooterScopedMalloc final : public FShooterMallocProxy, public FUObjectArray::FUObjectCreateListener
+	{
+	public:
+
+		/** Per scope totals since the last reset. Only written from the game thread */
+		FShooterScopeCounters Counters[static_cast<int32>(EShooterAllocScope::Count)];
+
+		/** Garbage collections seen since the last reset */
+		int32 NumGarbageCollections = 0;
+
+		/** Time spent in garbage collection since the last reset */
+		double GarbageCollectionTime = 0.0;
+
+		/** Time the current garbage collection started at */
+		double GarbageCollectionStartTime = 0.0;
+
+		/** Time tracking started at */
+		double StartTime = 0.0;
+
+		/** Time tracking stopped at, or zero while still tracking */
+		double StopTime = 0.0;
+
+		FDelegateHandle PreGCHandle;
+		FDelegateHandle PostGCHandle;
+
+		void Reset()
+		{
+			for (FShooterScopeCounters& ScopeCounters : Counters)
+			{
+				ScopeCounters = FShooterScopeCounters();
+			}
+
+			NumGarbageCollections = 0;
+			GarbageCollectionTime = 0.0;
+			StartTime = FPlatformTime::Seconds();
+			StopTime = 0.0;
+		}
+
+		double GetDuration() const
+		{
+			return (StopTime > 0.0 ? StopTime : FPlatformTime::Seconds()) - StartTime;
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override { return TEXT("ShooterScopedMalloc"); }
+
+		//~Begin FUObjectCreateListener interface
+
+		virtual void NotifyUObjectCreated(const UObjectBase* Object, int32 Index) override
+		{
+			if (IsInGameThread())
+			{
+				++Counters[static_cast<int32>(CurrentScope)].UObjects;
+			}
+		}
+
+		virtual void OnUObjectArrayShutdown() override
+		{
+			GUObjectArray.RemoveUObjectCreateListener(this);
+		}
+
+		//~End FUObjectCreateListener interface
+
+	protected:
+
+		virtual void OnAllocation(SIZE_T Size) override
+		{
+			// other threads would drown the gameplay scopes in untagged noise
+			if (IsInGameThread())
+			{
+				FShooterScopeCounters& ScopeCounters = Counters[static_cast<int32>(CurrentScope)];
+				++ScopeCounters.Allocations;
+				ScopeCounters.Bytes += Size;
+			}
+		}
+	};
+
+	/** Never destroyed, so threads still inside it after GMalloc is restored stay safe */
+	FShooterScopedMalloc GScopedMalloc;
+}
+
+EShooterAllocScope FShooterAllocationTracker::SetScope(EShooterAllocScope Scope)
+{
+	const EShooterAllocScope Previous = CurrentScope;
+	CurrentScope = Scope;
+
+	return Previous;
+}
+
+void FShooterAllocationTracker::Start()
+{
+	if (IsTracking())
+	{
+		return;
+	}
+
+	GScopedMalloc.Reset();
+
+	GScopedMalloc.Install();
+	GUObjectArray.AddUObjectCreateListener(&GScopedMalloc);
+
+	// time garbage collections so their spikes can be lined up against the scopes feeding them
+	GScopedMalloc.PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddLambda([]()
+	{
+		GScopedMalloc.GarbageCollectionStartTime = FPlatformTime::Seconds();
+	});
+
+	GScopedMalloc.PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddLambda([]()
+	{
+		++GScopedMalloc.NumGarbageCollections;
+		GScopedMalloc.GarbageCollectionTime += FPlatformTime::Seconds() - GScopedMalloc.GarbageCollectionStartTime;
+	});
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Allocation tracking started"));
+}
+
+void FShooterAllocationTracker::Stop()
+{
+	if (!IsTracking())
+	{
+		return;
+	}
+
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(GScopedMalloc.PreGCHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(GScopedMalloc.PostGCHandle);
+
+	GUObjectArray.RemoveUObjectCreateListener(&GScopedMalloc);
+	GScopedMalloc.Uninstall();
+
+	GScopedMalloc.StopTime = FPlatformTime::Seconds();
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Allocation tracking stopped after %.1fs"), GScopedMalloc.GetDuration());
+}
+
+bool FShooterAllocationTracker::IsTracking()
+{
+	return GScopedMalloc.IsInstalled();
+}
+
+void FShooterAllocationTracker::Report(const FString& OutputPath)
+{
+	const double Duration = FMath::Max(GScopedMalloc.GetDuration(), UE_DOUBLE_SMALL_NUMBER);
+
+	// copy the counters first so building the report doesn't count towards it
+	FShooterScopeCounters Counters[static_cast<int32>(EShooterAllocScope::Count)];
+	FMemory::Memcpy(Counters, GScopedMalloc.Counters, sizeof(Counters));
+
+	TArray<FString> Lines;
+	Lines.Add(TEXT("Scope,Bytes,Allocations,UObjects,BytesPerSec,AllocationsPerSec,UObjectsPerSec"));
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Allocations by gameplay scope over %.1fs, %d garbage collections taking %.1f ms"), Duration, GScopedMalloc.NumGarbageCollections, GScopedMalloc.GarbageCollectionTime * 1000.0);
+
+	for (int32 ScopeIndex = 0; ScopeIndex < static_cast<int32>(EShooterAllocScope::Count); ++ScopeIndex)
+	{
+		const FShooterScopeCounters& ScopeCounters = Counters[ScopeIndex];
+		const TCHAR* ScopeName = GetScopeName(static_cast<EShooterAllocScope>(ScopeIndex));
+
+		UE_LOG(LogFirstPersonCity, Display, TEXT("  %-14s %12llu bytes %9llu allocs %7llu UObjects | %10.0f bytes/s %8.1f allocs/s %6.1f UObjects/s"),
+			ScopeName, ScopeCounters.Bytes, ScopeCounters.Allocations, ScopeCounters.UObjects,
+			ScopeCounters.Bytes / Duration, ScopeCounters.Allocations / Duration, ScopeCounters.UObjects / Duration);
+
+		Lines.Add(FString::Printf(TEXT("%s,%llu,%llu,%llu,%.1f,%.2f,%.2f"),
+			ScopeName, ScopeCounters.Bytes, ScopeCounters.Allocations, ScopeCounters.UObjects,
+			ScopeCounters.Bytes / Duration, ScopeCounters.Allocations / Duration, ScopeCounters.UObjects / Duration));
+	}
+
+	Lines.Add(FString::Printf(TEXT("GarbageCollections,%d,,,%.3f,,"), GScopedMalloc.NumGarbageCollections, GScopedMalloc.GarbageCollectionTime * 1000.0));
+
+	if (FFileHelper::SaveStringArrayToFile(Lines, *OutputPath))
+	{
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Allocation report written to %s"), *OutputPath);
+
+	} else {
+
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Failed to write allocation report to %s"), *OutputPath);
+	}
+}
+
+const TCHAR* FShooterAllocationTracker::GetScopeName(EShooterAllocScope Scope)
+{
+	switch (Scope)
+	{
+	case EShooterAllocScope::Fire:				return TEXT("Fire");
+	case EShooterAllocScope::ProjectileHit:		return TEXT("ProjectileHit");
+	case EShooterAllocScope::Damage:			return TEXT("Damage");
+	case EShooterAllocScope::Death:				return TEXT("Death");
+	case EShooterAllocScope::Respawn:			return TEXT("Respawn");
+	case EShooterAllocScope::Pickup:			return TEXT("Pickup");
+	default:									return TEXT("Untagged");
+	}
+}
+
+/** Returns the report path from the command arguments, or a timestamped one under Saved/Profiling */
+static FString GetAllocationReportPath(const TArray<FString>& Args)
+{
+	return Args.Num() > 0 ? Args[0] : FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("AllocTrack-%s.csv"), *FDateTime::Now().ToString());
+}
+
+static FAutoConsoleCommand ShooterAllocTrackStartCommand(
+	TEXT("Shooter.AllocTrack.Start"),
+	TEXT("Starts attributing game thread allocations and UObject creations to gameplay scopes"),
+	FConsoleCommandDelegate::CreateStatic(&FShooterAllocationTracker::Start));
+
+static FAutoConsoleCommand ShooterAllocTrackReportCommand(
+	TEXT("Shooter.AllocTrack.Report"),
+	TEXT("Writes the allocations per gameplay scope gathered so far. Usage: Shooter.AllocTrack.Report [CsvPath]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FShooterAllocationTracker::Report(GetAllocationReportPath(Args));
+	}));
+
+static FAutoConsoleCommand ShooterAllocTrackStopCommand(
+	TEXT("Shooter.AllocTrack.Stop"),
+	TEXT("Stops allocation tracking and writes the report. Usage: Shooter.AllocTrack.Stop [CsvPath]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FShooterAllocationTracker::Stop();
+		FShooterAllocationTracker::Report(GetAllocationReportPath(Args));
+	}));
+
+#endif
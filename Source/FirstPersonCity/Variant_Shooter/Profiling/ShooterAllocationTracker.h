@@ -0,0 +1,84 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Allocation tracking is compiled out of shipping builds */
+#define SHOOTER_ALLOC_TRACKING !UE_BUILD_SHIPPING
+
+/**
+ *  Gameplay scopes heap allocations and UObject creations are attributed to
+ */
+enum class EShooterAllocScope : uint8
+{
+	Untagged,
+	Fire,
+	ProjectileHit,
+	Damage,
+	Death,
+	Respawn,
+	Pickup,
+	Count
+};
+
+#if SHOOTER_ALLOC_TRACKING
+
+/**
+ *  Attributes game thread heap allocations and UObject creations to gameplay scopes during soak runs
+ *  Costs a thread local write per scope while idle. Allocations are only intercepted between Start and Stop
+ *  Driven from the console with Shooter.AllocTrack.Start, Shooter.AllocTrack.Report and Shooter.AllocTrack.Stop
+ */
+class FIRSTPERSONCITY_API FShooterAllocationTracker
+{
+public:
+
+	/** Makes the passed scope current on this thread and returns the one it replaced */
+	static EShooterAllocScope SetScope(EShooterAllocScope Scope);
+
+	/** Resets the counters and starts intercepting allocations and UObject creations */
+	static void Start();
+
+	/** Stops intercepting. The counters are kept until the next Start */
+	static void Stop();
+
+	/** Returns true between Start and Stop */
+	static bool IsTracking();
+
+	/** Logs the per scope totals and rates, and writes them as CSV to the output path */
+	static void Report(const FString& OutputPath);
+
+	/** Returns the display name for a scope */
+	static const TCHAR* GetScopeName(EShooterAllocScope Scope);
+};
+
+/**
+ *  Tags allocations on the current thread with a gameplay scope until it goes out of scope
+ *  Scopes nest, and the innermost one wins
+ */
+class FShooterAllocScope
+{
+public:
+
+	explicit FShooterAllocScope(EShooterAllocScope Scope)
+		: Previous(FShooterAllocationTracker::SetScope(Scope))
+	{}
+
+	~FShooterAllocScope()
+	{
+		FShooterAllocationTracker::SetScope(Previous);
+	}
+
+private:
+
+	/** Scope to restore when this one ends */
+	EShooterAllocScope Previous;
+};
+
+#define SHOOTER_ALLOC_SCOPE(Scope) FShooterAllocScope PREPROCESSOR_JOIN(ShooterAllocScope_, __LINE__)(EShooterAllocScope::Scope)
+
+#else
+
+#define SHOOTER_ALLOC_SCOPE(Scope)
+
+#endif
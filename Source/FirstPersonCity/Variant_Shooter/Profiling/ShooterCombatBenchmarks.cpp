@@ -0,0 +1,376 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterCombatBenchmarks.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "ShooterWeapon.h"
+#include "ShooterProjectile.h"
+#include "ShooterCombatSubsystem.h"
+#include "ShooterNPC.h"
+#include "ShooterGameMode.h"
+#include "ShooterStateTreeUtility.h"
+#include "ShooterMallocProxy.h"
+#include "Engine/World.h"
+#include "Engine/TriggerBox.h"
+#include "Engine/DamageEvents.h"
+#include "Components/BoxComponent.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/PlayerController.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "FirstPersonCity.h"
+
+namespace
+{
+	/** Counts game thread allocations while a benchmark is timed */
+	class FShooterCountingMalloc final : public FShooterMallocProxy
+	{
+	public:
+
+		/** If true, game thread allocations are being counted */
+		bool bCounting = false;
+
+		/** Allocations counted since the last reset */
+		uint64 NumAllocations = 0;
+
+		/** Bytes requested since the last reset */
+		uint64 NumBytes = 0;
+
+		virtual const TCHAR* GetDescriptiveName() override { return TEXT("ShooterCountingMalloc"); }
+
+	protected:
+
+		virtual void OnAllocation(SIZE_T Size) override
+		{
+			if (bCounting && IsInGameThread())
+			{
+				++NumAllocations;
+				NumBytes += Size;
+			}
+		}
+	};
+
+	/** Never destroyed, so threads still inside it after GMalloc is restored stay safe */
+	FShooterCountingMalloc GCountingMalloc;
+
+	/** Times a benchmark after a short warmup and counts its game thread allocations */
+	template<typename FuncType>
+	FShooterBenchmarkResult Measure(const FString& Name, int32 Iterations, FuncType&& Func)
+	{
+		// let lazily allocated storage and caches settle before timing
+		const int32 WarmupIterations = FMath::Max(Iterations / 10, 1);
+
+		for (int32 i = 0; i < WarmupIterations; ++i)
+		{
+			Func(i);
+		}
+
+		GCountingMalloc.NumAllocations = 0;
+		GCountingMalloc.NumBytes = 0;
+		GCountingMalloc.bCounting = true;
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			Func(i);
+		}
+
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+
+		GCountingMalloc.bCounting = false;
+
+		FShooterBenchmarkResult Result;
+		Result.Name = Name;
+		Result.Iterations = Iterations;
+		Result.NsPerOp = FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1.0e9 / Iterations;
+		Result.AllocsPerOp = static_cast<double>(GCountingMalloc.NumAllocations) / Iterations;
+		Result.BytesPerOp = static_cast<double>(GCountingMalloc.NumBytes) / Iterations;
+
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Combat benchmark %s: %.1f ns/op, %.2f allocs/op, %.1f bytes/op"), *Result.Name, Result.NsPerOp, Result.AllocsPerOp, Result.BytesPerOp);
+
+		return Result;
+	}
+
+	/** Returns the first living NPC in the world */
+	AShooterNPC* FindNPC(UWorld* World)
+	{
+		for (TActorIterator<AShooterNPC> It(World); It; ++It)
+		{
+			if (IsValid(*It) && It->CurrentHP > 0.0f)
+			{
+				return *It;
+			}
+		}
+
+		return nullptr;
+	}
+}
+
+bool FShooterCombatBenchmarks::Run(UWorld* World, int32 Iterations, const FString& OutputPath)
+{
+	check(IsInGameThread());
+
+	if (!World)
+	{
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Combat benchmarks need a loaded world"));
+		return false;
+	}
+
+	Iterations = FMath::Max(Iterations, 1);
+
+	// route allocations through the counting proxy for the whole run
+	GCountingMalloc.Install();
+
+	TArray<FShooterBenchmarkResult> Results;
+
+	BenchProjectileSpawnTransform(World, Iterations, Results);
+	BenchExplosionCheck(World, Iterations, Results);
+	BenchNPCTakeDamage(World, Iterations, Results);
+	BenchLineOfSight(World, Iterations, Results);
+	BenchIncrementTeamScore(World, Iterations, Results);
+
+	GCountingMalloc.Uninstall();
+
+	return WriteJson(World, Iterations, Results, OutputPath);
+}
+
+void FShooterCombatBenchmarks::BenchProjectileSpawnTransform(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults)
+{
+	TActorIterator<AShooterWeapon> It(World);
+
+	if (!It)
+	{
+		UE_LOG(LogFirstPersonCity, Warning, TEXT("Combat benchmark ProjectileSpawnTransform skipped: no weapons in the world"));
+		return;
+	}
+
+	const AShooterWeapon* Weapon = *It;
+	const FVector TargetLocation = Weapon->GetActorLocation() + Weapon->GetActorForwardVector() * 5000.0f;
+
+	FVector Sink = FVector::ZeroVector;
+
+	OutResults.Add(Measure(TEXT("ProjectileSpawnTransform"), Iterations, [&](int32 i)
+	{
+		Sink += Weapon->CalculateProjectileSpawnTransform(TargetLocation, static_cast<uint16>(i)).GetLocation();
+	}));
+
+	// keep the calls from being optimized away
+	UE_LOG(LogFirstPersonCity, Verbose, TEXT("%s"), *Sink.ToString());
+}
+
+void FShooterCombatBenchmarks::BenchExplosionCheck(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults)
+{
+	const AShooterWeapon* Weapon = nullptr;
+
+	for (TActorIterator<AShooterWeapon> It(World); It; ++It)
+	{
+		if (It->GetProjectileClass())
+		{
+			Weapon = *It;
+			break;
+		}
+	}
+
+	UShooterCombatSubsystem* Combat = World->GetSubsystem<UShooterCombatSubsystem>();
+
+	if (!Weapon || !Combat)
+	{
+		UE_LOG(LogFirstPersonCity, Warning, TEXT("Combat benchmark ExplosionCheck skipped: no weapon with a projectile class in the world"));
+		return;
+	}
+
+	// explode well away from the play area so only our own actors are overlapped
+	const FVector ExplosionCenter(0.0f, 0.0f, 200000.0f);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// the projectile never finishes spawning, so it doesn't move, tick or schedule its own destruction
+	AShooterProjectile* Projectile = World->SpawnActorDeferred<AShooterProjectile>(Weapon->GetProjectileClass(), FTransform(ExplosionCenter), nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+
+	if (!Projectile)
+	{
+		return;
+	}
+
+	// zero damage keeps the resolve step from changing anything
+	Projectile->SetHitDamageForTesting(0.0f);
+
+	TArray<AActor*> Targets;
+	FRandomStream Stream(1234);
+
+	const int32 OverlapCounts[] = { 0, 8, 32, 128 };
+
+	for (const int32 OverlapCount : OverlapCounts)
+	{
+		// grow the set of query only targets inside the blast radius
+		while (Targets.Num() < OverlapCount)
+		{
+			const FVector Location = ExplosionCenter + Stream.VRand() * Stream.FRandRange(0.0f, Projectile->GetExplosionRadius() * 0.5f);
+
+			if (ATriggerBox* Target = World->SpawnActor<ATriggerBox>(Location, FRotator::ZeroRotator, SpawnParams))
+			{
+				if (UBoxComponent* Box = Cast<UBoxComponent>(Target->GetCollisionComponent()))
+				{
+					Box->SetBoxExtent(FVector(10.0f));
+					Box->SetCollisionObjectType(ECC_WorldDynamic);
+					Box->SetGenerateOverlapEvents(false);
+				}
+
+				Targets.Add(Target);
+
+			} else {
+
+				break;
+			}
+		}
+
+		OutResults.Add(Measure(FString::Printf(TEXT("ExplosionCheck.%dOverlaps"), OverlapCount), Iterations, [&](int32 i)
+		{
+			Projectile->ExplosionCheckForTesting(ExplosionCenter);
+
+			// include the damage pass the explosion feeds
+			Combat->ResolveHits();
+		}));
+	}
+
+	// clean up
+	for (AActor* Target : Targets)
+	{
+		Target->Destroy();
+	}
+
+	Projectile->Destroy();
+}
+
+void FShooterCombatBenchmarks::BenchNPCTakeDamage(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults)
+{
+	AShooterNPC* NPC = FindNPC(World);
+
+	if (!NPC)
+	{
+		UE_LOG(LogFirstPersonCity, Warning, TEXT("Combat benchmark NPCTakeDamage skipped: no living NPCs in the world"));
+		return;
+	}
+
+	const FDamageEvent DamageEvent(UDamageType::StaticClass());
+
+	OutResults.Add(Measure(TEXT("NPCTakeDamage"), Iterations, [&](int32 i)
+	{
+		NPC->TakeDamage(0.0f, DamageEvent, nullptr, nullptr);
+	}));
+}
+
+void FShooterCombatBenchmarks::BenchLineOfSight(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults)
+{
+	const AShooterNPC* NPC = FindNPC(World);
+
+	const APlayerController* PC = World->GetFirstPlayerController();
+	const AActor* Target = PC ? PC->GetPawn() : nullptr;
+
+	if (!NPC || !Target)
+	{
+		UE_LOG(LogFirstPersonCity, Warning, TEXT("Combat benchmark LineOfSight skipped: needs an NPC and a player pawn"));
+		return;
+	}
+
+	int32 NumVisible = 0;
+
+	// a full half circle cone so the traces always run, whichever way the NPC faces
+	OutResults.Add(Measure(TEXT("LineOfSight"), Iterations, [&](int32 i)
+	{
+		NumVisible += FStateTreeLineOfSightToTargetCondition::HasLineOfSight(NPC, Target, 180.0f, 5) ? 1 : 0;
+	}));
+
+	UE_LOG(LogFirstPersonCity, Verbose, TEXT("Line of sight held for %d checks"), NumVisible);
+}
+
+void FShooterCombatBenchmarks::BenchIncrementTeamScore(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults)
+{
+	AShooterGameMode* GameMode = World->GetAuthGameMode<AShooterGameMode>();
+
+	if (!GameMode || !GameMode->GetShooterUI())
+	{
+		UE_LOG(LogFirstPersonCity, Warning, TEXT("Combat benchmark IncrementTeamScore skipped: needs a shooter game mode with its UI"));
+		return;
+	}
+
+	// score a team no one plays on, then forget it again
+	const uint8 BenchmarkTeam = 255;
+
+	OutResults.Add(Measure(TEXT("IncrementTeamScore"), Iterations, [&](int32 i)
+	{
+		GameMode->IncrementTeamScore(BenchmarkTeam);
+	}));
+
+	GameMode->ResetTeamScore(BenchmarkTeam);
+}
+
+bool FShooterCombatBenchmarks::WriteJson(UWorld* World, int32 Iterations, const TArray<FShooterBenchmarkResult>& Results, const FString& OutputPath)
+{
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	Root->SetStringField(TEXT("Project"), FApp::GetProjectName());
+	Root->SetStringField(TEXT("BuildVersion"), FApp::GetBuildVersion());
+	Root->SetStringField(TEXT("BuildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("EngineVersion"), FEngineVersion::Current().ToString());
+	Root->SetStringField(TEXT("Map"), World->GetMapName());
+	Root->SetStringField(TEXT("Timestamp"), FDateTime::UtcNow().ToIso8601());
+	Root->SetNumberField(TEXT("Iterations"), Iterations);
+
+	TArray<TSharedPtr<FJsonValue>> Benchmarks;
+
+	for (const FShooterBenchmarkResult& Result : Results)
+	{
+		TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+		Entry->SetStringField(TEXT("Name"), Result.Name);
+		Entry->SetNumberField(TEXT("Iterations"), Result.Iterations);
+		Entry->SetNumberField(TEXT("NsPerOp"), Result.NsPerOp);
+		Entry->SetNumberField(TEXT("AllocsPerOp"), Result.AllocsPerOp);
+		Entry->SetNumberField(TEXT("BytesPerOp"), Result.BytesPerOp);
+
+		Benchmarks.Add(MakeShared<FJsonValueObject>(Entry));
+	}
+
+	Root->SetArrayField(TEXT("Benchmarks"), Benchmarks);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+
+	if (!FJsonSerializer::Serialize(Root, Writer) || !FFileHelper::SaveStringToFile(Output, *OutputPath))
+	{
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Failed to write combat benchmark results to %s"), *OutputPath);
+		return false;
+	}
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Combat benchmark results for %d benchmarks written to %s"), Results.Num(), *OutputPath);
+
+	return true;
+}
+
+/** Runs the combat benchmarks against the current world */
+static FAutoConsoleCommand ShooterCombatBenchmarkCommand(
+	TEXT("Shooter.Bench.Combat"),
+	TEXT("Times the combat hot paths and writes ns/op and allocations/op to JSON. Usage: Shooter.Bench.Combat [Iterations] [OutputPath]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+
+		const FString OutputPath = Args.Num() > 1 ? Args[1] : FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("CombatBenchmark-%s.json"), *FDateTime::Now().ToString());
+
+		FShooterCombatBenchmarks::Run(World, Iterations, OutputPath);
+	}));
+
+#endif
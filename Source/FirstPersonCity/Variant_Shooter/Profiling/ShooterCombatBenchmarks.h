@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+class UWorld;
+
+/** Result of a single combat benchmark */
+struct FShooterBenchmarkResult
+{
+	/** Name the benchmark is tracked under between builds */
+	FString Name;
+
+	/** Number of timed operations */
+	int32 Iterations = 0;
+
+	/** Average wall time per operation */
+	double NsPerOp = 0.0;
+
+	/** Average number of game thread heap allocations per operation */
+	double AllocsPerOp = 0.0;
+
+	/** Average number of bytes allocated on the game thread per operation */
+	double BytesPerOp = 0.0;
+};
+
+/**
+ *  Micro benchmarks for the shooter combat hot paths
+ *  Runs against the actors already in a loaded world and reports time and allocations per operation
+ *  Results are written to JSON so deployed builds can be compared against each other
+ *  Run from the console with Shooter.Bench.Combat, or headless through Scripts/RunCombatBenchmarks.sh
+ */
+class FShooterCombatBenchmarks
+{
+public:
+
+	/** Runs every benchmark that has the actors it needs in the world and writes the results to the output path. Returns false if nothing could be saved */
+	static bool Run(UWorld* World, int32 Iterations, const FString& OutputPath);
+
+private:
+
+	/** AShooterWeapon::CalculateProjectileSpawnTransform on the first weapon in the world */
+	static void BenchProjectileSpawnTransform(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults);
+
+	/** AShooterProjectile::ExplosionCheck plus the damage it queues, against a growing number of overlapped actors */
+	static void BenchExplosionCheck(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults);
+
+	/** AShooterNPC::TakeDamage with zero damage so the NPC survives */
+	static void BenchNPCTakeDamage(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults);
+
+	/** The line of sight test behind FStateTreeLineOfSightToTargetCondition, from the first NPC to the first player */
+	static void BenchLineOfSight(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults);
+
+	/** AShooterGameMode::IncrementTeamScore on a team no one plays on */
+	static void BenchIncrementTeamScore(UWorld* World, int32 Iterations, TArray<FShooterBenchmarkResult>& OutResults);
+
+	/** Saves the results with enough build information to tell runs apart */
+	static bool WriteJson(UWorld* World, int32 Iterations, const TArray<FShooterBenchmarkResult>& Results, const FString& OutputPath);
+};
+
+#endif
@@ -0,0 +1,68 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterFrameBudget.h"
+
+#if SHOOTER_FRAME_BUDGET
+
+#include "HAL/PlatformTime.h"
+
+namespace
+{
+	/** Cycles spent per category since the last reset. Only written from the game thread */
+	uint64 GBudgetCycles[static_cast<int32>(EShooterBudgetCategory::Count)] = {};
+
+	/** Innermost budget scope running on this thread */
+	thread_local FShooterBudgetScope* GCurrentBudgetScope = nullptr;
+}
+
+void FShooterFrameBudget::Reset()
+{
+	FMemory::Memzero(GBudgetCycles, sizeof(GBudgetCycles));
+}
+
+double FShooterFrameBudget::GetMs(EShooterBudgetCategory Category)
+{
+	return FPlatformTime::ToMilliseconds64(GBudgetCycles[static_cast<int32>(Category)]);
+}
+
+FShooterBudgetScope::FShooterBudgetScope(EShooterBudgetCategory InCategory)
+	: Category(InCategory)
+	, Parent(GCurrentBudgetScope)
+{
+	StartCycles = FPlatformTime::Cycles64();
+
+	// pause the scope we interrupted
+	if (Parent)
+	{
+		Parent->Accumulate(StartCycles);
+	}
+
+	GCurrentBudgetScope = this;
+}
+
+FShooterBudgetScope::~FShooterBudgetScope()
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+
+	Accumulate(Now);
+
+	// resume the scope we interrupted
+	GCurrentBudgetScope = Parent;
+
+	if (Parent)
+	{
+		Parent->StartCycles = Now;
+	}
+}
+
+void FShooterBudgetScope::Accumulate(uint64 Now)
+{
+	// budgets only cover the game thread
+	if (IsInGameThread())
+	{
+		GBudgetCycles[static_cast<int32>(Category)] += Now - StartCycles;
+	}
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Frame budget timing is compiled out of shipping builds */
+#define SHOOTER_FRAME_BUDGET !UE_BUILD_SHIPPING
+
+/**
+ *  Gameplay systems whose game thread time is checked against a per frame budget
+ */
+enum class EShooterBudgetCategory : uint8
+{
+	AI,
+	Projectile,
+	Count
+};
+
+#if SHOOTER_FRAME_BUDGET
+
+/**
+ *  Game thread time spent in each budget category since the last reset
+ */
+class FIRSTPERSONCITY_API FShooterFrameBudget
+{
+public:
+
+	/** Clears the time gathered for every category */
+	static void Reset();
+
+	/** Returns the time spent in a category since the last reset, in milliseconds */
+	static double GetMs(EShooterBudgetCategory Category);
+};
+
+/**
+ *  Times game thread work towards a budget category until it goes out of scope
+ *  Timing is exclusive: a nested scope pauses its parent, so work is never counted twice
+ */
+class FIRSTPERSONCITY_API FShooterBudgetScope
+{
+public:
+
+	explicit FShooterBudgetScope(EShooterBudgetCategory InCategory);
+	~FShooterBudgetScope();
+
+private:
+
+	/** Adds the time since the last start to our category */
+	void Accumulate(uint64 Now);
+
+	/** Category this scope is timing */
+	EShooterBudgetCategory Category;
+
+	/** Cycle count the current timed span started at */
+	uint64 StartCycles;
+
+	/** Scope this one interrupted, if any */
+	FShooterBudgetScope* Parent;
+};
+
+#define SHOOTER_BUDGET_SCOPE(Category) FShooterBudgetScope PREPROCESSOR_JOIN(ShooterBudgetScope_, __LINE__)(EShooterBudgetCategory::Category)
+
+#else
+
+#define SHOOTER_BUDGET_SCOPE(Category)
+
+#endif
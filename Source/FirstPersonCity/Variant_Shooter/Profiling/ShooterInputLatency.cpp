@@ -0,0 +1,178 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterInputLatency.h"
+
+#if SHOOTER_INPUT_LATENCY
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "FirstPersonCity.h"
+
+namespace
+{
+	/** Width of each latency histogram bucket, in milliseconds */
+	constexpr double BucketMs = 0.5;
+
+	/** Number of latency buckets. Anything slower lands in the last one */
+	constexpr int32 NumBuckets = 400;
+
+	/** Number of frame delay buckets. Anything slower lands in the last one */
+	constexpr int32 NumFrameBuckets = 8;
+
+	/** Latest raw key press */
+	uint64 LastKeyCycles = 0;
+	uint64 LastKeyFrame = 0;
+
+	/** Fire input waiting for its shot */
+	bool bPending = false;
+	uint64 PendingCycles = 0;
+	uint64 PendingFrame = 0;
+
+	/** Latency distribution gathered so far */
+	uint32 LatencyBuckets[NumBuckets] = {};
+	uint32 FrameBuckets[NumFrameBuckets] = {};
+	uint32 NumSamples = 0;
+	double TotalMs = 0.0;
+	double MaxMs = 0.0;
+
+	/** Returns the upper edge of the bucket holding the given percentile */
+	double GetPercentileMs(double Percentile)
+	{
+		const uint32 Target = FMath::Max<uint32>(FMath::CeilToInt(Percentile * NumSamples), 1);
+		uint32 Count = 0;
+
+		for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			Count += LatencyBuckets[Bucket];
+
+			if (Count >= Target)
+			{
+				return (Bucket + 1) * BucketMs;
+			}
+		}
+
+		return MaxMs;
+	}
+}
+
+void FShooterInputLatency::OnKeyPressed(uint64 EventCycles)
+{
+	LastKeyCycles = EventCycles != 0 ? EventCycles : FPlatformTime::Cycles64();
+	LastKeyFrame = GFrameCounter;
+}
+
+void FShooterInputLatency::OnFireInput()
+{
+	// fire actions driven without a key press this frame, like touch widgets or bots, have nothing to measure from.
+	// Older presses belong to other keys, like movement held down before the trigger was pulled
+	if (LastKeyCycles == 0 || LastKeyFrame != GFrameCounter)
+	{
+		return;
+	}
+
+	bPending = true;
+	PendingCycles = LastKeyCycles;
+	PendingFrame = LastKeyFrame;
+
+	// a key press only starts one measurement
+	LastKeyCycles = 0;
+}
+
+void FShooterInputLatency::OnFireStopped()
+{
+	bPending = false;
+}
+
+void FShooterInputLatency::OnShotSpawned()
+{
+	if (!bPending)
+	{
+		return;
+	}
+
+	bPending = false;
+
+	const double LatencyMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - PendingCycles);
+	const uint64 Frames = GFrameCounter - PendingFrame;
+
+	++LatencyBuckets[FMath::Min(FMath::FloorToInt(LatencyMs / BucketMs), NumBuckets - 1)];
+	++FrameBuckets[FMath::Min<uint64>(Frames, NumFrameBuckets - 1)];
+
+	++NumSamples;
+	TotalMs += LatencyMs;
+	MaxMs = FMath::Max(MaxMs, LatencyMs);
+}
+
+void FShooterInputLatency::Reset()
+{
+	FMemory::Memzero(LatencyBuckets, sizeof(LatencyBuckets));
+	FMemory::Memzero(FrameBuckets, sizeof(FrameBuckets));
+
+	NumSamples = 0;
+	TotalMs = MaxMs = 0.0;
+	bPending = false;
+	LastKeyCycles = 0;
+}
+
+void FShooterInputLatency::Report(const FString& CsvPath)
+{
+	if (NumSamples == 0)
+	{
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Input latency: no shots measured yet"));
+		return;
+	}
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Input to shot latency over %u shots: mean %.2f ms, p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.2f ms"),
+		NumSamples, TotalMs / NumSamples, GetPercentileMs(0.5), GetPercentileMs(0.9), GetPercentileMs(0.99), MaxMs);
+
+	for (int32 Frames = 0; Frames < NumFrameBuckets; ++Frames)
+	{
+		if (FrameBuckets[Frames] > 0)
+		{
+			UE_LOG(LogFirstPersonCity, Display, TEXT("  %d%s frames after input: %u shots (%.1f%%)"),
+				Frames, Frames == NumFrameBuckets - 1 ? TEXT("+") : TEXT(""), FrameBuckets[Frames], 100.0 * FrameBuckets[Frames] / NumSamples);
+		}
+	}
+
+	if (CsvPath.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FString> Lines;
+	Lines.Add(TEXT("LatencyMs,Shots"));
+
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		if (LatencyBuckets[Bucket] > 0)
+		{
+			Lines.Add(FString::Printf(TEXT("%.1f,%u"), Bucket * BucketMs, LatencyBuckets[Bucket]));
+		}
+	}
+
+	if (FFileHelper::SaveStringArrayToFile(Lines, *CsvPath))
+	{
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Input latency histogram written to %s"), *CsvPath);
+
+	} else {
+
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Failed to write input latency histogram to %s"), *CsvPath);
+	}
+}
+
+static FAutoConsoleCommand ShooterInputLatencyReportCommand(
+	TEXT("Shooter.InputLatency.Report"),
+	TEXT("Logs the input to shot latency distribution. Usage: Shooter.InputLatency.Report [CsvPath]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FShooterInputLatency::Report(Args.Num() > 0 ? Args[0] : FString());
+	}));
+
+static FAutoConsoleCommand ShooterInputLatencyResetCommand(
+	TEXT("Shooter.InputLatency.Reset"),
+	TEXT("Clears the input to shot latency samples"),
+	FConsoleCommandDelegate::CreateStatic(&FShooterInputLatency::Reset));
+
+#endif
@@ -0,0 +1,41 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Input latency measurement is compiled out of shipping builds */
+#define SHOOTER_INPUT_LATENCY !UE_BUILD_SHIPPING
+
+#if SHOOTER_INPUT_LATENCY
+
+/**
+ *  Measures the time from the raw input event behind a trigger press to the local projectile spawn it causes
+ *  Only the first shot of each press is measured, so full auto refire doesn't count as input latency
+ *  Measurements only start from a key pressed on the same frame as the fire input, so unrelated earlier keys are never used
+ *  Report the distribution with Shooter.InputLatency.Report and clear it with Shooter.InputLatency.Reset
+ */
+class FIRSTPERSONCITY_API FShooterInputLatency
+{
+public:
+
+	/** Records a raw key press. Zero timestamps are replaced with the current time */
+	static void OnKeyPressed(uint64 EventCycles);
+
+	/** Starts measuring from a key pressed this frame. Called when the fire input action starts */
+	static void OnFireInput();
+
+	/** Drops the pending measurement, if any. Called when the fire input action stops */
+	static void OnFireStopped();
+
+	/** Completes the pending measurement, if any. Called when a locally controlled weapon spawns its shot */
+	static void OnShotSpawned();
+
+	/** Clears every sample */
+	static void Reset();
+
+	/** Logs the latency distribution, and writes the histogram as CSV if a path is passed */
+	static void Report(const FString& CsvPath);
+};
+
+#endif
@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ *  Allocator that forwards everything to the allocator it replaced and reports each allocation
+ *  Installed over GMalloc by profiling tools while they measure. Builds that bind FMemory to a fixed allocator bypass it
+ *  Proxies must outlive any thread that might still be inside them, so they're meant to be static objects
+ */
+class FShooterMallocProxy : public FMalloc
+{
+public:
+
+	/** Routes allocations through this proxy. Must be called on the game thread */
+	void Install()
+	{
+		check(IsInGameThread());
+
+		if (GMalloc != this)
+		{
+			Inner = GMalloc;
+			GMalloc = this;
+		}
+	}
+
+	/** Restores the allocator this proxy replaced. Proxies installed on top of this one must be uninstalled first */
+	void Uninstall()
+	{
+		check(IsInGameThread());
+
+		if (GMalloc == this)
+		{
+			GMalloc = Inner;
+		}
+	}
+
+	/** Returns true if this proxy is the current allocator */
+	bool IsInstalled() const { return GMalloc == this; }
+
+protected:
+
+	/** Called for every allocation and growing reallocation, from any thread */
+	virtual void OnAllocation(SIZE_T Size) = 0;
+
+public:
+
+	//~Begin FMalloc interface
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		OnAllocation(Count);
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		OnAllocation(Count);
+		return Inner->TryMalloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		// growing an allocation costs the same as a fresh one for our purposes
+		if (Count > 0)
+		{
+			OnAllocation(Count);
+		}
+
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Count > 0)
+		{
+			OnAllocation(Count);
+		}
+
+		return Inner->TryRealloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void MarkTLSCachesAsUsedOnCurrentThread() override { Inner->MarkTLSCachesAsUsedOnCurrentThread(); }
+	virtual void MarkTLSCachesAsUnusedOnCurrentThread() override { Inner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+
+	//~End FMalloc interface
+
+protected:
+
+	/** Allocator every call is forwarded to */
+	FMalloc* Inner = nullptr;
+};
+
+#endif
@@ -0,0 +1,237 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterNetBenchmarkSubsystem.h"
+#include "ShooterCharacter.h"
+#include "ShooterReplicationGraph.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformMisc.h"
+#include "FirstPersonCity.h"
+
+bool UShooterNetBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// only exists while benchmarking
+	return Super::ShouldCreateSubsystem(Outer) && (FParse::Param(FCommandLine::Get(), TEXT("NetBench")) || FParse::Param(FCommandLine::Get(), TEXT("NetBenchBot")));
+}
+
+bool UShooterNetBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterNetBenchmarkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	const ENetMode NetMode = InWorld.GetNetMode();
+
+	FParse::Value(CommandLine, TEXT("NetBenchDuration="), Duration);
+
+	if (FParse::Param(CommandLine, TEXT("NetBench")) && (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer))
+	{
+		bRecording = true;
+
+		if (!FParse::Value(CommandLine, TEXT("NetBenchCSV="), CsvPath))
+		{
+			CsvPath = FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("NetBenchmark-%s.csv"), *FDateTime::Now().ToString());
+		}
+
+		CsvRows.Add(TEXT("Time,Connection,RemoteAddress,OutBytesPerSec,InBytesPerSec,OutPacketsPerSec,ServerTickMs,ServerTickMaxMs,ReplicateActorsMs"));
+
+		// hook the frame so we can time the whole tick. Replication itself is timed by the replication graph
+		TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UShooterNetBenchmarkSubsystem::OnWorldTickStart);
+		PostTickFlushHandle = InWorld.OnPostTickFlush().AddUObject(this, &UShooterNetBenchmarkSubsystem::OnPostTickFlush);
+
+		RecordingStartTime = SampleStartTime = FPlatformTime::Seconds();
+
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Network benchmark recording for %.0fs to %s"), Duration, *CsvPath);
+
+		const UNetDriver* NetDriver = InWorld.GetNetDriver();
+
+		if (!NetDriver || !Cast<UShooterReplicationGraph>(NetDriver->GetReplicationDriver()))
+		{
+			UE_LOG(LogFirstPersonCity, Warning, TEXT("Network benchmark needs the shooter replication graph to time ServerReplicateActors. ReplicateActorsMs will read 0"));
+		}
+	}
+
+	if (FParse::Param(CommandLine, TEXT("NetBenchBot")) && NetMode == NM_Client)
+	{
+		bBot = true;
+	}
+}
+
+void UShooterNetBenchmarkSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+
+	if (UWorld* World = GetWorld())
+	{
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+bool UShooterNetBenchmarkSubsystem::IsTickable() const
+{
+	return bRecording || bBot;
+}
+
+void UShooterNetBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	if (bBot)
+	{
+		TickBot(DeltaTime);
+	}
+
+	if (!bRecording)
+	{
+		return;
+	}
+
+	const double Time = FPlatformTime::Seconds();
+
+	// connection bandwidth stats update once per second, so sample at the same rate
+	if (Time - SampleStartTime >= 1.0)
+	{
+		RecordSample(Time);
+	}
+
+	if (Time - RecordingStartTime >= Duration)
+	{
+		FinishRecording();
+	}
+}
+
+TStatId UShooterNetBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterNetBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterNetBenchmarkSubsystem::OnWorldTickStart(UWorld* TickedWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (TickedWorld == GetWorld())
+	{
+		TickStartTime = FPlatformTime::Seconds();
+	}
+}
+
+void UShooterNetBenchmarkSubsystem::OnPostTickFlush()
+{
+	// ignore partial frames from before the hooks were installed
+	if (TickStartTime <= 0.0)
+	{
+		return;
+	}
+
+	const double Time = FPlatformTime::Seconds();
+	const double TickTime = Time - TickStartTime;
+
+	++SampleFrames;
+	SampleTickTime += TickTime;
+	SampleMaxTickTime = FMath::Max(SampleMaxTickTime, TickTime);
+
+	// the net driver's tick flush has just run ServerReplicateActors
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		if (const UShooterReplicationGraph* ReplicationGraph = Cast<UShooterReplicationGraph>(NetDriver->GetReplicationDriver()))
+		{
+			SampleReplicateActorsTime += ReplicationGraph->GetLastReplicateActorsTime();
+		}
+	}
+}
+
+void UShooterNetBenchmarkSubsystem::RecordSample(double Time)
+{
+	const double FrameCount = FMath::Max(SampleFrames, 1);
+	const double TickMs = SampleTickTime * 1000.0 / FrameCount;
+	const double MaxTickMs = SampleMaxTickTime * 1000.0;
+	const double ReplicateActorsMs = SampleReplicateActorsTime * 1000.0 / FrameCount;
+	const double ElapsedTime = Time - RecordingStartTime;
+
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		for (int32 ConnectionIndex = 0; ConnectionIndex < NetDriver->ClientConnections.Num(); ++ConnectionIndex)
+		{
+			const UNetConnection* Connection = NetDriver->ClientConnections[ConnectionIndex];
+
+			if (!Connection)
+			{
+				continue;
+			}
+
+			CsvRows.Add(FString::Printf(TEXT("%.2f,%d,%s,%d,%d,%d,%.3f,%.3f,%.3f"),
+				ElapsedTime, ConnectionIndex, *Connection->LowLevelGetRemoteAddress(true),
+				Connection->OutBytesPerSecond, Connection->InBytesPerSecond, Connection->OutPacketsPerSecond,
+				TickMs, MaxTickMs, ReplicateActorsMs));
+		}
+	}
+
+	// start the next sample
+	SampleStartTime = Time;
+	SampleFrames = 0;
+	SampleTickTime = SampleMaxTickTime = SampleReplicateActorsTime = 0.0;
+}
+
+void UShooterNetBenchmarkSubsystem::FinishRecording()
+{
+	bRecording = false;
+
+	if (FFileHelper::SaveStringArrayToFile(CsvRows, *CsvPath))
+	{
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Network benchmark wrote %d rows to %s"), CsvRows.Num() - 1, *CsvPath);
+
+	} else {
+
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Network benchmark couldn't write %s"), *CsvPath);
+	}
+
+	// the launcher script waits for the server to exit
+	FPlatformMisc::RequestExit(false);
+}
+
+void UShooterNetBenchmarkSubsystem::TickBot(float DeltaTime)
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	AShooterCharacter* Character = PlayerController ? Cast<AShooterCharacter>(PlayerController->GetPawn()) : nullptr;
+
+	if (!Character)
+	{
+		return;
+	}
+
+	// start shooting with every new character we possess
+	if (Character != BotCharacter.Get())
+	{
+		BotCharacter = Character;
+		BotRetriggerTime = 0.0f;
+	}
+
+	BotTime += DeltaTime;
+
+	// walk a figure eight through the same input paths as a player
+	Character->DoMove(FMath::Sin(BotTime * 0.7f), FMath::Cos(BotTime * 0.5f));
+
+	// sweep the aim back and forth
+	Character->DoAim(FMath::Sin(BotTime * 0.9f) * 90.0f * DeltaTime, FMath::Sin(BotTime * 1.3f) * 10.0f * DeltaTime);
+
+	// keep the trigger held, re-pulling it every so often to pick up new weapons and semi auto refires
+	BotRetriggerTime -= DeltaTime;
+
+	if (BotRetriggerTime <= 0.0f)
+	{
+		Character->DoStopFiring();
+		Character->DoStartFiring();
+
+		BotRetriggerTime = 1.0f;
+	}
+}
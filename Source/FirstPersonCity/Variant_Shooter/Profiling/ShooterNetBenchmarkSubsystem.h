@@ -0,0 +1,101 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterNetBenchmarkSubsystem.generated.h"
+
+class AShooterCharacter;
+
+/**
+ *  Drives the shooter network benchmark. Only created when the game is launched with -NetBench or -NetBenchBot
+ *  -NetBench: the server records per connection bandwidth, server tick time and ServerReplicateActors time into a CSV,
+ *  then exits after -NetBenchDuration seconds. The CSV goes to -NetBenchCSV, or Saved/Profiling by default
+ *  -NetBenchBot: the client drives its shooter character through scripted movement, aim and full auto fire
+ */
+UCLASS()
+class FIRSTPERSONCITY_API UShooterNetBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** If true, this is a server recording the benchmark */
+	bool bRecording = false;
+
+	/** If true, this is a client driving a bot */
+	bool bBot = false;
+
+	/** Length of the benchmark, in seconds */
+	float Duration = 60.0f;
+
+	/** Output CSV path */
+	FString CsvPath;
+
+	/** CSV rows recorded so far */
+	TArray<FString> CsvRows;
+
+	/** Real time the recording started at */
+	double RecordingStartTime = 0.0;
+
+	/** Real time the current sample started at */
+	double SampleStartTime = 0.0;
+
+	/** Number of frames in the current sample */
+	int32 SampleFrames = 0;
+
+	/** Total server tick time in the current sample */
+	double SampleTickTime = 0.0;
+
+	/** Longest server tick in the current sample */
+	double SampleMaxTickTime = 0.0;
+
+	/** Total ServerReplicateActors time in the current sample, as timed by the shooter replication graph */
+	double SampleReplicateActorsTime = 0.0;
+
+	/** Time the current world tick started */
+	double TickStartTime = 0.0;
+
+	/** Delegate handles for the frame timing hooks */
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostTickFlushHandle;
+
+	/** Character currently driven by the bot */
+	TWeakObjectPtr<AShooterCharacter> BotCharacter;
+
+	/** Time the bot has been driving its character */
+	float BotTime = 0.0f;
+
+	/** Time left before the bot re-triggers its weapon */
+	float BotRetriggerTime = 0.0f;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+protected:
+
+	/** Marks the start of the server tick */
+	void OnWorldTickStart(UWorld* TickedWorld, ELevelTick TickType, float DeltaSeconds);
+
+	/** Marks the end of the server tick, including the net driver's tick flush */
+	void OnPostTickFlush();
+
+	/** Records one row per client connection for the current sample */
+	void RecordSample(double Time);
+
+	/** Writes the CSV and shuts down the server */
+	void FinishRecording();
+
+	/** Drives the local shooter character */
+	void TickBot(float DeltaTime);
+};
@@ -0,0 +1,454 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterPerfGateSubsystem.h"
+#include "ShooterFrameBudget.h"
+#include "ShooterNPC.h"
+#include "ShooterProjectile.h"
+#include "ShooterPickup.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerStart.h"
+#include "EngineUtils.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformMisc.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "ProfilingDebugging/TraceAuxiliary.h"
+#include "FirstPersonCity.h"
+
+bool UShooterPerfGateSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if SHOOTER_FRAME_BUDGET
+	// only exists while gating
+	return Super::ShouldCreateSubsystem(Outer) && FParse::Param(FCommandLine::Get(), TEXT("PerfGate"));
+#else
+	return false;
+#endif
+}
+
+bool UShooterPerfGateSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterPerfGateSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	const FShooterPerfScenario AllScenarios[] =
+	{
+		{ TEXT("Firefight10"), EShooterPerfScenarioType::Firefight, 10 },
+		{ TEXT("Firefight50"), EShooterPerfScenarioType::Firefight, 50 },
+		{ TEXT("Firefight200"), EShooterPerfScenarioType::Firefight, 200 },
+		{ TEXT("Explosions50"), EShooterPerfScenarioType::Explosions, 50 },
+		{ TEXT("Pickups100"), EShooterPerfScenarioType::Pickups, 100 }
+	};
+
+	// run every scenario unless some were picked on the command line
+	FString ScenarioList;
+	TArray<FString> ScenarioNames;
+
+	if (FParse::Value(CommandLine, TEXT("PerfGateScenarios="), ScenarioList))
+	{
+		ScenarioList.ParseIntoArray(ScenarioNames, TEXT(","));
+	}
+
+	for (const FShooterPerfScenario& Scenario : AllScenarios)
+	{
+		if (ScenarioNames.IsEmpty() || ScenarioNames.Contains(Scenario.Name))
+		{
+			Scenarios.Add(Scenario);
+		}
+	}
+
+	if (!FParse::Value(CommandLine, TEXT("PerfGateReport="), ReportPath))
+	{
+		ReportPath = FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("PerfGate-%s.csv"), *FDateTime::Now().ToString());
+	}
+
+	ReportRows.Add(TEXT("Scenario,Frames,GameThreadMs,GameThreadMaxMs,AIMs,ProjectileMs,Passed,Trace"));
+
+	// hook the frame so we can time the whole tick
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UShooterPerfGateSubsystem::OnWorldTickStart);
+	PostTickFlushHandle = InWorld.OnPostTickFlush().AddUObject(this, &UShooterPerfGateSubsystem::OnPostTickFlush);
+
+	bRunning = true;
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Perf gate running %d scenarios, report to %s"), Scenarios.Num(), *ReportPath);
+}
+
+void UShooterPerfGateSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+
+	if (UWorld* World = GetWorld())
+	{
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+bool UShooterPerfGateSubsystem::IsTickable() const
+{
+	return bRunning;
+}
+
+void UShooterPerfGateSubsystem::Tick(float DeltaTime)
+{
+	if (ScenarioIndex == INDEX_NONE)
+	{
+		StartNextScenario();
+		return;
+	}
+
+	PhaseTime += DeltaTime;
+
+	DriveScenario(DeltaTime);
+
+	if (!bMeasuring && PhaseTime >= WarmupTime)
+	{
+		// the scenario has settled, start sampling frames
+		bMeasuring = true;
+		PhaseTime = 0.0f;
+
+		GameThreadSamples.Reset();
+		AISamples.Reset();
+		ProjectileSamples.Reset();
+
+		TRACE_BOOKMARK(TEXT("PerfGate measure %s"), *Scenarios[ScenarioIndex].Name);
+
+	} else if (bMeasuring && PhaseTime >= MeasureTime) {
+
+		FinishScenario();
+		StartNextScenario();
+	}
+}
+
+TStatId UShooterPerfGateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterPerfGateSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterPerfGateSubsystem::OnWorldTickStart(UWorld* TickedWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (TickedWorld == GetWorld())
+	{
+		TickStartTime = FPlatformTime::Seconds();
+
+#if SHOOTER_FRAME_BUDGET
+		FShooterFrameBudget::Reset();
+#endif
+	}
+}
+
+void UShooterPerfGateSubsystem::OnPostTickFlush()
+{
+	// ignore partial frames from before the hooks were installed
+	if (!bMeasuring || TickStartTime <= 0.0)
+	{
+		return;
+	}
+
+	GameThreadSamples.Add((FPlatformTime::Seconds() - TickStartTime) * 1000.0);
+
+#if SHOOTER_FRAME_BUDGET
+	AISamples.Add(FShooterFrameBudget::GetMs(EShooterBudgetCategory::AI));
+	ProjectileSamples.Add(FShooterFrameBudget::GetMs(EShooterBudgetCategory::Projectile));
+#endif
+}
+
+void UShooterPerfGateSubsystem::StartNextScenario()
+{
+	while (++ScenarioIndex < Scenarios.Num())
+	{
+		const FShooterPerfScenario& Scenario = Scenarios[ScenarioIndex];
+
+		bMeasuring = false;
+		PhaseTime = 0.0f;
+		ActionTime = 0.0f;
+		SpawnStream.Initialize(ScenarioIndex + 1);
+
+		// spread everything around the first player start
+		TActorIterator<APlayerStart> PlayerStart(GetWorld());
+		ScenarioOrigin = PlayerStart ? PlayerStart->GetActorLocation() : FVector::ZeroVector;
+
+		bool bReady = true;
+
+		switch (Scenario.Type)
+		{
+		case EShooterPerfScenarioType::Firefight:
+
+			if (UClass* LoadedNPCClass = NPCClass.LoadSynchronous())
+			{
+				FActorSpawnParameters SpawnParams;
+				SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+				for (int32 i = 0; i < Scenario.Count; ++i)
+				{
+					FVector Location;
+
+					if (!FindSpawnLocation(Location))
+					{
+						continue;
+					}
+
+					// face the middle of the fight
+					const FRotator Rotation((ScenarioOrigin - Location).GetSafeNormal2D().Rotation());
+
+					if (AShooterNPC* NPC = GetWorld()->SpawnActor<AShooterNPC>(LoadedNPCClass, Location + FVector(0.0f, 0.0f, 100.0f), Rotation, SpawnParams))
+					{
+						if (!NPC->GetController())
+						{
+							NPC->SpawnDefaultController();
+						}
+
+						SpawnedActors.Add(NPC);
+					}
+				}
+
+			} else {
+
+				bReady = false;
+			}
+
+			break;
+
+		case EShooterPerfScenarioType::Explosions:
+
+			// volleys are spawned while the scenario runs
+			bReady = !ExplosiveProjectileClass.IsNull() && ExplosiveProjectileClass.LoadSynchronous() != nullptr;
+			break;
+
+		case EShooterPerfScenarioType::Pickups:
+
+			if (UClass* LoadedPickupClass = PickupClass.LoadSynchronous())
+			{
+				for (int32 i = 0; i < Scenario.Count; ++i)
+				{
+					FVector Location;
+
+					if (FindSpawnLocation(Location))
+					{
+						if (AShooterPickup* Pickup = GetWorld()->SpawnActor<AShooterPickup>(LoadedPickupClass, Location, FRotator::ZeroRotator))
+						{
+							SpawnedActors.Add(Pickup);
+						}
+					}
+				}
+
+			} else {
+
+				bReady = false;
+			}
+
+			break;
+		}
+
+		if (bReady)
+		{
+			TRACE_BOOKMARK(TEXT("PerfGate start %s"), *Scenario.Name);
+
+			UE_LOG(LogFirstPersonCity, Display, TEXT("Perf gate scenario %s started with %d actors"), *Scenario.Name, SpawnedActors.Num());
+			return;
+		}
+
+		// a gate that can't run its scenario can't vouch for the build
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Perf gate scenario %s has no class configured in [/Script/FirstPersonCity.ShooterPerfGateSubsystem]"), *Scenario.Name);
+
+		ReportRows.Add(FString::Printf(TEXT("%s,0,,,,,0,"), *Scenario.Name));
+		bAllPassed = false;
+	}
+
+	FinishRun();
+}
+
+void UShooterPerfGateSubsystem::FinishScenario()
+{
+	const FShooterPerfScenario& Scenario = Scenarios[ScenarioIndex];
+
+	// returns the sample at the budget percentile
+	auto GetPercentile = [this](TArray<float>& Samples)
+	{
+		if (Samples.IsEmpty())
+		{
+			return 0.0f;
+		}
+
+		Samples.Sort();
+
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(BudgetPercentile * Samples.Num()) - 1, 0, Samples.Num() - 1);
+		return Samples[Index];
+	};
+
+	const int32 NumFrames = GameThreadSamples.Num();
+	const float GameThreadMaxMs = NumFrames > 0 ? FMath::Max(GameThreadSamples) : 0.0f;
+	const float GameThreadMs = GetPercentile(GameThreadSamples);
+	const float AIMs = GetPercentile(AISamples);
+	const float ProjectileMs = GetPercentile(ProjectileSamples);
+
+	const bool bPassed = NumFrames > 0 && GameThreadMs <= GameThreadBudgetMs && AIMs <= AIBudgetMs && ProjectileMs <= ProjectileBudgetMs;
+
+	FString TracePath;
+
+	if (bPassed)
+	{
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Perf gate scenario %s passed: game thread %.2f ms, AI %.2f ms, projectiles %.2f ms over %d frames"),
+			*Scenario.Name, GameThreadMs, AIMs, ProjectileMs, NumFrames);
+
+	} else {
+
+		// save the recent trace history so the over budget frames can be inspected
+		TracePath = FPaths::GetPath(ReportPath) / FString::Printf(TEXT("PerfGate-%s-%s.utrace"), *Scenario.Name, *FDateTime::Now().ToString());
+
+		if (!FTraceAuxiliary::WriteSnapshot(*TracePath))
+		{
+			TracePath.Reset();
+		}
+
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Perf gate scenario %s over budget: game thread %.2f/%.2f ms, AI %.2f/%.2f ms, projectiles %.2f/%.2f ms over %d frames. Trace: %s"),
+			*Scenario.Name, GameThreadMs, GameThreadBudgetMs, AIMs, AIBudgetMs, ProjectileMs, ProjectileBudgetMs, NumFrames, TracePath.IsEmpty() ? TEXT("none") : *TracePath);
+
+		bAllPassed = false;
+	}
+
+	ReportRows.Add(FString::Printf(TEXT("%s,%d,%.3f,%.3f,%.3f,%.3f,%d,%s"), *Scenario.Name, NumFrames, GameThreadMs, GameThreadMaxMs, AIMs, ProjectileMs, bPassed ? 1 : 0, *TracePath));
+
+	// clean up before the next scenario so it starts from the same state
+	for (const TWeakObjectPtr<AActor>& SpawnedActor : SpawnedActors)
+	{
+		if (AActor* Actor = SpawnedActor.Get())
+		{
+			Actor->Destroy();
+		}
+	}
+
+	SpawnedActors.Reset();
+
+	bMeasuring = false;
+
+	GEngine->ForceGarbageCollection(true);
+}
+
+void UShooterPerfGateSubsystem::DriveScenario(float DeltaTime)
+{
+	const FShooterPerfScenario& Scenario = Scenarios[ScenarioIndex];
+
+	ActionTime -= DeltaTime;
+
+	if (ActionTime > 0.0f)
+	{
+		return;
+	}
+
+	switch (Scenario.Type)
+	{
+	case EShooterPerfScenarioType::Explosions:
+
+		ActionTime += ExplosionInterval;
+		SpawnExplosions(Scenario.Count);
+		break;
+
+	case EShooterPerfScenarioType::Pickups:
+
+		ActionTime += PickupInterval;
+		CyclePickups();
+		break;
+
+	default:
+
+		// firefights drive themselves
+		ActionTime = MeasureTime;
+		break;
+	}
+}
+
+void UShooterPerfGateSubsystem::SpawnExplosions(int32 Count)
+{
+	UClass* LoadedProjectileClass = ExplosiveProjectileClass.Get();
+
+	if (!LoadedProjectileClass)
+	{
+		return;
+	}
+
+	// forget projectiles that already went off
+	SpawnedActors.RemoveAll([](const TWeakObjectPtr<AActor>& SpawnedActor) { return !SpawnedActor.IsValid(); });
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// fire every projectile straight into the ground so they all explode on the same frame
+	for (int32 i = 0; i < Count; ++i)
+	{
+		FVector Location;
+
+		if (FindSpawnLocation(Location))
+		{
+			if (AShooterProjectile* Projectile = GetWorld()->SpawnActor<AShooterProjectile>(LoadedProjectileClass, Location + FVector(0.0f, 0.0f, 50.0f), FRotator(-90.0f, 0.0f, 0.0f), SpawnParams))
+			{
+				SpawnedActors.Add(Projectile);
+			}
+		}
+	}
+}
+
+void UShooterPerfGateSubsystem::CyclePickups()
+{
+	for (const TWeakObjectPtr<AActor>& SpawnedActor : SpawnedActors)
+	{
+		AShooterPickup* Pickup = Cast<AShooterPickup>(SpawnedActor.Get());
+
+		// only pickups that finished their last respawn
+		if (!Pickup || !Pickup->IsAvailable())
+		{
+			continue;
+		}
+
+		// same state change as a real pickup, without granting a weapon
+		Pickup->ForcePickUp();
+	}
+}
+
+bool UShooterPerfGateSubsystem::FindSpawnLocation(FVector& OutLocation)
+{
+	const FVector2D Offset = FVector2D(SpawnStream.FRandRange(-1.0f, 1.0f), SpawnStream.FRandRange(-1.0f, 1.0f)).GetSafeNormal() * SpawnStream.FRandRange(200.0f, SpawnRadius);
+	const FVector Start = ScenarioOrigin + FVector(Offset.X, Offset.Y, 2000.0f);
+	const FVector End = Start - FVector(0.0f, 0.0f, 10000.0f);
+
+	FHitResult OutHit;
+
+	if (GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility))
+	{
+		OutLocation = OutHit.ImpactPoint;
+		return true;
+	}
+
+	return false;
+}
+
+void UShooterPerfGateSubsystem::FinishRun()
+{
+	bRunning = false;
+
+	if (FFileHelper::SaveStringArrayToFile(ReportRows, *ReportPath))
+	{
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Perf gate report written to %s"), *ReportPath);
+
+	} else {
+
+		UE_LOG(LogFirstPersonCity, Error, TEXT("Perf gate couldn't write %s"), *ReportPath);
+		bAllPassed = false;
+	}
+
+	UE_LOG(LogFirstPersonCity, Display, TEXT("Perf gate %s"), bAllPassed ? TEXT("passed") : TEXT("failed"));
+
+	// the launcher script turns the exit code into the gate result
+	FPlatformMisc::RequestExitWithStatus(false, bAllPassed ? 0 : 1);
+}
@@ -0,0 +1,187 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterPerfGateSubsystem.generated.h"
+
+class AShooterNPC;
+class AShooterProjectile;
+class AShooterPickup;
+
+/**
+ *  Kinds of load a perf gate scenario puts on the game
+ */
+enum class EShooterPerfScenarioType : uint8
+{
+	Firefight,
+	Explosions,
+	Pickups
+};
+
+/**
+ *  A scripted perf gate scenario
+ */
+struct FShooterPerfScenario
+{
+	/** Name used on the command line and in the report */
+	FString Name;
+
+	/** Kind of load to generate */
+	EShooterPerfScenarioType Type;
+
+	/** Number of NPCs, explosions per volley or pickups */
+	int32 Count;
+};
+
+/**
+ *  Runs scripted load scenarios and checks per frame game thread, AI and projectile time against budgets
+ *  Only created when the game is launched with -PerfGate. Runs every scenario, or the ones listed in -PerfGateScenarios=A,B
+ *  A failing scenario writes a trace snapshot next to the report. The game exits with a nonzero code if any scenario failed
+ *  Budgets and scenario classes are set in the [/Script/FirstPersonCity.ShooterPerfGateSubsystem] section of DefaultGame.ini
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterPerfGateSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** NPC spawned for the firefight scenarios */
+	UPROPERTY(Config)
+	TSoftClassPtr<AShooterNPC> NPCClass;
+
+	/** Explosive projectile spawned for the explosion scenarios */
+	UPROPERTY(Config)
+	TSoftClassPtr<AShooterProjectile> ExplosiveProjectileClass;
+
+	/** Pickup spawned for the pickup scenarios */
+	UPROPERTY(Config)
+	TSoftClassPtr<AShooterPickup> PickupClass;
+
+	/** Time each scenario runs before it's measured */
+	UPROPERTY(Config)
+	float WarmupTime = 3.0f;
+
+	/** Time each scenario is measured for */
+	UPROPERTY(Config)
+	float MeasureTime = 10.0f;
+
+	/** Game thread time per frame allowed, in milliseconds */
+	UPROPERTY(Config)
+	float GameThreadBudgetMs = 16.6f;
+
+	/** Time per frame allowed in shooter AI code, in milliseconds */
+	UPROPERTY(Config)
+	float AIBudgetMs = 4.0f;
+
+	/** Time per frame allowed in shooter projectile code, in milliseconds */
+	UPROPERTY(Config)
+	float ProjectileBudgetMs = 2.0f;
+
+	/** Frame percentile checked against the budgets, so a single hitch doesn't fail the gate */
+	UPROPERTY(Config)
+	float BudgetPercentile = 0.95f;
+
+	/** Time between explosion volleys */
+	UPROPERTY(Config)
+	float ExplosionInterval = 1.0f;
+
+	/** Time between forced pickups of every available pickup */
+	UPROPERTY(Config)
+	float PickupInterval = 1.0f;
+
+	/** Radius around the player start scenario actors are spread over */
+	UPROPERTY(Config)
+	float SpawnRadius = 3000.0f;
+
+	/** If true, the gate is running its scenarios */
+	bool bRunning = false;
+
+	/** Scenarios to run, in order */
+	TArray<FShooterPerfScenario> Scenarios;
+
+	/** Index of the running scenario */
+	int32 ScenarioIndex = INDEX_NONE;
+
+	/** If true, the running scenario is past its warmup */
+	bool bMeasuring = false;
+
+	/** Time the running scenario has been in its current phase */
+	float PhaseTime = 0.0f;
+
+	/** Time left before the next explosion volley or pickup cycle */
+	float ActionTime = 0.0f;
+
+	/** Location scenario actors are spread around */
+	FVector ScenarioOrigin = FVector::ZeroVector;
+
+	/** Random stream for scenario spawn locations, seeded so runs are comparable */
+	FRandomStream SpawnStream;
+
+	/** Actors spawned by the running scenario */
+	TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+
+	/** Per frame samples for the running scenario, in milliseconds */
+	TArray<float> GameThreadSamples;
+	TArray<float> AISamples;
+	TArray<float> ProjectileSamples;
+
+	/** Report rows gathered so far */
+	TArray<FString> ReportRows;
+
+	/** Report output path */
+	FString ReportPath;
+
+	/** If true, every scenario so far stayed within budget */
+	bool bAllPassed = true;
+
+	/** Time the current world tick started */
+	double TickStartTime = 0.0;
+
+	/** Delegate handles for the frame timing hooks */
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostTickFlushHandle;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+protected:
+
+	/** Marks the start of the frame and clears the budget counters */
+	void OnWorldTickStart(UWorld* TickedWorld, ELevelTick TickType, float DeltaSeconds);
+
+	/** Samples the frame's times while measuring */
+	void OnPostTickFlush();
+
+	/** Spawns the actors for the next scenario, or finishes the run if there are none left */
+	void StartNextScenario();
+
+	/** Checks the running scenario's samples against the budgets and records the result */
+	void FinishScenario();
+
+	/** Generates the running scenario's periodic load */
+	void DriveScenario(float DeltaTime);
+
+	/** Spawns a volley of explosive projectiles into the ground */
+	void SpawnExplosions(int32 Count);
+
+	/** Picks up every available pickup so they all go through their respawn */
+	void CyclePickups();
+
+	/** Finds a random spot on the ground around the scenario origin */
+	bool FindSpawnLocation(FVector& OutLocation);
+
+	/** Writes the report and exits with the gate result */
+	void FinishRun();
+};
@@ -10,8 +10,15 @@
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/World.h"
 #include "Camera/CameraComponent.h"
-#include "TimerManager.h"
 #include "ShooterGameMode.h"
+#include "FirstPersonCity.h"
+#include "Net/UnrealNetwork.h"
+#include "ShooterLagCompensationSubsystem.h"
+#include "ShooterPickupSubsystem.h"
+#include "ShooterAllocationTracker.h"
+#include "ShooterInputLatency.h"
+
+DECLARE_CYCLE_STAT(TEXT("Weapon Animation Switch"), STAT_ShooterWeaponAnimSwitch, STATGROUP_FirstPersonCity);
 
 AShooterCharacter::AShooterCharacter()
 {
@@ -31,14 +38,42 @@ void AShooterCharacter::BeginPlay()
 
 	// update the HUD
 	OnDamaged.Broadcast(1.0f);
+
+	// record our hitbox so the server can validate shots against it
+	if (HasAuthority())
+	{
+		if (UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterTarget(this, EShooterLagCompGroup::Player);
+		}
+
+		// collect weapon pickups we walk over
+		if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+		{
+			PickupSubsystem->RegisterCollector(this);
+		}
+	}
 }
 
 void AShooterCharacter::EndPlay(EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
+	if (UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterTarget(this);
+	}
+
+	if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterCollector(this);
+	}
+
 	// clear the respawn timer
-	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Cancel(RespawnTimer);
+	}
 }
 
 void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -59,8 +94,24 @@ void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 
 }
 
+void AShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// only the owning client displays HP
+	DOREPLIFETIME_CONDITION(AShooterCharacter, CurrentHP, COND_OwnerOnly);
+}
+
+void AShooterCharacter::OnRep_CurrentHP()
+{
+	// update the HUD
+	OnDamaged.Broadcast(FMath::Max(0.0f, CurrentHP / MaxHP));
+}
+
 float AShooterCharacter::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
+	SHOOTER_ALLOC_SCOPE(Damage);
+
 	// ignore if already dead
 	if (CurrentHP <= 0.0f)
 	{
@@ -84,6 +135,14 @@ float AShooterCharacter::TakeDamage(float Damage, struct FDamageEvent const& Dam
 
 void AShooterCharacter::DoStartFiring()
 {
+#if SHOOTER_INPUT_LATENCY
+	// measure from the key press behind this fire input to the shot it spawns
+	if (IsLocallyControlled() && IsPlayerControlled())
+	{
+		FShooterInputLatency::OnFireInput();
+	}
+#endif
+
 	// fire the current weapon
 
 
@@ -105,6 +164,14 @@ void AShooterCharacter::DoStartFiring()
 
 void AShooterCharacter::DoStopFiring()
 {
+#if SHOOTER_INPUT_LATENCY
+	// a press released before its shot spawned has nothing left to measure
+	if (IsLocallyControlled() && IsPlayerControlled())
+	{
+		FShooterInputLatency::OnFireStopped();
+	}
+#endif
+
 	// stop firing the current weapon
 	if (CurrentWeapon)
 	{
@@ -114,6 +181,13 @@ void AShooterCharacter::DoStopFiring()
 
 void AShooterCharacter::DoSwitchWeapon()
 {
+	// weapon switches happen on the server and replicate back
+	if (!HasAuthority())
+	{
+		ServerSwitchWeapon();
+		return;
+	}
+
 	// ensure we have at least two weapons two switch between
 	if (OwnedWeapons.Num() > 1)
 	{
@@ -148,9 +222,25 @@ void AShooterCharacter::DoDeactivateWeapon()
 	if(CurrentWeapon && IsValid(CurrentWeapon))
 	{
 		CurrentWeapon->DeactivateWeapon();
+
+		// deactivate it on the server too
+		if (!HasAuthority())
+		{
+			ServerDeactivateWeapon();
+		}
 	}
 }
 
+void AShooterCharacter::ServerSwitchWeapon_Implementation()
+{
+	DoSwitchWeapon();
+}
+
+void AShooterCharacter::ServerDeactivateWeapon_Implementation()
+{
+	DoDeactivateWeapon();
+}
+
 void AShooterCharacter::AttachWeaponMeshes(AShooterWeapon* Weapon)
 {
 	const FAttachmentTransformRules AttachmentRule(EAttachmentRule::SnapToTarget, false);
@@ -186,7 +276,13 @@ FVector AShooterCharacter::GetWeaponTargetLocation()
 	FHitResult OutHit;
 
 	const FVector Start = GetFirstPersonCameraComponent()->GetComponentLocation();
-	const FVector End = Start + (GetFirstPersonCameraComponent()->GetForwardVector() * MaxAimDistance);
+
+	// aim along this frame's input instead of the camera's last update if we fire immediately
+	FTransform PosedView, LatestView;
+	const bool bLatestView = AShooterWeapon::UsesLatestView() && GetViewCorrection(PosedView, LatestView);
+
+	const FVector AimDirection = bLatestView ? LatestView.GetRotation().GetForwardVector() : GetFirstPersonCameraComponent()->GetForwardVector();
+	const FVector End = Start + (AimDirection * MaxAimDistance);
 
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(this);
@@ -199,6 +295,12 @@ FVector AShooterCharacter::GetWeaponTargetLocation()
 
 void AShooterCharacter::AddWeaponClass(const TSubclassOf<AShooterWeapon>& WeaponClass)
 {
+	// weapons are spawned on the server and replicated to clients
+	if (!HasAuthority())
+	{
+		return;
+	}
+
 	// do we already own this weapon?
 	AShooterWeapon* OwnedWeapon = FindWeaponOfType(WeaponClass);
 
@@ -243,12 +345,46 @@ void AShooterCharacter::AddWeaponClass(const TSubclassOf<AShooterWeapon>& Weapon
 
 void AShooterCharacter::OnWeaponActivated(AShooterWeapon* Weapon)
 {
+	// keep track of replicated weapons on clients
+	OwnedWeapons.AddUnique(Weapon);
+	CurrentWeapon = Weapon;
+
 	// update the bullet counter
 	OnBulletCountUpdated.Broadcast(Weapon->GetMagazineSize(), Weapon->GetBulletCount());
 
-	// set the character mesh AnimInstances
-	GetFirstPersonMesh()->SetAnimInstanceClass(Weapon->GetFirstPersonAnimInstanceClass());
-	GetMesh()->SetAnimInstanceClass(Weapon->GetThirdPersonAnimInstanceClass());
+	SCOPE_CYCLE_COUNTER(STAT_ShooterWeaponAnimSwitch);
+
+	// set up the character mesh animation for the new weapon
+	ApplyWeaponAnimation(GetFirstPersonMesh(), Weapon->GetFirstPersonAnimInstanceClass(), Weapon->GetFirstPersonAnimLayersClass(), LinkedFirstPersonAnimLayers);
+	ApplyWeaponAnimation(GetMesh(), Weapon->GetThirdPersonAnimInstanceClass(), Weapon->GetThirdPersonAnimLayersClass(), LinkedThirdPersonAnimLayers);
+}
+
+void AShooterCharacter::ApplyWeaponAnimation(USkeletalMeshComponent* CharacterMesh, const TSubclassOf<UAnimInstance>& AnimInstanceClass, const TSubclassOf<UAnimInstance>& AnimLayersClass, TSubclassOf<UAnimInstance>& LinkedAnimLayers)
+{
+	// only tear down and re-create the AnimInstance if the weapon needs a different one
+	if (CharacterMesh->GetAnimClass() != AnimInstanceClass.Get())
+	{
+		CharacterMesh->SetAnimInstanceClass(AnimInstanceClass);
+
+		// the new AnimInstance starts without any linked layers
+		LinkedAnimLayers = nullptr;
+	}
+
+	// swap the weapon anim layers on the existing AnimInstance
+	if (LinkedAnimLayers.Get() != AnimLayersClass.Get())
+	{
+		if (LinkedAnimLayers)
+		{
+			CharacterMesh->UnlinkAnimClassLayers(LinkedAnimLayers);
+		}
+
+		if (AnimLayersClass)
+		{
+			CharacterMesh->LinkAnimClassLayers(AnimLayersClass);
+		}
+
+		LinkedAnimLayers = AnimLayersClass;
+	}
 }
 
 void AShooterCharacter::OnWeaponDeactivated(AShooterWeapon* Weapon)
@@ -261,6 +397,21 @@ void AShooterCharacter::OnSemiWeaponRefire()
 	// unused
 }
 
+bool AShooterCharacter::GetViewCorrection(FTransform& OutPosedView, FTransform& OutLatestView) const
+{
+	// only the local player has input newer than the camera
+	if (!Controller || !IsLocallyControlled())
+	{
+		return false;
+	}
+
+	// the camera picks up the control rotation when the camera manager updates, late in the frame
+	OutPosedView = GetFirstPersonCameraComponent()->GetComponentTransform();
+	OutLatestView = FTransform(GetControlRotation(), OutPosedView.GetLocation());
+
+	return true;
+}
+
 AShooterWeapon* AShooterCharacter::FindWeaponOfType(TSubclassOf<AShooterWeapon> WeaponClass) const
 {
 	// check each owned weapon
@@ -277,8 +428,16 @@ AShooterWeapon* AShooterCharacter::FindWeaponOfType(TSubclassOf<AShooterWeapon>
 
 }
 
+float AShooterCharacter::GetDamageResistance(const TSubclassOf<UDamageType>& DamageType) const
+{
+	const float* Resistance = DamageResistances.Find(DamageType);
+	return Resistance ? *Resistance : 0.0f;
+}
+
 void AShooterCharacter::Die()
 {
+	SHOOTER_ALLOC_SCOPE(Death);
+
 	// deactivate the weapon
 	if (IsValid(CurrentWeapon))
 	{
@@ -291,6 +450,32 @@ void AShooterCharacter::Die()
 		GM->IncrementTeamScore(TeamByte);
 	}
 		
+	// dead characters can't be hit anymore
+	if (UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterTarget(this);
+	}
+
+	// the dead don't collect pickups
+	if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterCollector(this);
+	}
+
+	// run the death effects everywhere
+	MulticastOnDeath();
+
+	// schedule character respawn
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Schedule<AShooterCharacter, &AShooterCharacter::OnRespawn>(RespawnTimer, this, RespawnTime);
+	}
+}
+
+void AShooterCharacter::MulticastOnDeath_Implementation()
+{
+	SHOOTER_ALLOC_SCOPE(Death);
+
 	// stop character movement
 	GetCharacterMovement()->StopMovementImmediately();
 
@@ -302,13 +487,12 @@ void AShooterCharacter::Die()
 
 	// call the BP handler
 	BP_OnDeath();
-
-	// schedule character respawn
-	GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterCharacter::OnRespawn, RespawnTime, false);
 }
 
 void AShooterCharacter::OnRespawn()
 {
+	SHOOTER_ALLOC_SCOPE(Respawn);
+
 	// destroy the character to force the PC to respawn
 	Destroy();
 }
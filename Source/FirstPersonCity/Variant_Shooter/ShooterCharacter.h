@@ -5,12 +5,16 @@
 #include "CoreMinimal.h"
 #include "FirstPersonCityCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "ShooterDamageable.h"
+#include "ShooterLifetimeSubsystem.h"
 #include "ShooterCharacter.generated.h"
 
 class AShooterWeapon;
 class UInputAction;
 class UInputComponent;
 class UPawnNoiseEmitterComponent;
+class UAnimInstance;
+class USkeletalMeshComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBulletCountUpdatedDelegate, int32, MagazineSize, int32, Bullets);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent);
@@ -19,9 +23,10 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent
  *  A player controllable first person shooter character
  *  Manages a weapon inventory through the IShooterWeaponHolder interface
  *  Manages health and death
+ *  HP and death are server authoritative and replicated to clients
  */
 UCLASS(abstract)
-class FIRSTPERSONCITY_API AShooterCharacter : public AFirstPersonCityCharacter, public IShooterWeaponHolder
+class FIRSTPERSONCITY_API AShooterCharacter : public AFirstPersonCityCharacter, public IShooterWeaponHolder, public IShooterDamageable
 {
 	GENERATED_BODY()
 	
@@ -56,8 +61,13 @@ protected:
 	float MaxHP = 500.0f;
 
 	/** Current HP remaining to this character */
+	UPROPERTY(ReplicatedUsing=OnRep_CurrentHP)
 	float CurrentHP = 0.0f;
 
+	/** Fraction of damage ignored per damage type, from 0 to 1 */
+	UPROPERTY(EditAnywhere, Category="Damage")
+	TMap<TSubclassOf<UDamageType>, float> DamageResistances;
+
 	/** Team ID for this character*/
 	UPROPERTY(EditAnywhere, Category="Team")
 	uint8 TeamByte = 0;
@@ -74,7 +84,13 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Weapons")
 	bool bSingleShotMode = false;
 
-	FTimerHandle RespawnTimer;
+	FShooterLifetimeHandle RespawnTimer;
+
+	/** Anim layers class currently linked on the first person mesh */
+	TSubclassOf<UAnimInstance> LinkedFirstPersonAnimLayers;
+
+	/** Anim layers class currently linked on the third person mesh */
+	TSubclassOf<UAnimInstance> LinkedThirdPersonAnimLayers;
 
 public:
 
@@ -100,11 +116,26 @@ protected:
 	/** Set up input action bindings */
 	virtual void SetupPlayerInputComponent(UInputComponent* InputComponent) override;
 
+	/** Sets up replicated properties */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Updates the HUD on the owning client when HP changes */
+	UFUNCTION()
+	void OnRep_CurrentHP();
+
 public:
 
 	/** Handle incoming damage */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
+public:
+
+	/** Returns the team this character belongs to */
+	uint8 GetTeamByte() const { return TeamByte; }
+
+	/** Returns the equipped weapon */
+	AShooterWeapon* GetCurrentWeapon() const { return CurrentWeapon; }
+
 public:
 
 	/** Handles start firing input */
@@ -122,6 +153,16 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Weapons")
 	void DoDeactivateWeapon();
 
+protected:
+
+	/** Switches weapons on the server */
+	UFUNCTION(Server, Reliable)
+	void ServerSwitchWeapon();
+
+	/** Deactivates the current weapon on the server */
+	UFUNCTION(Server, Reliable)
+	void ServerDeactivateWeapon();
+
 public:
 
 	//~Begin IShooterWeaponHolder interface
@@ -155,16 +196,33 @@ public:
 	/** Notifies the owner that the weapon cooldown has expired and it's ready to shoot again */
 	virtual void OnSemiWeaponRefire() override;
 
+	/** Returns the view transform the weapon meshes were last posed with and the latest one from this frame's input */
+	virtual bool GetViewCorrection(FTransform& OutPosedView, FTransform& OutLatestView) const override;
+
 	//~End IShooterWeaponHolder interface
 
+	//~Begin IShooterDamageable interface
+
+	/** Returns the fraction of damage of the given type this character ignores */
+	virtual float GetDamageResistance(const TSubclassOf<UDamageType>& DamageType) const override;
+
+	//~End IShooterDamageable interface
+
 protected:
 
+	/** Updates a character mesh's animation for a newly activated weapon. Only re-creates the AnimInstance if the class changes */
+	void ApplyWeaponAnimation(USkeletalMeshComponent* CharacterMesh, const TSubclassOf<UAnimInstance>& AnimInstanceClass, const TSubclassOf<UAnimInstance>& AnimLayersClass, TSubclassOf<UAnimInstance>& LinkedAnimLayers);
+
 	/** Returns true if the character already owns a weapon of the given class */
 	AShooterWeapon* FindWeaponOfType(TSubclassOf<AShooterWeapon> WeaponClass) const;
 
-	/** Called when this character's HP is depleted */
+	/** Called on the server when this character's HP is depleted */
 	void Die();
 
+	/** Handles the local effects of death on the server and all clients */
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastOnDeath();
+
 	/** Called to allow Blueprint code to react to this character's death */
 	UFUNCTION(BlueprintImplementableEvent, Category="Shooter", meta = (DisplayName = "On Death"))
 	void BP_OnDeath();
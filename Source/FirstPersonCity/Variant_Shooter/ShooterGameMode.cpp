@@ -31,3 +31,18 @@ void AShooterGameMode::IncrementTeamScore(uint8 TeamByte)
 	// update the UI
 	ShooterUI->BP_UpdateScore(TeamByte, Score);
 }
+
+void AShooterGameMode::ResetTeamScore(uint8 TeamByte)
+{
+	// nothing to clear if the team never scored
+	if (TeamScores.Remove(TeamByte) == 0)
+	{
+		return;
+	}
+
+	// update the UI
+	if (ShooterUI)
+	{
+		ShooterUI->BP_UpdateScore(TeamByte, 0);
+	}
+}
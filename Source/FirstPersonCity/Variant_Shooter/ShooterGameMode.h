@@ -39,4 +39,10 @@ public:
 
 	/** Increases the score for the given team */
 	void IncrementTeamScore(uint8 TeamByte);
+
+	/** Clears the score for the given team */
+	void ResetTeamScore(uint8 TeamByte);
+
+	/** Returns the UI widget, if it's been created */
+	UShooterUI* GetShooterUI() const { return ShooterUI; }
 };
@@ -0,0 +1,435 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterLagCompensationSubsystem.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/GameStateBase.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "FirstPersonCity.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_ShooterLagCompRecord, STATGROUP_FirstPersonCity);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind"), STAT_ShooterLagCompRewind, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Compensation Targets"), STAT_ShooterLagCompTargets, STATGROUP_FirstPersonCity);
+DECLARE_MEMORY_STAT(TEXT("Lag Compensation History"), STAT_ShooterLagCompMemory, STATGROUP_FirstPersonCity);
+
+void FShooterHitboxHistory::Init(int32 InNumFrames)
+{
+	NumFrames = FMath::Max(InNumFrames, 2);
+	HeadFrame = INDEX_NONE;
+	NumRecordedFrames = 0;
+
+	FrameTimes.SetNumZeroed(NumFrames);
+	FrameMasks.SetNumZeroed(NumFrames);
+	Locations.SetNumZeroed(NumFrames * MaxTargets);
+}
+
+int32 FShooterHitboxHistory::AddTarget(float Radius, float HalfHeight)
+{
+	// all slots taken?
+	if (UsedSlots == MAX_uint64)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 Slot = FMath::CountTrailingZeros64(~UsedSlots);
+
+	UsedSlots |= 1ull << Slot;
+	Radii[Slot] = Radius;
+	HalfHeights[Slot] = HalfHeight;
+
+	// the slot may have been used before, so forget its old history
+	for (uint64& FrameMask : FrameMasks)
+	{
+		FrameMask &= ~(1ull << Slot);
+	}
+
+	return Slot;
+}
+
+void FShooterHitboxHistory::RemoveTarget(int32 Slot)
+{
+	check(Slot >= 0 && Slot < MaxTargets);
+
+	UsedSlots &= ~(1ull << Slot);
+}
+
+void FShooterHitboxHistory::BeginFrame(double Time)
+{
+	HeadFrame = (HeadFrame + 1) % NumFrames;
+	NumRecordedFrames = FMath::Min(NumRecordedFrames + 1, NumFrames);
+
+	FrameTimes[HeadFrame] = Time;
+	FrameMasks[HeadFrame] = 0;
+}
+
+void FShooterHitboxHistory::RecordTarget(int32 Slot, const FVector& Location)
+{
+	check(HeadFrame != INDEX_NONE);
+
+	Locations[HeadFrame * MaxTargets + Slot] = FVector3f(Location);
+	FrameMasks[HeadFrame] |= 1ull << Slot;
+}
+
+double FShooterHitboxHistory::GetOldestTime() const
+{
+	if (NumRecordedFrames == 0)
+	{
+		return 0.0;
+	}
+
+	return FrameTimes[(HeadFrame - NumRecordedFrames + 1 + NumFrames) % NumFrames];
+}
+
+void FShooterHitboxHistory::FindFrames(double Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const
+{
+	// rewinds are usually a handful of frames, so walk back from the newest frame
+	OutNewerFrame = HeadFrame;
+	OutOlderFrame = HeadFrame;
+	OutAlpha = 0.0f;
+
+	for (int32 FrameOffset = 0; FrameOffset < NumRecordedFrames; ++FrameOffset)
+	{
+		const int32 Frame = (HeadFrame - FrameOffset + NumFrames) % NumFrames;
+
+		if (FrameTimes[Frame] <= Time)
+		{
+			OutOlderFrame = Frame;
+
+			// blend towards the next newer frame
+			if (Frame != OutNewerFrame)
+			{
+				const double FrameSpan = FrameTimes[OutNewerFrame] - FrameTimes[Frame];
+				OutAlpha = FrameSpan > 0.0 ? static_cast<float>((Time - FrameTimes[Frame]) / FrameSpan) : 0.0f;
+			}
+
+			return;
+		}
+
+		OutNewerFrame = Frame;
+		OutOlderFrame = Frame;
+	}
+
+	// older than the whole history, so clamp to the oldest frame
+}
+
+bool FShooterHitboxHistory::GetLocationAtTime(int32 Slot, double Time, FVector& OutLocation) const
+{
+	if (NumRecordedFrames == 0)
+	{
+		return false;
+	}
+
+	int32 OlderFrame, NewerFrame;
+	float Alpha;
+	FindFrames(Time, OlderFrame, NewerFrame, Alpha);
+
+	const uint64 SlotBit = 1ull << Slot;
+
+	if ((FrameMasks[OlderFrame] & FrameMasks[NewerFrame] & SlotBit) == 0)
+	{
+		return false;
+	}
+
+	OutLocation = FVector(FMath::Lerp(Locations[OlderFrame * MaxTargets + Slot], Locations[NewerFrame * MaxTargets + Slot], Alpha));
+	return true;
+}
+
+int32 FShooterHitboxHistory::SegmentTest(double Time, const FVector& Start, const FVector& End, float Radius, uint64 IgnoredSlots, FVector& OutHitLocation, FVector& OutHitNormal) const
+{
+	if (NumRecordedFrames == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	int32 OlderFrame, NewerFrame;
+	float Alpha;
+	FindFrames(Time, OlderFrame, NewerFrame, Alpha);
+
+	const FVector3f* OlderLocations = &Locations[OlderFrame * MaxTargets];
+	const FVector3f* NewerLocations = &Locations[NewerFrame * MaxTargets];
+
+	int32 ClosestSlot = INDEX_NONE;
+	double ClosestDistSquared = UE_BIG_NUMBER;
+
+	// only test targets recorded in both frames
+	for (uint64 SlotMask = FrameMasks[OlderFrame] & FrameMasks[NewerFrame] & UsedSlots & ~IgnoredSlots; SlotMask != 0; SlotMask &= SlotMask - 1)
+	{
+		const int32 Slot = FMath::CountTrailingZeros64(SlotMask);
+
+		// rebuild the capsule axis at the rewound time
+		const FVector Center(FMath::Lerp(OlderLocations[Slot], NewerLocations[Slot], Alpha));
+		const FVector AxisOffset(0.0f, 0.0f, FMath::Max(HalfHeights[Slot] - Radii[Slot], 0.0f));
+
+		FVector SegmentPoint, AxisPoint;
+		FMath::SegmentDistToSegmentSafe(Start, End, Center - AxisOffset, Center + AxisOffset, SegmentPoint, AxisPoint);
+
+		const float HitRadius = Radii[Slot] + Radius;
+
+		if (FVector::DistSquared(SegmentPoint, AxisPoint) > FMath::Square(HitRadius))
+		{
+			continue;
+		}
+
+		// keep the hit closest to the start of the segment
+		const double DistSquared = FVector::DistSquared(Start, SegmentPoint);
+
+		if (DistSquared < ClosestDistSquared)
+		{
+			ClosestDistSquared = DistSquared;
+			ClosestSlot = Slot;
+
+			OutHitNormal = (SegmentPoint - AxisPoint).GetSafeNormal(UE_SMALL_NUMBER, -(End - Start).GetSafeNormal());
+			OutHitLocation = AxisPoint + OutHitNormal * Radii[Slot];
+		}
+	}
+
+	return ClosestSlot;
+}
+
+SIZE_T FShooterHitboxHistory::GetAllocatedSize() const
+{
+	return FrameTimes.GetAllocatedSize() + FrameMasks.GetAllocatedSize() + Locations.GetAllocatedSize();
+}
+
+bool UShooterLagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterLagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// allocate all history memory up front
+	SIZE_T AllocatedSize = 0;
+
+	for (FShooterHitboxHistory& History : Histories)
+	{
+		History.Init(HistoryFrames);
+		AllocatedSize += History.GetAllocatedSize();
+	}
+
+	SET_MEMORY_STAT(STAT_ShooterLagCompMemory, AllocatedSize);
+}
+
+bool UShooterLagCompensationSubsystem::IsTickable() const
+{
+	// only the server validates shots
+	return NumTargets > 0 && GetWorld()->GetNetMode() != NM_Client;
+}
+
+void UShooterLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterLagCompRecord);
+
+	// tickable objects update after all actors, so this records where everything ended up this frame
+	const double ServerTime = GetServerTime();
+
+	for (int32 Group = 0; Group < static_cast<int32>(EShooterLagCompGroup::Count); ++Group)
+	{
+		FShooterHitboxHistory& History = Histories[Group];
+		History.BeginFrame(ServerTime);
+
+		for (int32 Slot = 0; Slot < FShooterHitboxHistory::MaxTargets; ++Slot)
+		{
+			if (const ACharacter* Character = SlotCharacters[Group][Slot].Get())
+			{
+				History.RecordTarget(Slot, Character->GetActorLocation());
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterLagCompTargets, NumTargets);
+}
+
+TStatId UShooterLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterLagCompensationSubsystem::RegisterTarget(ACharacter* Character, EShooterLagCompGroup Group)
+{
+	check(Character && Group != EShooterLagCompGroup::Count);
+
+	// ignore if already registered
+	EShooterLagCompGroup RegisteredGroup;
+
+	if (FindSlot(Character, RegisteredGroup) != INDEX_NONE)
+	{
+		return;
+	}
+
+	float Radius, HalfHeight;
+	Character->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+
+	const int32 GroupIndex = static_cast<int32>(Group);
+	const int32 Slot = Histories[GroupIndex].AddTarget(Radius, HalfHeight);
+
+	if (Slot == INDEX_NONE)
+	{
+		UE_LOG(LogFirstPersonCity, Warning, TEXT("Lag compensation is full for %s targets. %s won't be rewound"),
+			Group == EShooterLagCompGroup::Player ? TEXT("player") : TEXT("NPC"), *Character->GetName());
+		return;
+	}
+
+	SlotCharacters[GroupIndex][Slot] = Character;
+	++NumTargets;
+}
+
+void UShooterLagCompensationSubsystem::UnregisterTarget(ACharacter* Character)
+{
+	EShooterLagCompGroup Group;
+	const int32 Slot = FindSlot(Character, Group);
+
+	if (Slot == INDEX_NONE)
+	{
+		return;
+	}
+
+	Histories[static_cast<int32>(Group)].RemoveTarget(Slot);
+	SlotCharacters[static_cast<int32>(Group)][Slot].Reset();
+	--NumTargets;
+}
+
+bool UShooterLagCompensationSubsystem::RewindSegmentTest(double Time, const FVector& Start, const FVector& End, float Radius, const AActor* IgnoredActor, FHitResult& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterLagCompRewind);
+
+	// never rewind further than allowed
+	const double RewindTime = FMath::Max(Time, GetServerTime() - MaxRewindTime);
+
+	EShooterLagCompGroup IgnoredGroup = EShooterLagCompGroup::Count;
+	const int32 IgnoredSlot = FindSlot(IgnoredActor, IgnoredGroup);
+
+	ACharacter* HitCharacter = nullptr;
+	FVector HitLocation, HitNormal;
+	double HitDistSquared = UE_BIG_NUMBER;
+
+	// test every group and keep the hit closest to the start of the segment
+	for (int32 Group = 0; Group < static_cast<int32>(EShooterLagCompGroup::Count); ++Group)
+	{
+		const uint64 IgnoredSlots = IgnoredSlot != INDEX_NONE && Group == static_cast<int32>(IgnoredGroup) ? 1ull << IgnoredSlot : 0;
+
+		FVector GroupHitLocation, GroupHitNormal;
+		const int32 HitSlot = Histories[Group].SegmentTest(RewindTime, Start, End, Radius, IgnoredSlots, GroupHitLocation, GroupHitNormal);
+
+		ACharacter* GroupHitCharacter = HitSlot != INDEX_NONE ? SlotCharacters[Group][HitSlot].Get() : nullptr;
+
+		if (GroupHitCharacter && FVector::DistSquared(Start, GroupHitLocation) < HitDistSquared)
+		{
+			HitCharacter = GroupHitCharacter;
+			HitLocation = GroupHitLocation;
+			HitNormal = GroupHitNormal;
+			HitDistSquared = FVector::DistSquared(Start, GroupHitLocation);
+		}
+	}
+
+	if (!HitCharacter)
+	{
+		return false;
+	}
+
+	OutHit = FHitResult(HitCharacter, HitCharacter->GetCapsuleComponent(), HitLocation, HitNormal);
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+
+	return true;
+}
+
+double UShooterLagCompensationSubsystem::GetServerTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+int32 UShooterLagCompensationSubsystem::FindSlot(const AActor* Actor, EShooterLagCompGroup& OutGroup) const
+{
+	if (!Actor)
+	{
+		return INDEX_NONE;
+	}
+
+	for (int32 Group = 0; Group < static_cast<int32>(EShooterLagCompGroup::Count); ++Group)
+	{
+		for (int32 Slot = 0; Slot < FShooterHitboxHistory::MaxTargets; ++Slot)
+		{
+			if (SlotCharacters[Group][Slot].Get() == Actor)
+			{
+				OutGroup = static_cast<EShooterLagCompGroup>(Group);
+				return Slot;
+			}
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+#if !UE_BUILD_SHIPPING
+
+/** Measures the cost of rewind queries against a full synthetic history: 64 targets recorded at 60Hz */
+static FAutoConsoleCommand ShooterLagCompBenchmarkCommand(
+	TEXT("Shooter.LagComp.Benchmark"),
+	TEXT("Runs rewind queries against a full synthetic hitbox history. Usage: Shooter.LagComp.Benchmark [NumQueries]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumQueries = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+		const int32 NumFrames = 64;
+		const double FrameTime = 1.0 / 60.0;
+
+		FRandomStream Stream(1234);
+
+		// fill every slot and every frame with moving capsules
+		FShooterHitboxHistory History;
+		History.Init(NumFrames);
+
+		TArray<FVector> Positions;
+		TArray<FVector> Velocities;
+
+		for (int32 Slot = 0; Slot < FShooterHitboxHistory::MaxTargets; ++Slot)
+		{
+			History.AddTarget(34.0f, 96.0f);
+			Positions.Add(FVector(Stream.FRandRange(-5000.0f, 5000.0f), Stream.FRandRange(-5000.0f, 5000.0f), 96.0f));
+			Velocities.Add(FVector(Stream.FRandRange(-600.0f, 600.0f), Stream.FRandRange(-600.0f, 600.0f), 0.0f));
+		}
+
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			History.BeginFrame(Frame * FrameTime);
+
+			for (int32 Slot = 0; Slot < FShooterHitboxHistory::MaxTargets; ++Slot)
+			{
+				Positions[Slot] += Velocities[Slot] * FrameTime;
+				History.RecordTarget(Slot, Positions[Slot]);
+			}
+		}
+
+		// shots rewound up to 250ms, fired from random points towards random targets
+		const double NewestTime = (NumFrames - 1) * FrameTime;
+		int32 NumHits = 0;
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			const double QueryTime = NewestTime - Stream.FRandRange(0.0f, 0.25f);
+			const FVector Start(Stream.FRandRange(-5000.0f, 5000.0f), Stream.FRandRange(-5000.0f, 5000.0f), 150.0f);
+			const FVector End = Start + Stream.VRand() * 750.0f;
+
+			FVector HitLocation, HitNormal;
+
+			if (History.SegmentTest(QueryTime, Start, End, 16.0f, 0, HitLocation, HitNormal) != INDEX_NONE)
+			{
+				++NumHits;
+			}
+		}
+
+		const double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogFirstPersonCity, Display, TEXT("Lag compensation benchmark: %d queries against %d targets x %d frames (%llu bytes) took %.3f ms, %.1f ns per query, %d hits"),
+			NumQueries, FShooterHitboxHistory::MaxTargets, NumFrames, (uint64)History.GetAllocatedSize(), ElapsedTime * 1000.0, ElapsedTime * 1.0e9 / NumQueries, NumHits);
+	}));
+
+#endif
@@ -0,0 +1,152 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterLagCompensationSubsystem.generated.h"
+
+class ACharacter;
+
+/**
+ *  Groups of lag compensated characters. Each group records into its own history, so NPCs never take player slots
+ */
+enum class EShooterLagCompGroup : uint8
+{
+	Player,
+	NPC,
+	Count
+};
+
+/**
+ *  Fixed size ring buffer of upright capsule hitboxes for up to MaxTargets characters
+ *  Stored as structure of arrays, one frame after another, so recording a frame and scanning a frame are both linear
+ */
+struct FIRSTPERSONCITY_API FShooterHitboxHistory
+{
+	/** Max number of tracked targets. Matches the width of the per frame slot masks */
+	static constexpr int32 MaxTargets = 64;
+
+	/** Allocates storage for the given number of frames. All memory is allocated up front */
+	void Init(int32 InNumFrames);
+
+	/** Claims a target slot for a capsule of the given size. Returns INDEX_NONE if all slots are taken */
+	int32 AddTarget(float Radius, float HalfHeight);
+
+	/** Frees a target slot */
+	void RemoveTarget(int32 Slot);
+
+	/** Starts recording a new frame, overwriting the oldest one */
+	void BeginFrame(double Time);
+
+	/** Records a target's capsule center for the current frame */
+	void RecordTarget(int32 Slot, const FVector& Location);
+
+	/** Returns a target's capsule center interpolated at the given time */
+	bool GetLocationAtTime(int32 Slot, double Time, FVector& OutLocation) const;
+
+	/** Sweeps a sphere along a segment against all target capsules as they were at the given time. Returns the closest slot hit or INDEX_NONE */
+	int32 SegmentTest(double Time, const FVector& Start, const FVector& End, float Radius, uint64 IgnoredSlots, FVector& OutHitLocation, FVector& OutHitNormal) const;
+
+	/** Returns the time of the oldest recorded frame */
+	double GetOldestTime() const;
+
+	/** Returns the number of frames the buffer holds */
+	int32 GetNumFrames() const { return NumFrames; }
+
+	/** Returns the memory used by the history */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/** Finds the recorded frames bracketing the given time and the blend between them */
+	void FindFrames(double Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const;
+
+	/** Time of each frame */
+	TArray<double> FrameTimes;
+
+	/** Bitmask of the slots recorded in each frame */
+	TArray<uint64> FrameMasks;
+
+	/** Capsule centers, MaxTargets entries per frame */
+	TArray<FVector3f> Locations;
+
+	/** Capsule radius per slot */
+	float Radii[MaxTargets] = {};
+
+	/** Capsule half height per slot */
+	float HalfHeights[MaxTargets] = {};
+
+	/** Bitmask of the slots in use */
+	uint64 UsedSlots = 0;
+
+	/** Number of frames in the ring */
+	int32 NumFrames = 0;
+
+	/** Index of the newest frame */
+	int32 HeadFrame = INDEX_NONE;
+
+	/** Number of frames recorded so far, up to NumFrames */
+	int32 NumRecordedFrames = 0;
+};
+
+/**
+ *  Server side lag compensation for the shooter variant
+ *  Records the capsules of registered characters every frame into a bounded FShooterHitboxHistory per group,
+ *  so shots can be validated against where targets were when the client fired
+ *  Players and NPCs each have FShooterHitboxHistory::MaxTargets slots, so a crowd of NPCs can't lock players out
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterLagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Number of frames of history to keep. About a second at 60Hz */
+	UPROPERTY(Config)
+	int32 HistoryFrames = 64;
+
+	/** Max time shots can be rewound */
+	UPROPERTY(Config)
+	float MaxRewindTime = 0.5f;
+
+	/** Recorded hitbox history per group */
+	FShooterHitboxHistory Histories[static_cast<int32>(EShooterLagCompGroup::Count)];
+
+	/** Character registered to each history slot, per group */
+	TWeakObjectPtr<ACharacter> SlotCharacters[static_cast<int32>(EShooterLagCompGroup::Count)][FShooterHitboxHistory::MaxTargets];
+
+	/** Number of registered characters across all groups */
+	int32 NumTargets = 0;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Starts recording a character's capsule in the given group */
+	void RegisterTarget(ACharacter* Character, EShooterLagCompGroup Group);
+
+	/** Stops recording a character's capsule */
+	void UnregisterTarget(ACharacter* Character);
+
+	/** Sweeps a sphere along a segment against the registered characters as they were at the given server time */
+	bool RewindSegmentTest(double Time, const FVector& Start, const FVector& End, float Radius, const AActor* IgnoredActor, FHitResult& OutHit) const;
+
+	/** Returns the server time used to timestamp the history */
+	double GetServerTime() const;
+
+	/** Returns the max time shots can be rewound */
+	float GetMaxRewindTime() const { return MaxRewindTime; }
+
+protected:
+
+	/** Returns the history slot of a registered character and the group it's in */
+	int32 FindSlot(const AActor* Actor, EShooterLagCompGroup& OutGroup) const;
+};
@@ -0,0 +1,178 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterLifetimeSubsystem.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lifetime Events Sweep"), STAT_ShooterLifetimeSweep, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lifetime Events Scheduled"), STAT_ShooterLifetimeScheduled, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Lifetime Events Fired"), STAT_ShooterLifetimeFired, STATGROUP_FirstPersonCity);
+
+void UShooterLifetimeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	SlotDuration = FMath::Max(SlotDuration, UE_KINDA_SMALL_NUMBER);
+	NumSlots = FMath::RoundUpToPowerOfTwo(FMath::Max(NumSlots, 2));
+
+	SlotHeads.Init(INDEX_NONE, NumSlots);
+}
+
+bool UShooterLifetimeSubsystem::IsTickable() const
+{
+	return NumScheduled > 0;
+}
+
+void UShooterLifetimeSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterLifetimeSweep);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+	const int64 CurrentTick = GetTickForTime(Time);
+	const int32 SlotMask = NumSlots - 1;
+
+	// sweep every slot passed since the last frame, including the last one again since it may have been partially due.
+	// after a long hitch every slot is swept once, which still catches everything because entries are checked by time
+	const int64 EndTick = FMath::Min(CurrentTick, LastTick + NumSlots - 1);
+
+	for (int64 SlotTick = LastTick; SlotTick <= EndTick; ++SlotTick)
+	{
+		const int32 Slot = static_cast<int32>(SlotTick & SlotMask);
+
+		// unlink the whole slot and put back whatever isn't due yet
+		int32 EntryIndex = SlotHeads[Slot];
+		SlotHeads[Slot] = INDEX_NONE;
+
+		while (EntryIndex != INDEX_NONE)
+		{
+			FLifetimeEntry& Entry = Entries[EntryIndex];
+			const int32 NextIndex = Entry.Next;
+
+			if (!Entry.Callback)
+			{
+				// cancelled
+				FreeEntry(EntryIndex);
+
+			} else if (Entry.FireTime <= Time) {
+
+				DueEntries.Add(EntryIndex);
+
+			} else {
+
+				Entry.Next = SlotHeads[Slot];
+				SlotHeads[Slot] = EntryIndex;
+			}
+
+			EntryIndex = NextIndex;
+		}
+	}
+
+	LastTick = CurrentTick;
+
+	if (DueEntries.Num() == 0)
+	{
+		return;
+	}
+
+	// fire in time order. Callbacks may schedule or cancel other events, so nothing is held by reference
+	DueEntries.Sort([this](int32 A, int32 B) { return Entries[A].FireTime < Entries[B].FireTime; });
+
+	for (const int32 EntryIndex : DueEntries)
+	{
+		// an earlier callback may have cancelled this one
+		const FLifetimeCallback Callback = Entries[EntryIndex].Callback;
+		UObject* Object = Entries[EntryIndex].Object.Get();
+
+		if (Callback)
+		{
+			--NumScheduled;
+		}
+
+		FreeEntry(EntryIndex);
+
+		if (Callback && Object)
+		{
+			Callback(Object);
+
+			INC_DWORD_STAT(STAT_ShooterLifetimeFired);
+		}
+	}
+
+	DueEntries.Reset();
+
+	SET_DWORD_STAT(STAT_ShooterLifetimeScheduled, NumScheduled);
+}
+
+TStatId UShooterLifetimeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterLifetimeSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterLifetimeSubsystem::Cancel(FShooterLifetimeHandle& InOutHandle)
+{
+	// the entry stays linked in its slot until the sweep reaches it
+	if (IsScheduled(InOutHandle))
+	{
+		FLifetimeEntry& Entry = Entries[InOutHandle.Index];
+		Entry.Callback = nullptr;
+		Entry.Object.Reset();
+
+		--NumScheduled;
+	}
+
+	InOutHandle = FShooterLifetimeHandle();
+}
+
+bool UShooterLifetimeSubsystem::IsScheduled(const FShooterLifetimeHandle& Handle) const
+{
+	return Entries.IsValidIndex(Handle.Index) && Entries[Handle.Index].Generation == Handle.Generation && Entries[Handle.Index].Callback;
+}
+
+void UShooterLifetimeSubsystem::ScheduleInternal(FShooterLifetimeHandle& InOutHandle, UObject* Object, float Delay, FLifetimeCallback Callback)
+{
+	check(Object);
+
+	Cancel(InOutHandle);
+
+	// reuse a free entry if possible
+	int32 EntryIndex = FreeHead;
+
+	if (EntryIndex != INDEX_NONE)
+	{
+		FreeHead = Entries[EntryIndex].Next;
+
+	} else {
+
+		EntryIndex = Entries.AddDefaulted();
+	}
+
+	FLifetimeEntry& Entry = Entries[EntryIndex];
+	Entry.FireTime = GetWorld()->GetTimeSeconds() + FMath::Max(Delay, 0.0f);
+	Entry.Object = Object;
+	Entry.Callback = Callback;
+
+	// link it into the slot its fire time falls in. Never behind the sweep, so it can't be skipped
+	const int32 Slot = static_cast<int32>(FMath::Max(GetTickForTime(Entry.FireTime), LastTick) & (NumSlots - 1));
+
+	Entry.Next = SlotHeads[Slot];
+	SlotHeads[Slot] = EntryIndex;
+
+	++NumScheduled;
+
+	InOutHandle.Index = EntryIndex;
+	InOutHandle.Generation = Entry.Generation;
+
+	SET_DWORD_STAT(STAT_ShooterLifetimeScheduled, NumScheduled);
+}
+
+void UShooterLifetimeSubsystem::FreeEntry(int32 EntryIndex)
+{
+	FLifetimeEntry& Entry = Entries[EntryIndex];
+	Entry.Callback = nullptr;
+	Entry.Object.Reset();
+	++Entry.Generation;
+
+	Entry.Next = FreeHead;
+	FreeHead = EntryIndex;
+}
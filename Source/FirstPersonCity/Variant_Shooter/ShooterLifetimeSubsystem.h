@@ -0,0 +1,118 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterLifetimeSubsystem.generated.h"
+
+/**
+ *  Handle to an event scheduled on the lifetime subsystem
+ */
+struct FShooterLifetimeHandle
+{
+	/** Index of the scheduled entry */
+	int32 Index = INDEX_NONE;
+
+	/** Generation of the entry when it was scheduled. Stale handles don't match */
+	uint32 Generation = 0;
+};
+
+/**
+ *  Hashed timing wheel for the shooter variant's lifecycle events: deferred destruction, respawns and refires
+ *  Entries live in a single pooled array linked into fixed duration slots, so scheduling and cancelling never allocate
+ *  once the pool has grown, and every due event fires in a single pass per frame
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterLifetimeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Callback thunk. Calls a member function on the scheduled object */
+	using FLifetimeCallback = void (*)(UObject*);
+
+	/** A scheduled event. Kept small so thousands of projectiles fit in a few cache lines each */
+	struct FLifetimeEntry
+	{
+		/** World time the event fires at */
+		double FireTime = 0.0;
+
+		/** Object the event belongs to. Events for destroyed objects are dropped */
+		TWeakObjectPtr<UObject> Object;
+
+		/** Callback to run. Null once the entry is cancelled or free */
+		FLifetimeCallback Callback = nullptr;
+
+		/** Bumped every time the entry is freed, to invalidate old handles */
+		uint32 Generation = 0;
+
+		/** Next entry in the same slot or in the free list */
+		int32 Next = INDEX_NONE;
+	};
+
+protected:
+
+	/** Time covered by each wheel slot */
+	UPROPERTY(Config)
+	float SlotDuration = 1.0f / 60.0f;
+
+	/** Number of wheel slots. Rounded up to a power of two. Events further out than a full turn stay in their slot until due */
+	UPROPERTY(Config)
+	int32 NumSlots = 256;
+
+	/** Pool of entries, scheduled or free */
+	TArray<FLifetimeEntry> Entries;
+
+	/** First entry in each slot */
+	TArray<int32> SlotHeads;
+
+	/** Due entries gathered during a sweep */
+	TArray<int32> DueEntries;
+
+	/** First free entry */
+	int32 FreeHead = INDEX_NONE;
+
+	/** Number of scheduled events */
+	int32 NumScheduled = 0;
+
+	/** Slot tick the last sweep stopped at */
+	int64 LastTick = 0;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Schedules a member function to be called on an object after a delay. Replaces any event already on the handle */
+	template<typename UserClass, void (UserClass::*Callback)()>
+	void Schedule(FShooterLifetimeHandle& InOutHandle, UserClass* Object, float Delay)
+	{
+		static_assert(TIsDerivedFrom<UserClass, UObject>::Value, "Lifetime events can only be scheduled on UObjects");
+
+		ScheduleInternal(InOutHandle, Object, Delay, [](UObject* Target) { (static_cast<UserClass*>(Target)->*Callback)(); });
+	}
+
+	/** Cancels the event on a handle, if any, and resets the handle */
+	void Cancel(FShooterLifetimeHandle& InOutHandle);
+
+	/** Returns true if the handle's event is still waiting to fire */
+	bool IsScheduled(const FShooterLifetimeHandle& Handle) const;
+
+	/** Returns the number of events waiting to fire */
+	int32 GetNumScheduled() const { return NumScheduled; }
+
+protected:
+
+	/** Adds an entry to the wheel */
+	void ScheduleInternal(FShooterLifetimeHandle& InOutHandle, UObject* Object, float Delay, FLifetimeCallback Callback);
+
+	/** Returns the slot tick a world time falls in */
+	int64 GetTickForTime(double Time) const { return FMath::FloorToInt64(Time / SlotDuration); }
+
+	/** Returns an entry to the free list */
+	void FreeEntry(int32 EntryIndex);
+};
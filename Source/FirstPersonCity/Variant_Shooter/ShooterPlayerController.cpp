@@ -11,6 +11,8 @@
 #include "ShooterBulletCounterUI.h"
 #include "FirstPersonCity.h"
 #include "Widgets/Input/SVirtualJoystick.h"
+#include "ShooterAllocationTracker.h"
+#include "ShooterInputLatency.h"
 
 void AShooterPlayerController::BeginPlay()
 {
@@ -89,20 +91,107 @@ void AShooterPlayerController::OnPossess(APawn* InPawn)
 	{
 		// add the player tag
 		ShooterCharacter->Tags.Add(PlayerPawnTag);
+	}
+}
+
+void AShooterPlayerController::SetPawn(APawn* InPawn)
+{
+	Super::SetPawn(InPawn);
+
+	// covers possession on the server and the replicated pawn on the owning client
+	UpdateHUDPawn();
+}
+
+void AShooterPlayerController::AcknowledgePossession(APawn* P)
+{
+	Super::AcknowledgePossession(P);
+
+	// the pawn may replicate before the client knows it's the local controller
+	UpdateHUDPawn();
+}
+
+void AShooterPlayerController::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	// push this frame's HUD changes
+	FlushHUDModel();
+}
+
+bool AShooterPlayerController::InputKey(const FInputKeyEventArgs& Params)
+{
+#if SHOOTER_INPUT_LATENCY
+	// remember when the key was actually pressed, so the fire action can measure from it
+	if (Params.Event == IE_Pressed && IsLocalController())
+	{
+		FShooterInputLatency::OnKeyPressed(Params.EventTimestamp);
+	}
+#endif
+
+	return Super::InputKey(Params);
+}
+
+void AShooterPlayerController::FlushHUDModel()
+{
+	if (!IsValid(BulletCounterUI))
+	{
+		return;
+	}
 
+	// only update the bullet counter if the displayed values are out of date
+	if (HUDModel.IsBulletCounterDirty())
+	{
+		HUDModel.DisplayedMagazineSize = HUDModel.MagazineSize;
+		HUDModel.DisplayedBullets = HUDModel.Bullets;
+
+		BulletCounterUI->BP_UpdateBulletCounter(HUDModel.MagazineSize, HUDModel.Bullets);
+	}
+
+	// play a single damage update for all hits taken this frame
+	if (HUDModel.bDamagedThisFrame)
+	{
+		HUDModel.bDamagedThisFrame = false;
+
+		BulletCounterUI->BP_Damaged(HUDModel.LifePercent);
+	}
+}
+
+void AShooterPlayerController::UpdateHUDPawn()
+{
+	// only local controllers have a HUD to drive
+	AShooterCharacter* NewHUDPawn = IsLocalController() ? Cast<AShooterCharacter>(GetPawn()) : nullptr;
+
+	if (NewHUDPawn == HUDPawn.Get())
+	{
+		return;
+	}
+
+	// unsubscribe from the previous pawn
+	if (AShooterCharacter* OldHUDPawn = HUDPawn.Get())
+	{
+		OldHUDPawn->OnBulletCountUpdated.RemoveDynamic(this, &AShooterPlayerController::OnBulletCountUpdated);
+		OldHUDPawn->OnDamaged.RemoveDynamic(this, &AShooterPlayerController::OnPawnDamaged);
+	}
+
+	HUDPawn = NewHUDPawn;
+
+	if (NewHUDPawn)
+	{
 		// subscribe to the pawn's delegates
-		ShooterCharacter->OnBulletCountUpdated.AddDynamic(this, &AShooterPlayerController::OnBulletCountUpdated);
-		ShooterCharacter->OnDamaged.AddDynamic(this, &AShooterPlayerController::OnPawnDamaged);
+		NewHUDPawn->OnBulletCountUpdated.AddUniqueDynamic(this, &AShooterPlayerController::OnBulletCountUpdated);
+		NewHUDPawn->OnDamaged.AddUniqueDynamic(this, &AShooterPlayerController::OnPawnDamaged);
 
 		// force update the life bar
-		ShooterCharacter->OnDamaged.Broadcast(1.0f);
+		NewHUDPawn->OnDamaged.Broadcast(1.0f);
 	}
 }
 
 void AShooterPlayerController::OnPawnDestroyed(AActor* DestroyedActor)
 {
+	SHOOTER_ALLOC_SCOPE(Respawn);
+
 	// reset the bullet counter HUD
-	BulletCounterUI->BP_UpdateBulletCounter(0, 0);
+	OnBulletCountUpdated(0, 0);
 
 	// find the player start
 	TArray<AActor*> ActorList;
@@ -126,17 +215,14 @@ void AShooterPlayerController::OnPawnDestroyed(AActor* DestroyedActor)
 
 void AShooterPlayerController::OnBulletCountUpdated(int32 MagazineSize, int32 Bullets)
 {
-	// update the UI
-	if (BulletCounterUI)
-	{
-		BulletCounterUI->BP_UpdateBulletCounter(MagazineSize, Bullets);
-	}
+	// update the HUD model. The UI is refreshed on the next flush
+	HUDModel.MagazineSize = MagazineSize;
+	HUDModel.Bullets = Bullets;
 }
 
 void AShooterPlayerController::OnPawnDamaged(float LifePercent)
 {
-	if (IsValid(BulletCounterUI))
-	{
-		BulletCounterUI->BP_Damaged(LifePercent);
-	}
+	// update the HUD model. The UI is refreshed on the next flush
+	HUDModel.LifePercent = LifePercent;
+	HUDModel.bDamagedThisFrame = true;
 }
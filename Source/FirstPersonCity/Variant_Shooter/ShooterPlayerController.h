@@ -10,6 +10,35 @@ class UInputMappingContext;
 class AShooterCharacter;
 class UShooterBulletCounterUI;
 
+/**
+ *  HUD state for the possessed shooter character
+ *  Pawn events only write into the model, and the widgets are refreshed at most once per frame
+ *  so UI cost doesn't scale with fire rate or the number of hits taken
+ */
+struct FShooterHUDModel
+{
+	/** Latest magazine size */
+	int32 MagazineSize = 0;
+
+	/** Latest bullet count */
+	int32 Bullets = 0;
+
+	/** Latest life percentage */
+	float LifePercent = 1.0f;
+
+	/** Magazine size last pushed to the widget */
+	int32 DisplayedMagazineSize = INDEX_NONE;
+
+	/** Bullet count last pushed to the widget */
+	int32 DisplayedBullets = INDEX_NONE;
+
+	/** If true, the pawn was damaged since the last widget update */
+	bool bDamagedThisFrame = false;
+
+	/** Returns true if the bullet counter differs from what the widget is showing */
+	bool IsBulletCounterDirty() const { return MagazineSize != DisplayedMagazineSize || Bullets != DisplayedBullets; }
+};
+
 /**
  *  Simple PlayerController for a first person shooter game
  *  Manages input mappings
@@ -52,6 +81,12 @@ protected:
 	/** Pointer to the bullet counter UI widget */
 	TObjectPtr<UShooterBulletCounterUI> BulletCounterUI;
 
+	/** Coalesced HUD state, flushed to the widgets once per frame */
+	FShooterHUDModel HUDModel;
+
+	/** Pawn the HUD delegates are currently bound to */
+	TWeakObjectPtr<AShooterCharacter> HUDPawn;
+
 protected:
 
 	/** Gameplay Initialization */
@@ -63,6 +98,24 @@ protected:
 	/** Pawn initialization */
 	virtual void OnPossess(APawn* InPawn) override;
 
+	/** Rebinds the HUD when the pawn changes, on the server and on the owning client */
+	virtual void SetPawn(APawn* InPawn) override;
+
+	/** Rebinds the HUD once the owning client acknowledges its pawn */
+	virtual void AcknowledgePossession(APawn* P) override;
+
+	/** Local player update. Flushes the HUD model */
+	virtual void PlayerTick(float DeltaTime) override;
+
+	/** Records raw key presses for input latency measurement */
+	virtual bool InputKey(const FInputKeyEventArgs& Params) override;
+
+	/** Pushes any pending HUD model changes to the widgets */
+	void FlushHUDModel();
+
+	/** Moves the HUD delegates from the previous pawn to the current one, if this is a local controller */
+	void UpdateHUDPawn();
+
 	/** Called if the possessed pawn is destroyed */
 	UFUNCTION()
 	void OnPawnDestroyed(AActor* DestroyedActor);
@@ -0,0 +1,276 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterReplicationGraph.h"
+#include "ShooterCharacter.h"
+#include "ShooterNPC.h"
+#include "ShooterWeapon.h"
+#include "ShooterProjectile.h"
+#include "ShooterPickup.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Info.h"
+#include "Engine/NetConnection.h"
+#include "HAL/PlatformTime.h"
+
+void UShooterReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// routing policies. Classes inherit the policy of their closest mapped parent
+	ClassRepNodePolicies.Set(AActor::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), EShooterClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EShooterClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AShooterWeapon::StaticClass(), EShooterClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AShooterProjectile::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(AShooterPickup::StaticClass(), EShooterClassRepNodeMapping::Spatialize_Dormancy);
+
+	// replication settings, taken from each class's defaults
+	FClassReplicationInfo ActorInfo;
+	InitClassReplicationInfo(ActorInfo, AActor::StaticClass());
+	GlobalActorReplicationInfoMap.SetClassInfo(AActor::StaticClass(), ActorInfo);
+
+	FClassReplicationInfo CharacterInfo;
+	InitClassReplicationInfo(CharacterInfo, ACharacter::StaticClass());
+	GlobalActorReplicationInfoMap.SetClassInfo(ACharacter::StaticClass(), CharacterInfo);
+
+	FClassReplicationInfo PickupInfo;
+	InitClassReplicationInfo(PickupInfo, AShooterPickup::StaticClass());
+	GlobalActorReplicationInfoMap.SetClassInfo(AShooterPickup::StaticClass(), PickupInfo);
+
+	// weapons replicate with their owner, so they don't need a cull distance of their own
+	FClassReplicationInfo WeaponInfo;
+	InitClassReplicationInfo(WeaponInfo, AShooterWeapon::StaticClass());
+	WeaponInfo.SetCullDistanceSquared(0.0f);
+	GlobalActorReplicationInfoMap.SetClassInfo(AShooterWeapon::StaticClass(), WeaponInfo);
+
+	// projectiles only matter to connections that can actually see them
+	FClassReplicationInfo ProjectileInfo;
+	InitClassReplicationInfo(ProjectileInfo, AShooterProjectile::StaticClass());
+	ProjectileInfo.SetCullDistanceSquared(FMath::Square(ProjectileCullDistance));
+	GlobalActorReplicationInfoMap.SetClassInfo(AShooterProjectile::StaticClass(), ProjectileInfo);
+}
+
+void UShooterReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class) const
+{
+	const AActor* CDO = Class->GetDefaultObject<AActor>();
+
+	Info.SetCullDistanceSquared(CDO->GetNetCullDistanceSquared());
+	Info.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(FMath::Max(CDO->GetNetUpdateFrequency(), 1.0f));
+}
+
+void UShooterReplicationGraph::InitGlobalGraphNodes()
+{
+	// spatial grid
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+
+	AddGlobalGraphNode(GridNode);
+
+	// actors relevant to everyone
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UShooterReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// the connection's own player controller and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+
+	// teammates
+	UShooterReplicationGraphNode_Connection* ShooterConnectionNode = CreateNewNode<UShooterReplicationGraphNode_Connection>();
+	AddConnectionGraphNode(ShooterConnectionNode, RepGraphConnection);
+}
+
+EShooterClassRepNodeMapping UShooterReplicationGraph::GetMappingPolicy(const AActor* Actor) const
+{
+	// per actor overrides take priority over the class policy
+	if (Actor->bAlwaysRelevant)
+	{
+		return EShooterClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	if (Actor->bOnlyRelevantToOwner)
+	{
+		return EShooterClassRepNodeMapping::NotRouted;
+	}
+
+	const EShooterClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Actor->GetClass());
+	return Policy ? *Policy : EShooterClassRepNodeMapping::Spatialize_Dynamic;
+}
+
+void UShooterReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+
+	// weapons replicate whenever their owner does
+	if (Actor->IsA<AShooterWeapon>())
+	{
+		if (AActor* WeaponOwner = Actor->GetOwner())
+		{
+			GlobalActorReplicationInfoMap.AddDependentActor(WeaponOwner, Actor);
+		}
+
+		return;
+	}
+
+	// predicted projectiles go through the grid like any moving actor, but the owning connection already has its own copy.
+	// Giving the owner a cull distance no viewer can be within keeps it from ever replicating there
+	if (const AShooterProjectile* Projectile = Cast<AShooterProjectile>(Actor))
+	{
+		if (Projectile->IsPredictedByOwner())
+		{
+			if (UNetConnection* OwningConnection = Actor->GetNetConnection())
+			{
+				if (UNetReplicationGraphConnection* OwningConnectionManager = FindOrAddConnectionManager(OwningConnection))
+				{
+					OwningConnectionManager->ActorInfoMap.FindOrAdd(Actor).SetCullDistanceSquared(UE_KINDA_SMALL_NUMBER);
+				}
+			}
+
+			GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+			return;
+		}
+	}
+
+	// characters are also always relevant to their teammates
+	uint8 TeamByte;
+	if (GetActorTeam(Actor, TeamByte))
+	{
+		TeamActorLists.FindOrAdd(TeamByte).ConditionalAdd(Actor);
+	}
+
+	switch (GetMappingPolicy(Actor))
+	{
+		case EShooterClassRepNodeMapping::RelevantAllConnections:
+			AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+			break;
+
+		case EShooterClassRepNodeMapping::Spatialize_Dynamic:
+			GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+			break;
+
+		case EShooterClassRepNodeMapping::Spatialize_Dormancy:
+			GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void UShooterReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+
+	if (Actor->IsA<AShooterWeapon>())
+	{
+		if (AActor* WeaponOwner = Actor->GetOwner())
+		{
+			GlobalActorReplicationInfoMap.RemoveDependentActor(WeaponOwner, Actor);
+		}
+
+		return;
+	}
+
+	if (const AShooterProjectile* Projectile = Cast<AShooterProjectile>(Actor))
+	{
+		if (Projectile->IsPredictedByOwner())
+		{
+			GridNode->RemoveActor_Dynamic(ActorInfo);
+			return;
+		}
+	}
+
+	uint8 TeamByte;
+	if (GetActorTeam(Actor, TeamByte))
+	{
+		if (FActorRepListRefView* TeamList = TeamActorLists.Find(TeamByte))
+		{
+			TeamList->RemoveFast(Actor);
+		}
+	}
+
+	switch (GetMappingPolicy(Actor))
+	{
+		case EShooterClassRepNodeMapping::RelevantAllConnections:
+			AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+			break;
+
+		case EShooterClassRepNodeMapping::Spatialize_Dynamic:
+			GridNode->RemoveActor_Dynamic(ActorInfo);
+			break;
+
+		case EShooterClassRepNodeMapping::Spatialize_Dormancy:
+			GridNode->RemoveActor_Dormancy(ActorInfo);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void UShooterReplicationGraph::ResetGameWorldState()
+{
+	Super::ResetGameWorldState();
+
+	TeamActorLists.Reset();
+}
+
+int32 UShooterReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	// time only the replication itself, for the network benchmark
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int32 NumReplicated = Super::ServerReplicateActors(DeltaSeconds);
+
+	LastReplicateActorsTime = FPlatformTime::Seconds() - StartTime;
+
+	return NumReplicated;
+}
+
+bool UShooterReplicationGraph::GetActorTeam(const AActor* Actor, uint8& OutTeamByte)
+{
+	if (const AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(Actor))
+	{
+		OutTeamByte = ShooterCharacter->GetTeamByte();
+		return true;
+	}
+
+	if (const AShooterNPC* ShooterNPC = Cast<AShooterNPC>(Actor))
+	{
+		OutTeamByte = ShooterNPC->GetTeamByte();
+		return true;
+	}
+
+	return false;
+}
+
+void UShooterReplicationGraphNode_Connection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	const UShooterReplicationGraph* Graph = CastChecked<UShooterReplicationGraph>(GetOuter());
+	const UNetConnection* NetConnection = Params.ConnectionManager.NetConnection;
+
+	// find the team of the connection's pawn
+	const APlayerController* PlayerController = NetConnection ? NetConnection->PlayerController : nullptr;
+
+	uint8 TeamByte;
+	if (!PlayerController || !UShooterReplicationGraph::GetActorTeam(PlayerController->GetPawn(), TeamByte))
+	{
+		return;
+	}
+
+	if (const FActorRepListRefView* TeamList = Graph->GetTeamActorList(TeamByte))
+	{
+		if (TeamList->Num() > 0)
+		{
+			Params.OutGatheredReplicationLists.AddReplicationActorList(*TeamList);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "ShooterReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+/**
+ *  How a replicated actor class is routed through the replication graph
+ */
+enum class EShooterClassRepNodeMapping : uint8
+{
+	/** Not routed to any node. Replicated through another actor or the connection itself */
+	NotRouted,
+
+	/** Relevant to every connection */
+	RelevantAllConnections,
+
+	/** Spatialized and expected to move */
+	Spatialize_Dynamic,
+
+	/** Spatialized and dormant most of the time */
+	Spatialize_Dormancy,
+};
+
+/**
+ *  Replication graph for the shooter variant
+ *  Actors are filtered through a 2D spatial grid, teammates are always relevant to each other,
+ *  weapons only replicate alongside their owner and projectiles are culled to a tight radius
+ */
+UCLASS(Transient, Config=Engine)
+class FIRSTPERSONCITY_API UShooterReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Size of the spatial grid cells */
+	UPROPERTY(Config)
+	float GridCellSize = 10000.0f;
+
+	/** Min X of the map, for grid cell indexing */
+	UPROPERTY(Config)
+	float SpatialBiasX = -200000.0f;
+
+	/** Min Y of the map, for grid cell indexing */
+	UPROPERTY(Config)
+	float SpatialBiasY = -200000.0f;
+
+	/** Max distance projectiles are relevant at */
+	UPROPERTY(Config)
+	float ProjectileCullDistance = 8000.0f;
+
+	/** Spatial grid for everything that has a location */
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_GridSpatialization2D> GridNode;
+
+	/** Actors relevant to every connection */
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
+
+	/** Routing policy per replicated class */
+	TClassMap<EShooterClassRepNodeMapping> ClassRepNodePolicies;
+
+	/** Characters per team, always relevant to connections on the same team */
+	TMap<uint8, FActorRepListRefView> TeamActorLists;
+
+	/** Time the last ServerReplicateActors call took, in seconds */
+	double LastReplicateActorsTime = 0.0;
+
+public:
+
+	//~Begin UReplicationGraph interface
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual void ResetGameWorldState() override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+	//~End UReplicationGraph interface
+
+	/** Returns the time the last ServerReplicateActors call took, in seconds */
+	double GetLastReplicateActorsTime() const { return LastReplicateActorsTime; }
+
+	/** Returns the characters on a team, or nullptr if the team has none */
+	const FActorRepListRefView* GetTeamActorList(uint8 TeamByte) const { return TeamActorLists.Find(TeamByte); }
+
+	/** Returns the team of a shooter character or NPC */
+	static bool GetActorTeam(const AActor* Actor, uint8& OutTeamByte);
+
+protected:
+
+	/** Returns the routing policy for an actor */
+	EShooterClassRepNodeMapping GetMappingPolicy(const AActor* Actor) const;
+
+	/** Sets up the replication settings of a class from its defaults */
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class) const;
+};
+
+/**
+ *  Per connection node that gathers the characters on the same team as the connection's pawn
+ */
+UCLASS()
+class FIRSTPERSONCITY_API UShooterReplicationGraphNode_Connection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	//~Begin UReplicationGraphNode interface
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override {}
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override {}
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+	//~End UReplicationGraphNode interface
+};
@@ -0,0 +1,59 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Misc/AutomationTest.h"
+#include "ShooterImpulseSubsystem.h"
+
+namespace
+{
+	/** Number of random impulses pushed into each cube */
+	constexpr int32 NumImpulses = 16;
+
+	/** Number of physics frames stepped before comparing, a quarter second at 60Hz */
+	constexpr int32 NumFrames = 15;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterImpulseAccumulatorTest, "FirstPersonCity.Shooter.ImpulseAccumulator",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShooterImpulseAccumulatorTest::RunTest(const FString& Parameters)
+{
+	FShooterTestWorld TestWorld;
+	FShooterImpulseVerification Verification;
+
+	if (!TestTrue(TEXT("Cubes spawned"), Verification.Start(TestWorld.Get(), NumImpulses)))
+	{
+		return false;
+	}
+
+	// let physics step a few times so position and rotation errors can build up
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		TestWorld.Tick(1.0f / 60.0f);
+	}
+
+	FShooterImpulseVerification::FResult Result;
+	const bool bCompared = TestTrue(TEXT("Cubes still simulating"), Verification.Compare(Result));
+
+	Verification.Finish();
+
+	if (!bCompared)
+	{
+		return false;
+	}
+
+	const float Tolerance = FShooterImpulseVerification::Tolerance;
+
+	TestTrue(FString::Printf(TEXT("Linear velocity error %.4f within %.2f"), Result.LinearVelocityError, Tolerance), Result.LinearVelocityError < Tolerance);
+	TestTrue(FString::Printf(TEXT("Angular velocity error %.4f deg/s within %.2f"), Result.AngularVelocityError, Tolerance), Result.AngularVelocityError < Tolerance);
+	TestTrue(FString::Printf(TEXT("Location error %.4f within %.2f"), Result.LocationError, Tolerance), Result.LocationError < Tolerance);
+	TestTrue(FString::Printf(TEXT("Rotation error %.4f deg within %.2f"), Result.RotationError, Tolerance), Result.RotationError < Tolerance);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,90 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "ShooterMallocProxy.h"
+
+/**
+ *  Game world created for the duration of an automation test, with actors initialized and play begun
+ */
+class FShooterTestWorld
+{
+public:
+
+	/** Creates the world and begins play */
+	FShooterTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("ShooterTestWorld"));
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	/** Tears the world down */
+	~FShooterTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	FShooterTestWorld(const FShooterTestWorld&) = delete;
+	FShooterTestWorld& operator=(const FShooterTestWorld&) = delete;
+
+	/** Returns the world */
+	UWorld* Get() const { return World; }
+
+	/** Ticks the world once */
+	void Tick(float DeltaTime) const { World->Tick(LEVELTICK_All, DeltaTime); }
+
+private:
+
+	/** Test world */
+	UWorld* World = nullptr;
+};
+
+/**
+ *  Counts game thread allocations while a test measures something
+ */
+class FShooterTestCountingMalloc final : public FShooterMallocProxy
+{
+public:
+
+	/** If true, game thread allocations are being counted */
+	bool bCounting = false;
+
+	/** Allocations counted since counting started */
+	uint64 NumAllocations = 0;
+
+	/** Starts counting from zero */
+	void Start()
+	{
+		NumAllocations = 0;
+		bCounting = true;
+	}
+
+	/** Stops counting */
+	void Stop() { bCounting = false; }
+
+	virtual const TCHAR* GetDescriptiveName() override { return TEXT("ShooterTestCountingMalloc"); }
+
+protected:
+
+	virtual void OnAllocation(SIZE_T Size) override
+	{
+		if (bCounting && IsInGameThread())
+		{
+			++NumAllocations;
+		}
+	}
+};
+
+#endif
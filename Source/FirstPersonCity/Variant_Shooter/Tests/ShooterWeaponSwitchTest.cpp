@@ -0,0 +1,113 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Misc/AutomationTest.h"
+#include "ShooterCharacter.h"
+#include "ShooterWeapon.h"
+#include "Animation/AnimInstance.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "FirstPersonCity.h"
+
+namespace
+{
+	/** Never destroyed, so threads still inside it after GMalloc is restored stay safe */
+	FShooterTestCountingMalloc GSwitchCountingMalloc;
+
+	/** Number of switches measured */
+	constexpr int32 NumSwitches = 200;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterWeaponSwitchTest, "FirstPersonCity.Shooter.WeaponSwitch",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShooterWeaponSwitchTest::RunTest(const FString& Parameters)
+{
+	UClass* CharacterClass = LoadClass<AShooterCharacter>(nullptr, TEXT("/Game/Variant_Shooter/Blueprints/BP_ShooterCharacter.BP_ShooterCharacter_C"));
+	UClass* RifleClass = LoadClass<AShooterWeapon>(nullptr, TEXT("/Game/Variant_Shooter/Blueprints/Pickups/Weapons/BP_ShooterWeapon_Rifle.BP_ShooterWeapon_Rifle_C"));
+	UClass* PistolClass = LoadClass<AShooterWeapon>(nullptr, TEXT("/Game/Variant_Shooter/Blueprints/Pickups/Weapons/BP_ShooterWeapon_Pistol.BP_ShooterWeapon_Pistol_C"));
+
+	if (!TestNotNull(TEXT("Character class"), CharacterClass) || !TestNotNull(TEXT("Rifle class"), RifleClass) || !TestNotNull(TEXT("Pistol class"), PistolClass))
+	{
+		return false;
+	}
+
+	FShooterTestWorld TestWorld;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AShooterCharacter* Character = TestWorld.Get()->SpawnActor<AShooterCharacter>(CharacterClass, FTransform::Identity, SpawnParams);
+
+	if (!TestNotNull(TEXT("Character"), Character))
+	{
+		return false;
+	}
+
+	// give the character two weapons to switch between
+	Character->AddWeaponClass(RifleClass);
+	Character->AddWeaponClass(PistolClass);
+
+	USkeletalMeshComponent* FirstPersonMesh = Character->GetFirstPersonMesh();
+	USkeletalMeshComponent* ThirdPersonMesh = Character->GetMesh();
+
+	int32 NumReuseChecks = 0;
+	double SwitchSeconds = 0.0;
+	uint64 SwitchAllocations = 0;
+
+	GSwitchCountingMalloc.Install();
+
+	for (int32 Switch = 0; Switch < NumSwitches; ++Switch)
+	{
+		const UAnimInstance* FirstPersonInstance = FirstPersonMesh->GetAnimInstance();
+		const UAnimInstance* ThirdPersonInstance = ThirdPersonMesh->GetAnimInstance();
+		const UClass* FirstPersonClass = FirstPersonMesh->GetAnimClass();
+		const UClass* ThirdPersonClass = ThirdPersonMesh->GetAnimClass();
+
+		// alternate between switching weapons and re-equipping the current one
+		GSwitchCountingMalloc.Start();
+		const double StartTime = FPlatformTime::Seconds();
+
+		if (Switch % 2 == 0)
+		{
+			Character->DoSwitchWeapon();
+
+		} else {
+
+			Character->AddWeaponClass(Character->GetCurrentWeapon()->GetClass());
+		}
+
+		SwitchSeconds += FPlatformTime::Seconds() - StartTime;
+		GSwitchCountingMalloc.Stop();
+		SwitchAllocations += GSwitchCountingMalloc.NumAllocations;
+
+		// whenever the new weapon wants the AnimInstance class the mesh already runs, the instance must survive the switch
+		const AShooterWeapon* Weapon = Character->GetCurrentWeapon();
+
+		if (Weapon->GetFirstPersonAnimInstanceClass().Get() == FirstPersonClass)
+		{
+			TestTrue(FString::Printf(TEXT("First person AnimInstance reused on switch %d"), Switch), FirstPersonMesh->GetAnimInstance() == FirstPersonInstance);
+			++NumReuseChecks;
+		}
+
+		if (Weapon->GetThirdPersonAnimInstanceClass().Get() == ThirdPersonClass)
+		{
+			TestTrue(FString::Printf(TEXT("Third person AnimInstance reused on switch %d"), Switch), ThirdPersonMesh->GetAnimInstance() == ThirdPersonInstance);
+			++NumReuseChecks;
+		}
+	}
+
+	GSwitchCountingMalloc.Uninstall();
+
+	TestTrue(TEXT("At least one switch kept the AnimInstance class"), NumReuseChecks > 0);
+
+	AddInfo(FString::Printf(TEXT("Weapon switch: %.2f us/switch, %.2f allocs/switch over %d switches"),
+		SwitchSeconds * 1.0e6 / NumSwitches, static_cast<double>(SwitchAllocations) / NumSwitches, NumSwitches));
+
+	return true;
+}
+
+#endif
@@ -56,6 +56,7 @@ UExplosiveDamageType::UExplosiveDamageType()
 UJoyDamageType::UJoyDamageType()
 {
 	// Joy damage has uplifting effect with moderate impulse
+	Emotion = EEmotionType::Joy;
 	bScaleMomentumByMass = true;
 	DamageImpulse = 400.0f;
 	DestructibleImpulse = 400.0f;
@@ -66,6 +67,7 @@ UJoyDamageType::UJoyDamageType()
 UTrustDamageType::UTrustDamageType()
 {
 	// Trust damage has calming effect with low impulse
+	Emotion = EEmotionType::Trust;
 	bScaleMomentumByMass = true;
 	DamageImpulse = 150.0f;
 	DestructibleImpulse = 150.0f;
@@ -76,6 +78,7 @@ UTrustDamageType::UTrustDamageType()
 UTerrorDamageType::UTerrorDamageType()
 {
 	// Terror damage has frightening effect with high impulse
+	Emotion = EEmotionType::Terror;
 	bScaleMomentumByMass = false;
 	DamageImpulse = 1000.0f;
 	DestructibleImpulse = 1000.0f;
@@ -86,6 +89,7 @@ UTerrorDamageType::UTerrorDamageType()
 UAmazingDamageType::UAmazingDamageType()
 {
 	// Amazing damage has stunning effect with moderate impulse
+	Emotion = EEmotionType::Amazing;
 	bScaleMomentumByMass = true;
 	DamageImpulse = 600.0f;
 	DestructibleImpulse = 600.0f;
@@ -96,6 +100,7 @@ UAmazingDamageType::UAmazingDamageType()
 USadnessDamageType::USadnessDamageType()
 {
 	// Sadness damage has depressing effect with low impulse
+	Emotion = EEmotionType::Sadness;
 	bScaleMomentumByMass = true;
 	DamageImpulse = 100.0f;
 	DestructibleImpulse = 100.0f;
@@ -106,6 +111,7 @@ USadnessDamageType::USadnessDamageType()
 ULoathingDamageType::ULoathingDamageType()
 {
 	// Loathing damage has disgusting effect with moderate impulse
+	Emotion = EEmotionType::Loathing;
 	bScaleMomentumByMass = true;
 	DamageImpulse = 500.0f;
 	DestructibleImpulse = 500.0f;
@@ -116,6 +122,7 @@ ULoathingDamageType::ULoathingDamageType()
 URageDamageType::URageDamageType()
 {
 	// Rage damage has violent effect with very high impulse
+	Emotion = EEmotionType::Rage;
 	bScaleMomentumByMass = false;
 	DamageImpulse = 1300.0f;
 	DestructibleImpulse = 1300.0f;
@@ -126,6 +133,7 @@ URageDamageType::URageDamageType()
 UExpectDamageType::UExpectDamageType()
 {
 	// Expect damage has anticipatory effect with variable impulse
+	Emotion = EEmotionType::Expect;
 	bScaleMomentumByMass = true;
 	DamageImpulse = 300.0f;
 	DestructibleImpulse = 300.0f;
@@ -6,6 +6,42 @@
 #include "GameFramework/DamageType.h"
 #include "CustomDamageTypes.generated.h"
 
+/**
+ * Emotions that can be triggered by emotional damage types
+ */
+UENUM(BlueprintType)
+enum class EEmotionType : uint8
+{
+	Joy,
+	Trust,
+	Terror,
+	Amazing,
+	Sadness,
+	Loathing,
+	Rage,
+	Expect,
+	MAX UMETA(Hidden)
+};
+
+/** Number of emotions tracked by emotion reactors */
+constexpr int32 EmotionTypeCount = static_cast<int32>(EEmotionType::MAX);
+
+/**
+ * Base damage type for emotional damage
+ * Lets emotion reactors read the emotion from the damage type defaults instead of checking each class
+ */
+UCLASS(Abstract, BlueprintType)
+class FIRSTPERSONCITY_API UEmotionDamageType : public UDamageType
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Emotion triggered by this damage type */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Emotion")
+	EEmotionType Emotion = EEmotionType::Joy;
+};
+
 /**
  * Fire damage type for projectiles that deal fire damage
  */
@@ -70,7 +106,7 @@ public:
  * Joy damage type for projectiles that deal joy-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API UJoyDamageType : public UDamageType
+class FIRSTPERSONCITY_API UJoyDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -82,7 +118,7 @@ public:
  * Trust damage type for projectiles that deal trust-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API UTrustDamageType : public UDamageType
+class FIRSTPERSONCITY_API UTrustDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -94,7 +130,7 @@ public:
  * Terror damage type for projectiles that deal terror-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API UTerrorDamageType : public UDamageType
+class FIRSTPERSONCITY_API UTerrorDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -106,7 +142,7 @@ public:
  * Amazing damage type for projectiles that deal amazement-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API UAmazingDamageType : public UDamageType
+class FIRSTPERSONCITY_API UAmazingDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -118,7 +154,7 @@ public:
  * Sadness damage type for projectiles that deal sadness-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API USadnessDamageType : public UDamageType
+class FIRSTPERSONCITY_API USadnessDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -130,7 +166,7 @@ public:
  * Loathing damage type for projectiles that deal loathing-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API ULoathingDamageType : public UDamageType
+class FIRSTPERSONCITY_API ULoathingDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -142,7 +178,7 @@ public:
  * Rage damage type for projectiles that deal rage-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API URageDamageType : public UDamageType
+class FIRSTPERSONCITY_API URageDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
@@ -154,7 +190,7 @@ public:
  * Expect damage type for projectiles that deal expectation-based emotional damage
  */
 UCLASS(BlueprintType)
-class FIRSTPERSONCITY_API UExpectDamageType : public UDamageType
+class FIRSTPERSONCITY_API UExpectDamageType : public UEmotionDamageType
 {
 	GENERATED_BODY()
 
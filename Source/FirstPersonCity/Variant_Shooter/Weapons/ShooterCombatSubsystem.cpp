@@ -0,0 +1,160 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterCombatSubsystem.h"
+#include "ShooterDamageable.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/Controller.h"
+#include "Kismet/GameplayStatics.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+#include "ShooterAllocationTracker.h"
+#include "ShooterFrameBudget.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combat Resolution"), STAT_ShooterCombatResolve, STATGROUP_FirstPersonCity);
+DECLARE_CYCLE_STAT(TEXT("Combat Damage Compute"), STAT_ShooterCombatCompute, STATGROUP_FirstPersonCity);
+DECLARE_CYCLE_STAT(TEXT("Combat Commit"), STAT_ShooterCombatCommit, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Hits Resolved"), STAT_ShooterCombatHits, STATGROUP_FirstPersonCity);
+
+bool UShooterCombatSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterCombatSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// resolve the configured damage type classes once
+	for (const TPair<TSoftClassPtr<UDamageType>, float>& TypeScale : DamageTypeScales)
+	{
+		if (UClass* DamageTypeClass = TypeScale.Key.LoadSynchronous())
+		{
+			ResolvedTypeScales.Add(DamageTypeClass, TypeScale.Value);
+		}
+	}
+}
+
+bool UShooterCombatSubsystem::IsTickable() const
+{
+	return HitEvents.Num() > 0;
+}
+
+void UShooterCombatSubsystem::Tick(float DeltaTime)
+{
+	ResolveHits();
+}
+
+TStatId UShooterCombatSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterCombatSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterCombatSubsystem::QueueHit(AActor* Target, AController* InstigatorController, AActor* DamageCauser, const TSubclassOf<UDamageType>& DamageType, float BaseDamage, float Distance, float Radius)
+{
+	check(Target);
+
+	FShooterHitEvent& Event = HitEvents.AddDefaulted_GetRef();
+	Event.Target = Target;
+	Event.InstigatorController = InstigatorController;
+	Event.DamageCauser = DamageCauser;
+	Event.DamageType = DamageType;
+	Event.BaseDamage = BaseDamage;
+	Event.Distance = Distance;
+	Event.Radius = Radius;
+
+	// copy everything the damage math needs while we're still on the game thread
+	if (const IShooterDamageable* Damageable = Cast<IShooterDamageable>(Target))
+	{
+		Event.Resistance = FMath::Clamp(Damageable->GetDamageResistance(DamageType), 0.0f, 1.0f);
+	}
+
+	if (const UDamageType* DamageTypeCDO = DamageType ? DamageType->GetDefaultObject<UDamageType>() : nullptr)
+	{
+		Event.FalloffExponent = DamageTypeCDO->DamageFalloff;
+	}
+
+	if (const float* TypeScale = ResolvedTypeScales.Find(DamageType))
+	{
+		Event.TypeScale = *TypeScale;
+	}
+}
+
+void UShooterCombatSubsystem::ResolveHits()
+{
+	SHOOTER_ALLOC_SCOPE(Damage);
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
+	if (HitEvents.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ShooterCombatResolve);
+
+	SET_DWORD_STAT(STAT_ShooterCombatHits, HitEvents.Num());
+
+	// phase one: compute the final damage of every hit
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterCombatCompute);
+
+		const float MinExplosionScale = MinExplosionDamageScale;
+		const EParallelForFlags Flags = HitEvents.Num() < MinHitsForParallel ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None;
+
+		ParallelFor(TEXT("ShooterCombatDamage"), HitEvents.Num(), 16, [this, MinExplosionScale](int32 EventIndex)
+		{
+			FShooterHitEvent& Event = HitEvents[EventIndex];
+			Event.FinalDamage = ComputeDamage(Event, MinExplosionScale);
+		}, Flags);
+	}
+
+	// phase two: apply the damage in the order the hits happened. Deaths and scores happen inside TakeDamage.
+	// swap the events out first, since damage handlers may queue more hits
+	TArray<FShooterHitEvent> CommitEvents = MoveTemp(HitEvents);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterCombatCommit);
+
+		for (const FShooterHitEvent& Event : CommitEvents)
+		{
+			AActor* Target = Event.Target.Get();
+
+			// the target may have been destroyed by an earlier hit
+			if (!Target || Event.FinalDamage <= 0.0f)
+			{
+				continue;
+			}
+
+			UGameplayStatics::ApplyDamage(Target, Event.FinalDamage, Event.InstigatorController.Get(), Event.DamageCauser.Get(), Event.DamageType);
+
+			UE_LOG(LogFirstPersonCity, Verbose, TEXT("Combat: %s took %.1f damage (base %.1f)"), *Target->GetName(), Event.FinalDamage, Event.BaseDamage);
+		}
+	}
+
+	// keep the allocation for next frame if nothing was queued meanwhile
+	if (HitEvents.Num() == 0)
+	{
+		HitEvents = MoveTemp(CommitEvents);
+		HitEvents.Reset();
+	}
+}
+
+float UShooterCombatSubsystem::ComputeDamage(const FShooterHitEvent& Event, float MinExplosionScale)
+{
+	float Damage = Event.BaseDamage;
+
+	// explosions fall off towards their edge, shaped by the damage type's falloff exponent
+	if (Event.Radius > 0.0f)
+	{
+		const float Alpha = FMath::Clamp(1.0f - Event.Distance / Event.Radius, 0.0f, 1.0f);
+		const float Scale = FMath::Lerp(MinExplosionScale, 1.0f, FMath::Pow(Alpha, FMath::Max(Event.FalloffExponent, 0.0f)));
+
+		Damage *= Scale;
+	}
+
+	// damage type modifier and the target's resistance
+	Damage *= Event.TypeScale * (1.0f - Event.Resistance);
+
+	return FMath::Max(Damage, 0.0f);
+}
@@ -0,0 +1,102 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterCombatSubsystem.generated.h"
+
+class AController;
+class UDamageType;
+
+/**
+ *  A single hit waiting to be resolved
+ *  Everything the damage math needs is copied in when the hit is queued, so it can be computed off the game thread
+ */
+struct FShooterHitEvent
+{
+	/** Actor being damaged */
+	TWeakObjectPtr<AActor> Target;
+
+	/** Controller responsible for the damage */
+	TWeakObjectPtr<AController> InstigatorController;
+
+	/** Actor that caused the damage, usually a projectile */
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	/** Damage type to apply */
+	TSubclassOf<UDamageType> DamageType;
+
+	/** Damage before falloff and modifiers */
+	float BaseDamage = 0.0f;
+
+	/** Distance from the explosion center. Unused for direct hits */
+	float Distance = 0.0f;
+
+	/** Explosion radius, or zero for direct hits */
+	float Radius = 0.0f;
+
+	/** Target's resistance to the damage type, from 0 to 1 */
+	float Resistance = 0.0f;
+
+	/** Damage type falloff exponent */
+	float FalloffExponent = 1.0f;
+
+	/** Damage type modifier */
+	float TypeScale = 1.0f;
+
+	/** Final damage, written by the compute phase */
+	float FinalDamage = 0.0f;
+};
+
+/**
+ *  Two phase combat resolution for the shooter variant
+ *  Hits are gathered during the frame, their final damage is computed in parallel over a flat array,
+ *  then HP changes, deaths and scores are committed on the game thread in the order the hits happened
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterCombatSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Damage scale at the edge of an explosion. At 1, explosions deal full damage everywhere in their radius */
+	UPROPERTY(Config)
+	float MinExplosionDamageScale = 1.0f;
+
+	/** Damage multiplier per damage type */
+	UPROPERTY(Config)
+	TMap<TSoftClassPtr<UDamageType>, float> DamageTypeScales;
+
+	/** Below this many hits in a frame, damage is computed on the game thread */
+	UPROPERTY(Config)
+	int32 MinHitsForParallel = 64;
+
+	/** Hits gathered this frame, in the order they happened */
+	TArray<FShooterHitEvent> HitEvents;
+
+	/** Damage type scales, resolved from the config on first use */
+	TMap<TSubclassOf<UDamageType>, float> ResolvedTypeScales;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Queues a hit to be resolved at the end of the frame. A zero radius is a direct hit */
+	void QueueHit(AActor* Target, AController* InstigatorController, AActor* DamageCauser, const TSubclassOf<UDamageType>& DamageType, float BaseDamage, float Distance = 0.0f, float Radius = 0.0f);
+
+	/** Resolves every queued hit right away */
+	void ResolveHits();
+
+protected:
+
+	/** Computes the final damage of a hit. Must not touch UObjects, it runs on worker threads */
+	static float ComputeDamage(const FShooterHitEvent& Event, float MinExplosionScale);
+};
@@ -0,0 +1,6 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterDamageable.h"
+
+// Add default functionality here for any IShooterDamageable functions that are not pure virtual.
@@ -0,0 +1,30 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "ShooterDamageable.generated.h"
+
+class UDamageType;
+
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class UShooterDamageable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ *  Common interface for Shooter Game actors that resist some types of damage
+ */
+class FIRSTPERSONCITY_API IShooterDamageable
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Returns the fraction of damage of the given type this actor ignores, from 0 to 1 */
+	virtual float GetDamageResistance(const TSubclassOf<UDamageType>& DamageType) const = 0;
+};
@@ -0,0 +1,260 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterImpulseSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+#include "FirstPersonCity.h"
+#include "ShooterFrameBudget.h"
+
+DECLARE_CYCLE_STAT(TEXT("Apply Accumulated Impulses"), STAT_ShooterApplyImpulses, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impulses Queued"), STAT_ShooterImpulsesQueued, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bodies Impulsed"), STAT_ShooterBodiesImpulsed, STATGROUP_FirstPersonCity);
+
+static TAutoConsoleVariable<bool> CVarShooterAccumulateImpulses(
+	TEXT("Shooter.Impulse.Accumulate"),
+	true,
+	TEXT("If true, projectile and explosion impulses are summed per body and applied once before physics steps. If false, each impulse is applied immediately."),
+	ECVF_Default);
+
+void FShooterImpulseAccumulator::AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName)
+{
+	check(Component);
+
+	FPendingImpulse* Entry = Pending.FindByPredicate([Component, BoneName](const FPendingImpulse& Candidate)
+	{
+		return Candidate.Component.Get() == Component && Candidate.BoneName == BoneName;
+	});
+
+	if (!Entry)
+	{
+		Entry = &Pending.AddDefaulted_GetRef();
+		Entry->Component = Component;
+		Entry->BoneName = BoneName;
+	}
+
+	// an off center impulse also spins the body around its center of mass
+	const FVector CenterOfMass = Component->GetCenterOfMass(BoneName);
+
+	Entry->LinearImpulse += Impulse;
+	Entry->AngularImpulse += (Location - CenterOfMass) ^ Impulse;
+
+	INC_DWORD_STAT(STAT_ShooterImpulsesQueued);
+}
+
+int32 FShooterImpulseAccumulator::Apply()
+{
+	int32 NumApplied = 0;
+
+	for (const FPendingImpulse& Entry : Pending)
+	{
+		UPrimitiveComponent* Component = Entry.Component.Get();
+
+		// the body may have been destroyed or stopped simulating since the impulse was queued
+		if (!Component || !Component->IsSimulatingPhysics(Entry.BoneName))
+		{
+			continue;
+		}
+
+		Component->AddImpulse(Entry.LinearImpulse, Entry.BoneName);
+		Component->AddAngularImpulseInRadians(Entry.AngularImpulse, Entry.BoneName);
+
+		++NumApplied;
+	}
+
+	Pending.Reset();
+
+	INC_DWORD_STAT_BY(STAT_ShooterBodiesImpulsed, NumApplied);
+
+	return NumApplied;
+}
+
+bool UShooterImpulseSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterImpulseSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (FPhysScene_Chaos* PhysScene = InWorld.GetPhysicsScene())
+	{
+		PhysScenePreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UShooterImpulseSubsystem::OnPhysScenePreTick);
+	}
+}
+
+void UShooterImpulseSubsystem::Deinitialize()
+{
+	if (FPhysScene_Chaos* PhysScene = GetWorld()->GetPhysicsScene())
+	{
+		PhysScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+void UShooterImpulseSubsystem::AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName)
+{
+	if (!CVarShooterAccumulateImpulses.GetValueOnGameThread())
+	{
+		Component->AddImpulseAtLocation(Impulse, Location, BoneName);
+		return;
+	}
+
+	Accumulator.AddImpulseAtLocation(Component, Impulse, Location, BoneName);
+}
+
+void UShooterImpulseSubsystem::OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaTime)
+{
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
+	// impulses queued after this point, like hits during the physics tick group, go out with the next step
+	if (Accumulator.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterApplyImpulses);
+
+		Accumulator.Apply();
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+
+bool FShooterImpulseVerification::Start(UWorld* World, int32 NumImpulses)
+{
+	UStaticMesh* CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+
+	if (!World || !CubeMesh)
+	{
+		return false;
+	}
+
+	// spawn two identical free floating cubes far from the play area
+	auto SpawnCube = [World, CubeMesh](const FVector& Location) -> UStaticMeshComponent*
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		AStaticMeshActor* Cube = World->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator, SpawnParams);
+
+		if (!Cube)
+		{
+			return nullptr;
+		}
+
+		UStaticMeshComponent* CubeComp = Cube->GetStaticMeshComponent();
+
+		CubeComp->SetMobility(EComponentMobility::Movable);
+		CubeComp->SetStaticMesh(CubeMesh);
+		CubeComp->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
+		CubeComp->SetEnableGravity(false);
+		CubeComp->SetSimulatePhysics(true);
+
+		return CubeComp;
+	};
+
+	const FVector TestOrigin(0.0f, 0.0f, 100000.0f);
+
+	UStaticMeshComponent* Direct = SpawnCube(TestOrigin);
+	UStaticMeshComponent* Accumulated = SpawnCube(TestOrigin + CubeOffset);
+
+	DirectCube = Direct;
+	AccumulatedCube = Accumulated;
+
+	if (!Direct || !Accumulated)
+	{
+		Finish();
+		return false;
+	}
+
+	// push both cubes with the same random impulses on their surfaces
+	FRandomStream Stream(4321);
+	FShooterImpulseAccumulator Accumulator;
+
+	for (int32 ImpulseIndex = 0; ImpulseIndex < NumImpulses; ++ImpulseIndex)
+	{
+		const FVector Impulse = Stream.VRand() * Stream.FRandRange(100.0f, 1000.0f);
+		const FVector LocalPoint = Stream.VRand() * 50.0f;
+
+		Direct->AddImpulseAtLocation(Impulse, TestOrigin + LocalPoint);
+		Accumulator.AddImpulseAtLocation(Accumulated, Impulse, TestOrigin + CubeOffset + LocalPoint);
+	}
+
+	Accumulator.Apply();
+
+	return true;
+}
+
+bool FShooterImpulseVerification::Compare(FResult& OutResult) const
+{
+	const UStaticMeshComponent* Direct = DirectCube.Get();
+	const UStaticMeshComponent* Accumulated = AccumulatedCube.Get();
+
+	if (!Direct || !Accumulated)
+	{
+		return false;
+	}
+
+	OutResult.LinearVelocityError = (Accumulated->GetPhysicsLinearVelocity() - Direct->GetPhysicsLinearVelocity()).Size();
+	OutResult.AngularVelocityError = (Accumulated->GetPhysicsAngularVelocityInDegrees() - Direct->GetPhysicsAngularVelocityInDegrees()).Size();
+	OutResult.LocationError = (Accumulated->GetComponentLocation() - CubeOffset - Direct->GetComponentLocation()).Size();
+	OutResult.RotationError = FMath::RadiansToDegrees(Accumulated->GetComponentQuat().AngularDistance(Direct->GetComponentQuat()));
+
+	return true;
+}
+
+void FShooterImpulseVerification::Finish()
+{
+	if (UStaticMeshComponent* Direct = DirectCube.Get())
+	{
+		Direct->GetOwner()->Destroy();
+	}
+
+	if (UStaticMeshComponent* Accumulated = AccumulatedCube.Get())
+	{
+		Accumulated->GetOwner()->Destroy();
+	}
+
+	DirectCube.Reset();
+	AccumulatedCube.Reset();
+}
+
+/** Runs FShooterImpulseVerification in the current world. The FirstPersonCity.Shooter.ImpulseAccumulator automation test runs the same check */
+static FAutoConsoleCommand ShooterImpulseVerifyCommand(
+	TEXT("Shooter.Impulse.Verify"),
+	TEXT("Compares the motion of a body pushed by separate impulses against one pushed by the same impulses accumulated. Usage: Shooter.Impulse.Verify [NumImpulses]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumImpulses = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 16;
+
+		TSharedRef<FShooterImpulseVerification> Verification = MakeShared<FShooterImpulseVerification>();
+
+		if (!Verification->Start(World, NumImpulses))
+		{
+			return;
+		}
+
+		// compare once physics has stepped a few times
+		FTimerHandle CompareTimer;
+		World->GetTimerManager().SetTimer(CompareTimer, FTimerDelegate::CreateLambda([Verification, NumImpulses]()
+		{
+			FShooterImpulseVerification::FResult Result;
+
+			if (Verification->Compare(Result))
+			{
+				UE_LOG(LogFirstPersonCity, Display, TEXT("Impulse accumulator verify %s: %d impulses, linear velocity error %.4f, angular velocity error %.4f deg/s, location error %.4f, rotation error %.4f deg"),
+					Result.IsWithinTolerance() ? TEXT("PASSED") : TEXT("FAILED"), NumImpulses, Result.LinearVelocityError, Result.AngularVelocityError, Result.LocationError, Result.RotationError);
+			}
+
+			Verification->Finish();
+
+		}), 0.25f, false);
+	}));
+
+#endif
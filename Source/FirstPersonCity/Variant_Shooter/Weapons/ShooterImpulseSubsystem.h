@@ -0,0 +1,125 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterImpulseSubsystem.generated.h"
+
+class UPrimitiveComponent;
+class UStaticMeshComponent;
+class FPhysScene_Chaos;
+
+/**
+ *  Sums impulses per physics body so each body is only touched once
+ *  An impulse at a location is stored as a linear impulse plus an angular impulse around the body's center of mass,
+ *  which moves the body exactly like applying every impulse at its location separately
+ */
+struct FIRSTPERSONCITY_API FShooterImpulseAccumulator
+{
+	/** Adds an impulse at a world location to a body */
+	void AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName = NAME_None);
+
+	/** Applies the summed impulses to their bodies and clears them. Returns the number of bodies impulsed */
+	int32 Apply();
+
+	/** Returns the number of bodies with pending impulses */
+	int32 Num() const { return Pending.Num(); }
+
+private:
+
+	/** Summed impulses for a single body */
+	struct FPendingImpulse
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FName BoneName;
+		FVector LinearImpulse = FVector::ZeroVector;
+		FVector AngularImpulse = FVector::ZeroVector;
+	};
+
+	/** Bodies with pending impulses. Only a handful are hit per frame, so a linear search beats a map */
+	TArray<FPendingImpulse, TInlineAllocator<16>> Pending;
+};
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ *  Checks that accumulated impulses move a body exactly like separate impulses
+ *  Two identical free floating cubes are pushed with the same random impulses, one directly and one through FShooterImpulseAccumulator,
+ *  and their motion is compared once physics has stepped. Shared by the Shooter.Impulse.Verify command and the automation test
+ */
+struct FIRSTPERSONCITY_API FShooterImpulseVerification
+{
+	/** Max error allowed on each compared quantity */
+	static constexpr float Tolerance = 0.1f;
+
+	/** Differences between the two cubes */
+	struct FResult
+	{
+		float LinearVelocityError = 0.0f;
+		float AngularVelocityError = 0.0f;
+		float LocationError = 0.0f;
+		float RotationError = 0.0f;
+
+		/** Returns true if every error is within tolerance */
+		bool IsWithinTolerance() const
+		{
+			return LinearVelocityError < Tolerance && AngularVelocityError < Tolerance && LocationError < Tolerance && RotationError < Tolerance;
+		}
+	};
+
+	/** Spawns the cubes and pushes them. Returns false if they couldn't be spawned */
+	bool Start(UWorld* World, int32 NumImpulses);
+
+	/** Compares the cubes' motion. Returns false if either cube is gone */
+	bool Compare(FResult& OutResult) const;
+
+	/** Destroys the cubes */
+	void Finish();
+
+private:
+
+	/** Cube pushed by each impulse separately */
+	TWeakObjectPtr<UStaticMeshComponent> DirectCube;
+
+	/** Cube pushed by the accumulated impulses */
+	TWeakObjectPtr<UStaticMeshComponent> AccumulatedCube;
+
+	/** Offset between the cubes */
+	FVector CubeOffset = FVector(1000.0f, 0.0f, 0.0f);
+};
+
+#endif
+
+/**
+ *  Collects projectile and explosion impulses during the frame and applies them once per body right before physics steps
+ */
+UCLASS()
+class FIRSTPERSONCITY_API UShooterImpulseSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Impulses waiting for the next physics step */
+	FShooterImpulseAccumulator Accumulator;
+
+	/** Physics scene pre tick delegate handle */
+	FDelegateHandle PhysScenePreTickHandle;
+
+public:
+
+	//~Begin UWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	//~End UWorldSubsystem interface
+
+	/** Queues an impulse at a world location, to be applied before the next physics step */
+	void AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName = NAME_None);
+
+protected:
+
+	/** Applies the queued impulses */
+	void OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaTime);
+};
@@ -7,12 +7,19 @@
 #include "Components/StaticMeshComponent.h"
 #include "ShooterWeaponHolder.h"
 #include "ShooterWeapon.h"
+#include "ShooterPickupSubsystem.h"
 #include "Engine/World.h"
-#include "TimerManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "ShooterAllocationTracker.h"
 
 AShooterPickup::AShooterPickup()
 {
- 	PrimaryActorTick.bCanEverTick = true;
+ 	PrimaryActorTick.bCanEverTick = false;
+
+	// replicate, but stay dormant until the pickup is picked up
+	bReplicates = true;
+	NetDormancy = DORM_Initial;
 
 	// create the root
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
@@ -21,15 +28,10 @@ AShooterPickup::AShooterPickup()
 	SphereCollision = CreateDefaultSubobject<USphereComponent>(TEXT("Sphere Collision"));
 	SphereCollision->SetupAttachment(RootComponent);
 
+	// the pickup subsystem handles reaching the pickup, so the sphere stays out of the physics scene
 	SphereCollision->SetRelativeLocation(FVector(0.0f, 0.0f, 84.0f));
-	SphereCollision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-	SphereCollision->SetCollisionObjectType(ECC_WorldStatic);
-	SphereCollision->SetCollisionResponseToAllChannels(ECR_Ignore);
-	SphereCollision->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
-	SphereCollision->bFillCollisionUnderneathForNavmesh = true;
-
-	// subscribe to the collision overlap on the sphere
-	SphereCollision->OnComponentBeginOverlap.AddDynamic(this, &AShooterPickup::OnOverlap);
+	SphereCollision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SphereCollision->SetGenerateOverlapEvents(false);
 
 	// create the mesh
 	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
@@ -58,6 +60,49 @@ void AShooterPickup::BeginPlay()
 		// copy the weapon class
 		WeaponClass = WeaponData->WeaponToSpawn;
 	}
+
+	// let the server's pickup subsystem find us
+	if (HasAuthority())
+	{
+		if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+		{
+			PickupSubsystem->RegisterPickup(this, SphereCollision->GetComponentLocation(), SphereCollision->GetScaledSphereRadius());
+		}
+	}
+}
+
+void AShooterPickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShooterPickup, PickupState);
+}
+
+void AShooterPickup::OnRep_PickupState()
+{
+	// clients joining late may receive a state whose respawn time has already passed
+	const bool bAvailable = PickupState.bAvailable || GetServerTime() >= PickupState.RespawnServerTime;
+
+	if (!bAvailable)
+	{
+		HidePickup();
+
+	} else if (IsHidden()) {
+
+		// catch up with a respawn we missed
+		if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+		{
+			Lifetime->Cancel(RespawnTimer);
+		}
+
+		RespawnPickup();
+	}
+}
+
+double AShooterPickup::GetServerTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
 }
 
 void AShooterPickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -65,32 +110,84 @@ void AShooterPickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	Super::EndPlay(EndPlayReason);
 
 	// clear the respawn timer
-	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Cancel(RespawnTimer);
+	}
+
+	if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterPickup(this, SphereCollision->GetComponentLocation());
+	}
 }
 
-void AShooterPickup::OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+bool AShooterPickup::TryPickUp(AActor* OtherActor)
 {
+	SHOOTER_ALLOC_SCOPE(Pickup);
+
+	// only the server grants pickups. Collision stays disabled until the respawn animation finishes
+	if (!HasAuthority() || !IsAvailable())
+	{
+		return false;
+	}
+
 	// have we collided against a weapon holder?
 	if (IShooterWeaponHolder* WeaponHolder = Cast<IShooterWeaponHolder>(OtherActor))
 	{
 		WeaponHolder->AddWeaponClass(WeaponClass);
 
-		// hide this mesh
-		SetActorHiddenInGame(true);
+		ConsumePickup();
 
-		// disable collision
-		SetActorEnableCollision(false);
+		return true;
+	}
+
+	return false;
+}
 
-		// disable ticking
-		SetActorTickEnabled(false);
+void AShooterPickup::ConsumePickup()
+{
+	// update the replicated state and wake the pickup up so clients receive it
+	PickupState.bAvailable = false;
+	PickupState.RespawnServerTime = GetServerTime() + RespawnTime;
+
+	FlushNetDormancy();
+
+	HidePickup();
+}
+
+void AShooterPickup::HidePickup()
+{
+	// hide this mesh
+	SetActorHiddenInGame(true);
 
-		// schedule the respawn
-		GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, RespawnTime, false);
+	// disable collision
+	SetActorEnableCollision(false);
+
+	// schedule the respawn. Clients work it out from the replicated respawn time
+	const float RespawnDelay = FMath::Max(static_cast<float>(PickupState.RespawnServerTime - GetServerTime()), 0.0f);
+
+	UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>();
+
+	if (RespawnDelay > 0.0f && Lifetime)
+	{
+		Lifetime->Schedule<AShooterPickup, &AShooterPickup::RespawnPickup>(RespawnTimer, this, RespawnDelay);
+
+	} else {
+
+		RespawnPickup();
 	}
 }
 
 void AShooterPickup::RespawnPickup()
 {
+	SHOOTER_ALLOC_SCOPE(Pickup);
+
+	// make the pickup available again. Clients know when this happens, so there's no need to wake the pickup up
+	if (HasAuthority())
+	{
+		PickupState.bAvailable = true;
+	}
+
 	// unhide this pickup
 	SetActorHiddenInGame(false);
 
@@ -103,6 +200,12 @@ void AShooterPickup::FinishRespawn()
 	// enable collision
 	SetActorEnableCollision(true);
 
-	// enable tick
-	SetActorTickEnabled(true);
+	// holders already standing here should collect the pickup right away
+	if (HasAuthority())
+	{
+		if (UShooterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UShooterPickupSubsystem>())
+		{
+			PickupSubsystem->NotifyPickupAvailable();
+		}
+	}
 }
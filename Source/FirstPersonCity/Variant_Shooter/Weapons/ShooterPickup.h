@@ -6,6 +6,7 @@
 #include "GameFramework/Actor.h"
 #include "Engine/DataTable.h"
 #include "Engine/StaticMesh.h"
+#include "ShooterLifetimeSubsystem.h"
 #include "ShooterPickup.generated.h"
 
 class USphereComponent;
@@ -29,15 +30,35 @@ struct FWeaponTableRow : public FTableRowBase
 	TSubclassOf<AShooterWeapon> WeaponToSpawn;
 };
 
+/**
+ *  Replicated availability of a weapon pickup
+ */
+USTRUCT()
+struct FShooterPickupState
+{
+	GENERATED_BODY()
+
+	/** If true, the pickup can be picked up */
+	UPROPERTY()
+	bool bAvailable = true;
+
+	/** Server world time the pickup respawns at after being picked up */
+	UPROPERTY()
+	float RespawnServerTime = 0.0f;
+};
+
 /**
  *  Simple shooter game weapon pickup
+ *  Pickups don't tick and stay dormant on the network. Only a pickup event wakes them up,
+ *  and clients schedule the respawn themselves from the replicated respawn time
+ *  The collision sphere only defines the pickup's reach. The server's pickup subsystem tests holders against it on a grid
  */
 UCLASS(abstract)
 class FIRSTPERSONCITY_API AShooterPickup : public AActor
 {
 	GENERATED_BODY()
 
-	/** Collision sphere */
+	/** Collision sphere. Has no collision of its own, its scaled radius is the pickup's reach */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	USphereComponent* SphereCollision;
 
@@ -59,13 +80,26 @@ protected:
 	float RespawnTime = 4.0f;
 
 	/** Timer to respawn the pickup */
-	FTimerHandle RespawnTimer;
+	FShooterLifetimeHandle RespawnTimer;
+
+	/** Availability state, replicated only when the pickup is picked up */
+	UPROPERTY(ReplicatedUsing=OnRep_PickupState)
+	FShooterPickupState PickupState;
 
 public:	
 	
 	/** Constructor */
 	AShooterPickup();
 
+	/** Grants the pickup to an actor that reached it, if it's a weapon holder and the pickup is available. Server only */
+	virtual bool TryPickUp(AActor* OtherActor);
+
+	/** Returns true if the pickup finished respawning and can be picked up */
+	bool IsAvailable() const { return PickupState.bAvailable && GetActorEnableCollision(); }
+
+	/** Takes the pickup through its respawn without granting a weapon. Server only */
+	void ForcePickUp() { ConsumePickup(); }
+
 protected:
 
 	/** Native construction script */
@@ -77,12 +111,24 @@ protected:
 	/** Gameplay cleanup */
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	/** Handles collision overlap */
+	/** Sets up replicated properties */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Updates the pickup on clients when it's picked up */
 	UFUNCTION()
-	virtual void OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	void OnRep_PickupState();
 
 protected:
 
+	/** Returns the current server world time */
+	double GetServerTime() const;
+
+	/** Marks the pickup as taken, wakes it up so clients receive the new state and hides it until it respawns */
+	void ConsumePickup();
+
+	/** Hides the pickup and schedules its respawn at the state's respawn time */
+	void HidePickup();
+
 	/** Called when it's time to respawn this pickup */
 	void RespawnPickup();
 
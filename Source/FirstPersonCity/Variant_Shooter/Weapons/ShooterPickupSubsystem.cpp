@@ -0,0 +1,176 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterPickupSubsystem.h"
+#include "ShooterPickup.h"
+#include "GameFramework/Character.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "FirstPersonCity.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Collection"), STAT_ShooterPickupCollection, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Registered"), STAT_ShooterPickupsRegistered, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Collectors Checked"), STAT_ShooterPickupCollectorsChecked, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Distance Tests"), STAT_ShooterPickupDistanceTests, STATGROUP_FirstPersonCity);
+
+bool UShooterPickupSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UShooterPickupSubsystem::IsTickable() const
+{
+	return NumPickups > 0 && Collectors.Num() > 0;
+}
+
+void UShooterPickupSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterPickupCollection);
+
+	const bool bCheckAll = bForceCheck;
+	bForceCheck = false;
+
+	int32 NumChecked = 0;
+
+	for (int32 CollectorIndex = Collectors.Num() - 1; CollectorIndex >= 0; --CollectorIndex)
+	{
+		FShooterPickupCollector& Collector = Collectors[CollectorIndex];
+		ACharacter* Character = Collector.Character.Get();
+
+		if (!Character)
+		{
+			Collectors.RemoveAtSwap(CollectorIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		// holders standing still can't reach anything new
+		const FVector Location = Character->GetActorLocation();
+
+		if (!bCheckAll && FVector::DistSquared(Location, Collector.LastCheckedLocation) < FMath::Square(MinMoveDistance))
+		{
+			continue;
+		}
+
+		Collector.LastCheckedLocation = Location;
+
+		CheckCollector(Character);
+
+		++NumChecked;
+	}
+
+	SET_DWORD_STAT(STAT_ShooterPickupCollectorsChecked, NumChecked);
+}
+
+TStatId UShooterPickupSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterPickupSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterPickupSubsystem::RegisterPickup(AShooterPickup* Pickup, const FVector& Location, float Radius)
+{
+	check(Pickup);
+
+	FShooterPickupCellEntry& Entry = Cells.FindOrAdd(GetCell(Location)).AddDefaulted_GetRef();
+	Entry.Pickup = Pickup;
+	Entry.Location = Location;
+	Entry.Radius = Radius;
+
+	MaxPickupRadius = FMath::Max(MaxPickupRadius, Radius);
+	++NumPickups;
+
+	// holders may already be standing on it
+	bForceCheck = true;
+
+	SET_DWORD_STAT(STAT_ShooterPickupsRegistered, NumPickups);
+}
+
+void UShooterPickupSubsystem::UnregisterPickup(AShooterPickup* Pickup, const FVector& Location)
+{
+	const FIntPoint Cell = GetCell(Location);
+
+	if (TArray<FShooterPickupCellEntry>* CellPickups = Cells.Find(Cell))
+	{
+		NumPickups -= CellPickups->RemoveAllSwap([Pickup](const FShooterPickupCellEntry& Entry) { return Entry.Pickup.Get() == Pickup; }, EAllowShrinking::No);
+
+		if (CellPickups->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterPickupsRegistered, NumPickups);
+}
+
+void UShooterPickupSubsystem::RegisterCollector(ACharacter* Character)
+{
+	check(Character);
+
+	if (!Collectors.ContainsByPredicate([Character](const FShooterPickupCollector& Collector) { return Collector.Character.Get() == Character; }))
+	{
+		FShooterPickupCollector& Collector = Collectors.AddDefaulted_GetRef();
+		Collector.Character = Character;
+	}
+}
+
+void UShooterPickupSubsystem::UnregisterCollector(ACharacter* Character)
+{
+	Collectors.RemoveAllSwap([Character](const FShooterPickupCollector& Collector) { return Collector.Character.Get() == Character; }, EAllowShrinking::No);
+}
+
+FIntPoint UShooterPickupSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+void UShooterPickupSubsystem::CheckCollector(ACharacter* Character)
+{
+	// treat the holder as its capsule's core segment
+	const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	const float CapsuleRadius = Capsule->GetScaledCapsuleRadius();
+	const float CapsuleHalfHeight = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+
+	const FVector Center = Capsule->GetComponentLocation();
+	const FVector SegmentStart = Center - FVector(0.0f, 0.0f, CapsuleHalfHeight);
+	const FVector SegmentEnd = Center + FVector(0.0f, 0.0f, CapsuleHalfHeight);
+
+	// only visit the cells the holder could reach a pickup in
+	const float Reach = CapsuleRadius + MaxPickupRadius;
+	const FIntPoint MinCell = GetCell(Center - FVector(Reach, Reach, 0.0f));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Reach, Reach, 0.0f));
+
+	// gather first, since collecting a pickup may unregister it
+	TArray<AShooterPickup*, TInlineAllocator<4>> Touched;
+
+	for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+	{
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			const TArray<FShooterPickupCellEntry>* CellPickups = Cells.Find(FIntPoint(CellX, CellY));
+
+			if (!CellPickups)
+			{
+				continue;
+			}
+
+			for (const FShooterPickupCellEntry& Entry : *CellPickups)
+			{
+				INC_DWORD_STAT(STAT_ShooterPickupDistanceTests);
+
+				const float TouchDistance = CapsuleRadius + Entry.Radius;
+
+				if (FMath::PointDistToSegmentSquared(Entry.Location, SegmentStart, SegmentEnd) <= FMath::Square(TouchDistance))
+				{
+					if (AShooterPickup* Pickup = Entry.Pickup.Get())
+					{
+						Touched.Add(Pickup);
+					}
+				}
+			}
+		}
+	}
+
+	for (AShooterPickup* Pickup : Touched)
+	{
+		Pickup->TryPickUp(Character);
+	}
+}
@@ -0,0 +1,105 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterPickupSubsystem.generated.h"
+
+class AShooterPickup;
+class ACharacter;
+
+/**
+ *  A pickup stored in a grid cell
+ */
+struct FShooterPickupCellEntry
+{
+	/** Registered pickup */
+	TWeakObjectPtr<AShooterPickup> Pickup;
+
+	/** Center of the pickup's collection sphere */
+	FVector Location;
+
+	/** Radius of the pickup's collection sphere */
+	float Radius;
+};
+
+/**
+ *  A weapon holder pawn that can collect pickups
+ */
+struct FShooterPickupCollector
+{
+	/** Registered pawn */
+	TWeakObjectPtr<ACharacter> Character;
+
+	/** Location the pawn was last checked at */
+	FVector LastCheckedLocation = FVector(UE_BIG_NUMBER);
+};
+
+/**
+ *  Server side pickup collection for the shooter variant
+ *  Pickups are bucketed into a 2D grid once, and each frame only the cells around weapon holders that moved are checked,
+ *  so pickups cost nothing in the physics broadphase and nothing at all while no holder is near them
+ */
+UCLASS(Config=Game)
+class FIRSTPERSONCITY_API UShooterPickupSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Size of the grid cells. Should comfortably exceed pickup and pawn radii */
+	UPROPERTY(Config)
+	float CellSize = 1000.0f;
+
+	/** Distance a holder must move before its surroundings are checked again */
+	UPROPERTY(Config)
+	float MinMoveDistance = 2.0f;
+
+	/** Pickups in each occupied grid cell */
+	TMap<FIntPoint, TArray<FShooterPickupCellEntry>> Cells;
+
+	/** Registered weapon holders */
+	TArray<FShooterPickupCollector> Collectors;
+
+	/** Largest registered pickup radius, to size the cell search */
+	float MaxPickupRadius = 0.0f;
+
+	/** Number of registered pickups */
+	int32 NumPickups = 0;
+
+	/** If true, a pickup became available since the last check, so every holder is checked even if it didn't move */
+	bool bForceCheck = false;
+
+public:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Adds a pickup to the grid */
+	void RegisterPickup(AShooterPickup* Pickup, const FVector& Location, float Radius);
+
+	/** Removes a pickup from the grid */
+	void UnregisterPickup(AShooterPickup* Pickup, const FVector& Location);
+
+	/** Checks every holder next frame, so holders already standing on a pickup collect it when it becomes available */
+	void NotifyPickupAvailable() { bForceCheck = true; }
+
+	/** Starts letting a weapon holder collect pickups */
+	void RegisterCollector(ACharacter* Character);
+
+	/** Stops letting a weapon holder collect pickups */
+	void UnregisterCollector(ACharacter* Character);
+
+protected:
+
+	/** Returns the grid cell a location falls in */
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/** Checks the pickups around a holder and collects the ones it touches */
+	void CheckCollector(ACharacter* Character);
+};
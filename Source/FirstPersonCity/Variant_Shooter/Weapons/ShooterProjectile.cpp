@@ -10,9 +10,22 @@
 #include "GameFramework/Controller.h"
 #include "Engine/OverlapResult.h"
 #include "Engine/World.h"
-#include "TimerManager.h"
 #include "Engine/DataTable.h"
 #include "CustomDamageTypes.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "HAL/IConsoleManager.h"
+#include "ShooterLagCompensationSubsystem.h"
+#include "ShooterImpulseSubsystem.h"
+#include "ShooterCombatSubsystem.h"
+#include "ShooterAllocationTracker.h"
+#include "ShooterFrameBudget.h"
+
+static TAutoConsoleVariable<bool> CVarShooterProjectileReplicateMovement(
+	TEXT("Shooter.Projectile.ReplicateMovement"),
+	false,
+	TEXT("If true, projectiles replicate their movement every net update instead of a single spawn record. For bandwidth comparisons."),
+	ECVF_Default);
 
 AShooterProjectile::AShooterProjectile()
 {
@@ -35,10 +48,36 @@ AShooterProjectile::AShooterProjectile()
 
 	// set the default damage type
 	HitDamageType = UDamageType::StaticClass();
+
+	// replicate server projectiles to every client that didn't predict them
+	// clients simulate movement on their own from the spawn record
+	bReplicates = true;
+	SetReplicateMovement(false);
+}
+
+void AShooterProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AShooterProjectile, SpawnRecord, COND_InitialOnly);
+	DOREPLIFETIME(AShooterProjectile, Impact);
+}
+
+bool AShooterProjectile::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// the owning client is already simulating its own predicted copy
+	if (bPredictedByOwner && RealViewer && RealViewer == GetInstigatorController())
+	{
+		return false;
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
 }
 
 void AShooterProjectile::BeginPlay()
 {
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
 	Super::BeginPlay();
 	
 	// ignore the pawn that shot this projectile
@@ -49,6 +88,33 @@ void AShooterProjectile::BeginPlay()
 	{
 		InitializeWithDataTableRow(ProjectileDataHandle);
 	}
+
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		// simulate the server's projectile from its spawn record
+		ApplySpawnRecord();
+
+	} else if (GetNetMode() != NM_Client) {
+
+		// record the spawn state for clients
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+
+		SpawnRecord.DataRowName = ProjectileDataHandle.RowName;
+		SpawnRecord.Origin = GetActorLocation();
+		SpawnRecord.Velocity = ProjectileMovement->Velocity;
+		SpawnRecord.ServerSpawnTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
+		if (CVarShooterProjectileReplicateMovement.GetValueOnGameThread())
+		{
+			// naive mode, replicate movement every net update
+			SetReplicateMovement(true);
+
+		} else {
+
+			// nothing else to send until we hit something
+			SetNetDormancy(DORM_DormantAll);
+		}
+	}
 }
 
 void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -56,7 +122,10 @@ void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
 	Super::EndPlay(EndPlayReason);
 
 	// clear the destruction timer
-	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Cancel(DestructionTimer);
+	}
 }
 
 void AShooterProjectile::InitializeWithData(const FProjectileData& Data)
@@ -79,6 +148,65 @@ void AShooterProjectile::InitializeWithDataTableRow(const FDataTableRowHandle& R
 	}
 }
 
+void AShooterProjectile::OnRep_SpawnRecord()
+{
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
+	// configure the projectile from the same data row as the server's
+	if (!SpawnRecord.DataRowName.IsNone())
+	{
+		ProjectileDataHandle.RowName = SpawnRecord.DataRowName;
+	}
+
+	// the spawn record normally arrives before BeginPlay, which applies it
+	if (HasActorBegunPlay())
+	{
+		InitializeWithDataTableRow(ProjectileDataHandle);
+		ApplySpawnRecord();
+	}
+}
+
+void AShooterProjectile::ApplySpawnRecord()
+{
+	// start from the server's spawn state
+	SetActorLocation(SpawnRecord.Origin);
+	ProjectileMovement->Velocity = SpawnRecord.Velocity;
+
+	// catch up with the time the projectile spent in flight before we received it
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+
+	if (GameState)
+	{
+		const float FlightTime = FMath::Clamp(static_cast<float>(GameState->GetServerWorldTimeSeconds()) - SpawnRecord.ServerSpawnTime, 0.0f, MaxFastForwardTime);
+
+		if (FlightTime > 0.0f)
+		{
+			ProjectileMovement->TickComponent(FlightTime, LEVELTICK_All, nullptr);
+		}
+	}
+}
+
+void AShooterProjectile::OnRep_Impact()
+{
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
+	if (!Impact.bHasHit)
+	{
+		return;
+	}
+
+	// stop colliding if our own simulation hasn't hit anything yet
+	bHit = true;
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// play the hit effects where the server's projectile hit
+	FHitResult Hit;
+	Hit.Location = Hit.ImpactPoint = Impact.Location;
+	Hit.Normal = Hit.ImpactNormal = Impact.Normal;
+
+	BP_OnProjectileHit(Hit);
+}
+
 FProjectileData AShooterProjectile::GetProjectileData() const
 {
 	FProjectileData CurrentData;
@@ -140,8 +268,85 @@ void AShooterProjectile::ApplyProjectileData(const FProjectileData& Data)
 		Data.HitDamageType ? *Data.HitDamageType->GetName() : TEXT("None"));
 }
 
+void AShooterProjectile::CatchUpToServerTime(double ShotTime)
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+
+	if (!GameState)
+	{
+		return;
+	}
+
+	// clients fast forward from the time the shot was actually fired
+	SpawnRecord.ServerSpawnTime = ShotTime;
+
+	const float CatchUpTime = FMath::Clamp(static_cast<float>(GameState->GetServerWorldTimeSeconds() - ShotTime), 0.0f, MaxFastForwardTime);
+
+	if (CatchUpTime <= 0.0f)
+	{
+		return;
+	}
+
+	const FVector Start = GetActorLocation();
+	FVector End = Start + ProjectileMovement->Velocity * CatchUpTime;
+	const float Radius = CollisionComponent->GetScaledSphereRadius();
+
+	// sweep the distance covered in transit against the world first, so rewound targets behind walls can't be hit.
+	// Pawns are left to the rewind, since their current positions aren't where they were when the shot was fired
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterProjectileCatchUp), false, this);
+	QueryParams.AddIgnoredActor(GetInstigator());
+
+	FCollisionResponseParams ResponseParams(CollisionComponent->GetCollisionResponseToChannels());
+	ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+
+	FHitResult WorldHit;
+	const bool bWorldHit = GetWorld()->SweepSingleByChannel(WorldHit, Start, End, FQuat::Identity, CollisionComponent->GetCollisionObjectType(), FCollisionShape::MakeSphere(Radius), QueryParams, ResponseParams);
+
+	if (bWorldHit)
+	{
+		End = WorldHit.Location;
+	}
+
+	// test the unobstructed part of the path against where targets were when the shot was fired
+	if (const UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>())
+	{
+		FHitResult RewoundHit;
+
+		if (LagCompensation->RewindSegmentTest(ShotTime, Start, End, Radius, GetInstigator(), RewoundHit))
+		{
+			// stop at the rewound hit and process it as a regular impact
+			SetActorLocation(RewoundHit.Location);
+			ProjectileMovement->StopMovementImmediately();
+
+			HandleImpact(RewoundHit.GetActor(), RewoundHit.GetComponent(), RewoundHit);
+			return;
+		}
+	}
+
+	// the shot reached the world before any target, so impact there
+	if (bWorldHit)
+	{
+		SetActorLocation(WorldHit.Location);
+		ProjectileMovement->StopMovementImmediately();
+
+		HandleImpact(WorldHit.GetActor(), WorldHit.GetComponent(), WorldHit);
+		return;
+	}
+
+	// nothing was hit in the past, so move the projectile to where it should be now
+	ProjectileMovement->TickComponent(CatchUpTime, LEVELTICK_All, nullptr);
+}
+
 void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
 {
+	HandleImpact(Other, OtherComp, Hit);
+}
+
+void AShooterProjectile::HandleImpact(AActor* Other, UPrimitiveComponent* OtherComp, const FHitResult& Hit)
+{
+	SHOOTER_ALLOC_SCOPE(ProjectileHit);
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
 	// ignore if we've already hit something else
 	if (bHit)
 	{
@@ -153,6 +358,22 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 	// disable collision on the projectile
 	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
+	// simulated copies wait for the server's impact to play hit effects
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	// replicate the impact to clients
+	if (GetNetMode() != NM_Client)
+	{
+		Impact.bHasHit = true;
+		Impact.Location = Hit.ImpactPoint;
+		Impact.Normal = Hit.ImpactNormal;
+
+		FlushNetDormancy();
+	}
+
 	// make AI perception noise
 	MakeNoise(NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
 
@@ -172,10 +393,16 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 	// pass control to BP for any extra effects
 	BP_OnProjectileHit(Hit);
 
+	// networked projectiles need to live long enough for the impact to replicate
+	const bool bNetworked = GetNetMode() == NM_DedicatedServer || GetNetMode() == NM_ListenServer;
+	const float DestructionTime = bNetworked ? FMath::Max(DeferredDestructionTime, MinNetDestructionTime) : DeferredDestructionTime;
+
 	// check if we should schedule deferred destruction of the projectile
-	if (DeferredDestructionTime > 0.0f)
+	UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>();
+
+	if (DestructionTime > 0.0f && Lifetime)
 	{
-		GetWorld()->GetTimerManager().SetTimer(DestructionTimer, this, &AShooterProjectile::OnDeferredDestruction, DeferredDestructionTime, false);
+		Lifetime->Schedule<AShooterProjectile, &AShooterProjectile::OnDeferredDestruction>(DestructionTimer, this, DestructionTime);
 
 	} else {
 
@@ -221,30 +448,43 @@ void AShooterProjectile::ExplosionCheck(const FVector& ExplosionCenter)
 			const FVector& ExplosionDir = CurrentOverlap.GetActor()->GetActorLocation() - GetActorLocation();
 
 			// push and/or damage the overlapped actor
-			ProcessHit(CurrentOverlap.GetActor(), CurrentOverlap.GetComponent(), GetActorLocation(), ExplosionDir.GetSafeNormal());
+			ProcessHit(CurrentOverlap.GetActor(), CurrentOverlap.GetComponent(), GetActorLocation(), ExplosionDir.GetSafeNormal(), ExplosionDir.Size());
 		}
 			
 	}
 }
 
-void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection)
+void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection, float ExplosionDistance)
 {
-	// Check if we should damage this actor
-	if (HitActor && (HitActor != GetOwner() || bDamageOwner))
+	// Check if we should damage this actor. Only the server applies damage
+	if (HitActor && (HitActor != GetOwner() || bDamageOwner) && GetNetMode() != NM_Client)
 	{
-		// Apply damage to the hit actor with the configured damage type
+		AController* InstigatorController = GetInstigator() ? GetInstigator()->GetController() : nullptr;
+
+		// Queue the hit so its damage is resolved with the rest of the frame's hits
 		// This works for any AActor, including ACharacter, AEmotionReactActor, etc.
-		UGameplayStatics::ApplyDamage(HitActor, HitDamage, GetInstigator()->GetController(), this, HitDamageType);
-		
-		// Log damage application for debugging
-		UE_LOG(LogTemp, Log, TEXT("Projectile dealt %.1f damage to %s"), HitDamage, *HitActor->GetName());
+		if (UShooterCombatSubsystem* Combat = GetWorld()->GetSubsystem<UShooterCombatSubsystem>())
+		{
+			Combat->QueueHit(HitActor, InstigatorController, this, HitDamageType, HitDamage, ExplosionDistance, bExplodeOnHit ? ExplosionRadius : 0.0f);
+
+		} else {
+
+			UGameplayStatics::ApplyDamage(HitActor, HitDamage, InstigatorController, this, HitDamageType);
+		}
 	}
 
 	// Apply physics impulse to physics objects
 	if (HitComp && HitComp->IsSimulatingPhysics())
 	{
-		// Give some physics impulse to the object
-		HitComp->AddImpulseAtLocation(HitDirection * PhysicsForce, HitLocation);
+		// Give some physics impulse to the object. Impulses are summed per body and applied before the next physics step
+		if (UShooterImpulseSubsystem* ImpulseSubsystem = GetWorld()->GetSubsystem<UShooterImpulseSubsystem>())
+		{
+			ImpulseSubsystem->AddImpulseAtLocation(HitComp, HitDirection * PhysicsForce, HitLocation);
+
+		} else {
+
+			HitComp->AddImpulseAtLocation(HitDirection * PhysicsForce, HitLocation);
+		}
 		
 		UE_LOG(LogTemp, Verbose, TEXT("Applied physics impulse to %s"), HitComp ? *HitComp->GetName() : TEXT("Unknown"));
 	}
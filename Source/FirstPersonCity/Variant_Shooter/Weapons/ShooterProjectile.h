@@ -6,6 +6,8 @@
 #include "GameFramework/Actor.h"
 #include "Engine/DataTable.h"
 #include "ProjectileData.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterLifetimeSubsystem.h"
 #include "ShooterProjectile.generated.h"
 
 class USphereComponent;
@@ -13,9 +15,57 @@ class UProjectileMovementComponent;
 class ACharacter;
 class UPrimitiveComponent;
 
+/**
+ *  Quantized record of a projectile's spawn, replicated once so clients can simulate its flight themselves
+ */
+USTRUCT()
+struct FShooterProjectileSpawnRecord
+{
+	GENERATED_BODY()
+
+	/** Projectile data row the projectile was configured with */
+	UPROPERTY()
+	FName DataRowName;
+
+	/** Spawn location */
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	/** Initial velocity */
+	UPROPERTY()
+	FVector_NetQuantize10 Velocity;
+
+	/** Server world time the projectile was spawned at */
+	UPROPERTY()
+	float ServerSpawnTime = 0.0f;
+};
+
+/**
+ *  Quantized record of a projectile's impact, replicated so clients play hit effects where the server's projectile hit
+ */
+USTRUCT()
+struct FShooterProjectileImpact
+{
+	GENERATED_BODY()
+
+	/** If true, the projectile has hit something */
+	UPROPERTY()
+	bool bHasHit = false;
+
+	/** Impact location */
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	/** Impact surface normal */
+	UPROPERTY()
+	FVector_NetQuantizeNormal Normal;
+};
+
 /**
  *  Simple projectile class for a first person shooter game
  *  Now supports data-driven configuration through Data Tables
+ *  Only the server's copy applies damage. Copies predicted by the owning client are purely cosmetic
+ *  Movement isn't replicated. Clients simulate the flight from the spawn record, and the projectile goes dormant until it hits something
  */
 UCLASS(abstract)
 class FIRSTPERSONCITY_API AShooterProjectile : public AActor
@@ -79,8 +129,27 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Projectile|Destruction", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
 	float DeferredDestructionTime = 5.0f;
 
-	/** Timer to handle deferred destruction of this projectile */
-	FTimerHandle DestructionTimer;
+	/** Deferred destruction of this projectile */
+	FShooterLifetimeHandle DestructionTimer;
+
+	/** If true, the owning client predicted this projectile and already has its own copy */
+	bool bPredictedByOwner = false;
+
+	/** Spawn state, replicated once when the projectile becomes relevant */
+	UPROPERTY(ReplicatedUsing=OnRep_SpawnRecord)
+	FShooterProjectileSpawnRecord SpawnRecord;
+
+	/** Impact state, replicated when the server's projectile hits something */
+	UPROPERTY(ReplicatedUsing=OnRep_Impact)
+	FShooterProjectileImpact Impact;
+
+	/** Minimum time a networked projectile stays alive after a hit, so its impact reaches clients */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Projectile|Destruction", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float MinNetDestructionTime = 0.2f;
+
+	/** Max time clients fast forward a late projectile's flight. Also caps how far the server catches up client shots */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Projectile|Network", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float MaxFastForwardTime = 0.25f;
 
 public:	
 
@@ -99,6 +168,31 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Projectile")
 	FProjectileData GetProjectileData() const;
 
+	/** Flags this projectile as already predicted by the owning client, so it's not replicated back to it */
+	void SetPredictedByOwner(bool bPredicted) { bPredictedByOwner = bPredicted; }
+
+	/** Returns true if the owning client predicted this projectile */
+	bool IsPredictedByOwner() const { return bPredictedByOwner; }
+
+	/** Catches up a server projectile fired by a client at the given server time. Hits along the way are tested against rewound hitboxes */
+	void CatchUpToServerTime(double ShotTime);
+
+	/** Skips the owning client's connection for predicted projectiles. Used when replicating without the replication graph */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Returns the max distance for actors to be affected by explosion damage */
+	float GetExplosionRadius() const { return ExplosionRadius; }
+
+#if !UE_BUILD_SHIPPING
+
+	/** Overrides the damage applied on hit. Lets benchmarks run explosions without changing the world */
+	void SetHitDamageForTesting(float InHitDamage) { HitDamage = InHitDamage; }
+
+	/** Runs the explosion overlap and damage pass at the given location without a hit */
+	void ExplosionCheckForTesting(const FVector& ExplosionCenter) { ExplosionCheck(ExplosionCenter); }
+
+#endif
+
 protected:
 	
 	/** Gameplay initialization */
@@ -107,16 +201,33 @@ protected:
 	/** Gameplay cleanup */
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
+	/** Sets up replicated properties */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Sets up the client simulation once the spawn record arrives */
+	UFUNCTION()
+	void OnRep_SpawnRecord();
+
+	/** Plays the server's impact on clients */
+	UFUNCTION()
+	void OnRep_Impact();
+
+	/** Places a client simulated projectile at its spawn record and fast forwards it to the current server time */
+	void ApplySpawnRecord();
+
 	/** Handles collision */
 	virtual void NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 
+	/** Handles the projectile hitting an actor, either from collision or from a rewound hit */
+	void HandleImpact(AActor* Other, UPrimitiveComponent* OtherComp, const FHitResult& Hit);
+
 protected:
 
 	/** Looks up actors within the explosion radius and damages them */
 	void ExplosionCheck(const FVector& ExplosionCenter);
 
-	/** Processes a projectile hit for the given actor */
-	void ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection);
+	/** Processes a projectile hit for the given actor. Explosions pass the actor's distance from the explosion center for damage falloff */
+	void ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection, float ExplosionDistance = 0.0f);
 
 	/** Passes control to Blueprint to implement any effects on hit. */
 	UFUNCTION(BlueprintImplementableEvent, Category="Projectile", meta = (DisplayName = "On Projectile Hit"))
@@ -0,0 +1,144 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterSpreadPattern.h"
+#include "Math/VectorRegister.h"
+
+namespace ShooterSpread
+{
+	/** Number of padded lanes needed for the given number of pellets */
+	static int32 GetNumLanes(int32 Num)
+	{
+		return Align(Num, 4);
+	}
+
+	/** Turns uniform random pairs into uniformly distributed points in the unit disk, four at a time */
+	static void RandomToDisk(float* InOutX, float* InOutY, int32 Num)
+	{
+		const VectorRegister4Float TwoPi = VectorSetFloat1(UE_TWO_PI);
+
+		for (int32 Lane = 0; Lane < Num; Lane += 4)
+		{
+			// radius from the square root of the first value, angle from the second
+			const VectorRegister4Float Radius = VectorSqrt(VectorLoadAligned(InOutX + Lane));
+			const VectorRegister4Float Angle = VectorMultiply(VectorLoadAligned(InOutY + Lane), TwoPi);
+
+			VectorRegister4Float Sin, Cos;
+			VectorSinCos(&Sin, &Cos, &Angle);
+
+			VectorStoreAligned(VectorMultiply(Radius, Cos), InOutX + Lane);
+			VectorStoreAligned(VectorMultiply(Radius, Sin), InOutY + Lane);
+		}
+	}
+}
+
+void ShooterSpread::BuildConeRotations(const FQuat& AimRotation, float ConeTangent, const float* OffsetsX, const float* OffsetsY, int32 Num, FQuat* OutRotations)
+{
+	// aim rotation, broadcast to every lane
+	const VectorRegister4Float AimX = VectorSetFloat1(static_cast<float>(AimRotation.X));
+	const VectorRegister4Float AimY = VectorSetFloat1(static_cast<float>(AimRotation.Y));
+	const VectorRegister4Float AimZ = VectorSetFloat1(static_cast<float>(AimRotation.Z));
+	const VectorRegister4Float AimW = VectorSetFloat1(static_cast<float>(AimRotation.W));
+
+	const VectorRegister4Float Tangent = VectorSetFloat1(ConeTangent);
+
+	alignas(16) float OutX[4], OutY[4], OutZ[4], OutW[4];
+
+	for (int32 Lane = 0; Lane < Num; Lane += 4)
+	{
+		// local pellet direction before normalizing is (1, A, B): forward plus the offset on the cone's end cap
+		const VectorRegister4Float A = VectorMultiply(VectorLoadAligned(OffsetsX + Lane), Tangent);
+		const VectorRegister4Float B = VectorMultiply(VectorLoadAligned(OffsetsY + Lane), Tangent);
+
+		const VectorRegister4Float InvLength = VectorReciprocalSqrtAccurate(VectorMultiplyAdd(A, A, VectorMultiplyAdd(B, B, GlobalVectorConstants::FloatOne)));
+
+		// shortest arc from forward to the pellet direction: axis (0, -B, A) / Length, angle term 1 + 1 / Length
+		const VectorRegister4Float LocalY = VectorNegate(VectorMultiply(B, InvLength));
+		const VectorRegister4Float LocalZ = VectorMultiply(A, InvLength);
+		const VectorRegister4Float LocalW = VectorAdd(GlobalVectorConstants::FloatOne, InvLength);
+
+		const VectorRegister4Float InvNorm = VectorReciprocalSqrtAccurate(VectorMultiplyAdd(LocalY, LocalY, VectorMultiplyAdd(LocalZ, LocalZ, VectorMultiply(LocalW, LocalW))));
+
+		const VectorRegister4Float QY = VectorMultiply(LocalY, InvNorm);
+		const VectorRegister4Float QZ = VectorMultiply(LocalZ, InvNorm);
+		const VectorRegister4Float QW = VectorMultiply(LocalW, InvNorm);
+
+		// compose with the aim rotation: Aim * Local, where Local has no X component
+		const VectorRegister4Float RX = VectorSubtract(VectorMultiplyAdd(AimX, QW, VectorMultiply(AimY, QZ)), VectorMultiply(AimZ, QY));
+		const VectorRegister4Float RY = VectorSubtract(VectorMultiplyAdd(AimW, QY, VectorMultiply(AimY, QW)), VectorMultiply(AimX, QZ));
+		const VectorRegister4Float RZ = VectorMultiplyAdd(AimW, QZ, VectorMultiplyAdd(AimX, QY, VectorMultiply(AimZ, QW)));
+		const VectorRegister4Float RW = VectorSubtract(VectorMultiply(AimW, QW), VectorMultiplyAdd(AimY, QY, VectorMultiply(AimZ, QZ)));
+
+		VectorStoreAligned(RX, OutX);
+		VectorStoreAligned(RY, OutY);
+		VectorStoreAligned(RZ, OutZ);
+		VectorStoreAligned(RW, OutW);
+
+		const int32 LaneCount = FMath::Min(4, Num - Lane);
+
+		for (int32 Sub = 0; Sub < LaneCount; ++Sub)
+		{
+			OutRotations[Lane + Sub] = FQuat(OutX[Sub], OutY[Sub], OutZ[Sub], OutW[Sub]);
+		}
+	}
+}
+
+FVector ShooterSpread::RandomDirectionInCone(const FVector& Direction, float HalfAngleDegrees)
+{
+	alignas(16) float OffsetX[4] = { FMath::FRand(), 0.0f, 0.0f, 0.0f };
+	alignas(16) float OffsetY[4] = { FMath::FRand(), 0.0f, 0.0f, 0.0f };
+
+	RandomToDisk(OffsetX, OffsetY, 1);
+
+	// the cone is built from its tangent, which blows up at 90 degrees
+	const float ConeTangent = FMath::Tan(FMath::DegreesToRadians(FMath::Clamp(HalfAngleDegrees, 0.0f, MaxConeHalfAngle)));
+
+	FQuat Rotation;
+	BuildConeRotations(Direction.ToOrientationQuat(), ConeTangent, OffsetX, OffsetY, 1, &Rotation);
+
+	return Rotation.GetForwardVector();
+}
+
+void FShooterSpreadPattern::GenerateSpawnTransforms(const FVector& Origin, const FQuat& AimRotation, uint16 Seed, TArrayView<FTransform> OutTransforms) const
+{
+	const int32 Num = GetNumPellets();
+	check(OutTransforms.Num() >= Num);
+
+	// offsets in the unit disk, padded to whole vector lanes
+	alignas(16) float OffsetsX[MaxPellets];
+	alignas(16) float OffsetsY[MaxPellets];
+
+	const int32 NumLanes = ShooterSpread::GetNumLanes(Num);
+
+	if (Mode == EShooterSpreadMode::Fixed && FixedOffsets.Num() > 0)
+	{
+		for (int32 Pellet = 0; Pellet < NumLanes; ++Pellet)
+		{
+			const FVector2f& Offset = FixedOffsets[Pellet % FixedOffsets.Num()];
+			OffsetsX[Pellet] = Offset.X;
+			OffsetsY[Pellet] = Offset.Y;
+		}
+
+	} else {
+
+		// seeded, so the server can rebuild a client's pellets from the shot record
+		FRandomStream Stream(Seed);
+
+		for (int32 Pellet = 0; Pellet < NumLanes; ++Pellet)
+		{
+			OffsetsX[Pellet] = Stream.GetFraction();
+			OffsetsY[Pellet] = Stream.GetFraction();
+		}
+
+		ShooterSpread::RandomToDisk(OffsetsX, OffsetsY, NumLanes);
+	}
+
+	// build every pellet rotation in one batch
+	FQuat Rotations[MaxPellets];
+	ShooterSpread::BuildConeRotations(AimRotation, FMath::Tan(FMath::DegreesToRadians(ConeHalfAngle)), OffsetsX, OffsetsY, Num, Rotations);
+
+	for (int32 Pellet = 0; Pellet < Num; ++Pellet)
+	{
+		OutTransforms[Pellet] = FTransform(Rotations[Pellet], Origin, FVector::OneVector);
+	}
+}
@@ -0,0 +1,70 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterSpreadPattern.generated.h"
+
+/**
+ *  How pellets are placed inside the spread cone
+ */
+UENUM(BlueprintType)
+enum class EShooterSpreadMode : uint8
+{
+	/** Pellets are scattered uniformly over the cone, reproducible from the shot seed */
+	Random,
+
+	/** Pellets follow the pattern's fixed offsets */
+	Fixed
+};
+
+/**
+ *  Multi pellet spread for a single shot
+ *  Pellet directions are generated four at a time with vector math straight into quaternions,
+ *  so a 32 pellet shot needs no rotator math and no allocations
+ */
+USTRUCT(BlueprintType)
+struct FIRSTPERSONCITY_API FShooterSpreadPattern
+{
+	GENERATED_BODY()
+
+	/** Max number of pellets in a single shot */
+	static constexpr int32 MaxPellets = 64;
+
+	/** Number of projectiles spawned per shot */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Spread", meta = (ClampMin = 1, ClampMax = 64))
+	int32 NumPellets = 1;
+
+	/** Half angle of the spread cone */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Spread", meta = (ClampMin = 0, ClampMax = 45, Units = "Degrees"))
+	float ConeHalfAngle = 0.0f;
+
+	/** How pellets are placed inside the cone */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Spread")
+	EShooterSpreadMode Mode = EShooterSpreadMode::Random;
+
+	/** Pellet offsets inside the unit disk, X right and Y up. Reused in order if there are fewer offsets than pellets */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Spread", meta = (EditCondition = "Mode == EShooterSpreadMode::Fixed"))
+	TArray<FVector2f> FixedOffsets;
+
+	/** Returns the number of pellets, clamped to the supported range */
+	int32 GetNumPellets() const { return FMath::Clamp(NumPellets, 1, MaxPellets); }
+
+	/** Writes one spawn transform per pellet, spread around the aim rotation. OutTransforms must hold GetNumPellets() entries */
+	void GenerateSpawnTransforms(const FVector& Origin, const FQuat& AimRotation, uint16 Seed, TArrayView<FTransform> OutTransforms) const;
+};
+
+namespace ShooterSpread
+{
+	/** Widest cone half angle the cone helpers accept, in degrees. Cones are built from the tangent of the half angle */
+	constexpr float MaxConeHalfAngle = 89.0f;
+
+	/**
+	 *  Batch kernel. Builds the rotations that aim down a cone of the given tangent, one per offset in the unit disk.
+	 *  Offsets are processed four at a time, so the input arrays must be padded to a multiple of four
+	 */
+	FIRSTPERSONCITY_API void BuildConeRotations(const FQuat& AimRotation, float ConeTangent, const float* OffsetsX, const float* OffsetsY, int32 Num, FQuat* OutRotations);
+
+	/** Returns a random direction inside a cone around the given direction. The half angle is clamped to MaxConeHalfAngle */
+	FIRSTPERSONCITY_API FVector RandomDirectionInCone(const FVector& Direction, float HalfAngleDegrees);
+}
@@ -2,20 +2,43 @@
 
 
 #include "ShooterWeapon.h"
-#include "Kismet/KismetMathLibrary.h"
 #include "Engine/World.h"
 #include "ShooterProjectile.h"
 #include "ShooterWeaponHolder.h"
 #include "Components/SceneComponent.h"
-#include "TimerManager.h"
 #include "Animation/AnimInstance.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/Pawn.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "FirstPersonCity.h"
+#include "ShooterAllocationTracker.h"
+#include "ShooterFrameBudget.h"
+#include "ShooterInputLatency.h"
+#include "ShooterLagCompensationSubsystem.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarShooterImmediateFire(
+	TEXT("Shooter.Weapon.ImmediateFire"),
+	false,
+	TEXT("If true, the local player's shots use the view from this frame's input for their aim and muzzle, instead of the one the camera and weapon meshes were last posed with."),
+	ECVF_Default);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Predicted Shots Sent"), STAT_ShooterPredictedShotsSent, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Client Shots Accepted"), STAT_ShooterClientShotsAccepted, STATGROUP_FirstPersonCity);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Client Shots Rejected"), STAT_ShooterClientShotsRejected, STATGROUP_FirstPersonCity);
 
 AShooterWeapon::AShooterWeapon()
 {
 	PrimaryActorTick.bCanEverTick = true;
 
+	// only tick to flush predicted shots, after input has been processed for the frame
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	// replicate the weapon so clients can see it and fire it
+	bReplicates = true;
+
 	// create the root
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
 
@@ -41,7 +64,10 @@ void AShooterWeapon::BeginPlay()
 	Super::BeginPlay();
 
 	// subscribe to the owner's destroyed delegate
-	GetOwner()->OnDestroyed.AddDynamic(this, &AShooterWeapon::OnOwnerDestroyed);
+	if (AActor* OwnerActor = GetOwner())
+	{
+		OwnerActor->OnDestroyed.AddDynamic(this, &AShooterWeapon::OnOwnerDestroyed);
+	}
 
 	// cast the weapon owner
 	WeaponOwner = Cast<IShooterWeaponHolder>(GetOwner());
@@ -50,8 +76,17 @@ void AShooterWeapon::BeginPlay()
 	// fill the first ammo clip
 	CurrentBullets = MagazineSize;
 
-	// attach the meshes to the owner
-	WeaponOwner->AttachWeaponMeshes(this);
+	if (WeaponOwner)
+	{
+		// attach the meshes to the owner
+		WeaponOwner->AttachWeaponMeshes(this);
+
+		// on clients, the weapon may have been activated by the server before it arrived
+		if (bIsActive && !HasAuthority())
+		{
+			WeaponOwner->OnWeaponActivated(this);
+		}
+	}
 }
 
 void AShooterWeapon::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -59,7 +94,60 @@ void AShooterWeapon::EndPlay(EEndPlayReason::Type EndPlayReason)
 	Super::EndPlay(EndPlayReason);
 
 	// clear the refire timer
-	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Cancel(RefireTimer);
+	}
+}
+
+void AShooterWeapon::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// send every shot predicted this frame in a single RPC
+	FlushPendingShots();
+}
+
+void AShooterWeapon::FlushPendingShots()
+{
+	if (PendingShots.Num() > 0)
+	{
+		INC_DWORD_STAT_BY(STAT_ShooterPredictedShotsSent, PendingShots.Num());
+
+		ServerFireShots(PendingShots);
+		PendingShots.Reset();
+	}
+
+	// nothing else to do until the next predicted shot
+	SetActorTickEnabled(false);
+}
+
+void AShooterWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShooterWeapon, bIsActive);
+}
+
+void AShooterWeapon::OnRep_IsActive()
+{
+	// the owner may not have been resolved yet. BeginPlay will catch up in that case
+	if (!WeaponOwner)
+	{
+		return;
+	}
+
+	if (bIsActive)
+	{
+		WeaponOwner->OnWeaponActivated(this);
+
+	} else {
+
+		// stop any locally predicted fire
+		StopFiring();
+
+		WeaponOwner->OnWeaponDeactivated(this);
+	}
 }
 
 void AShooterWeapon::OnOwnerDestroyed(AActor* DestroyedActor)
@@ -85,6 +173,9 @@ void AShooterWeapon::DeactivateWeapon()
 	// ensure we're no longer firing this weapon while deactivated
 	StopFiring();
 
+	// send any shots predicted this frame before the server hears about the deactivation
+	FlushPendingShots();
+
 	// set the weapon as inactive
 	bIsActive = false;
 
@@ -95,6 +186,15 @@ void AShooterWeapon::DeactivateWeapon()
 	WeaponOwner->OnWeaponDeactivated(this);
 }
 
+template<void (AShooterWeapon::*Callback)()>
+void AShooterWeapon::ScheduleRefire(float Delay)
+{
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Schedule<AShooterWeapon, Callback>(RefireTimer, this, Delay);
+	}
+}
+
 void AShooterWeapon::StartFiring()
 {
 	// check if the weapon is active before allowing firing
@@ -117,10 +217,10 @@ void AShooterWeapon::StartFiring()
 
 	} else {
 
-		// if we're full auto, schedule the next shot
+		// if we're full auto, schedule the next shot for when the refire time is up
 		if (bFullAuto)
 		{
-			GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::Fire, TimeSinceLastShot, false);
+			ScheduleRefire<&AShooterWeapon::Fire>(RefireRate - TimeSinceLastShot);
 		}
 
 	}
@@ -132,7 +232,10 @@ void AShooterWeapon::StopFiring()
 	bIsFiring = false;
 
 	// clear the refire timer
-	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
+	if (UShooterLifetimeSubsystem* Lifetime = GetWorld()->GetSubsystem<UShooterLifetimeSubsystem>())
+	{
+		Lifetime->Cancel(RefireTimer);
+	}
 }
 
 void AShooterWeapon::Fire()
@@ -149,18 +252,21 @@ void AShooterWeapon::Fire()
 	// update the time of our last shot
 	TimeOfLastShot = GetWorld()->GetTimeSeconds();
 
-	// make noise so the AI perception system can hear us
-	MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+	// make noise so the AI perception system can hear us. Predicted shots make noise on the server once validated
+	if (HasAuthority())
+	{
+		MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+	}
 
 	// are we full auto?
 	if (bFullAuto)
 	{
 		// schedule the next shot
-		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::Fire, RefireRate, false);
+		ScheduleRefire<&AShooterWeapon::Fire>(RefireRate);
 	} else {
 
 		// for semi-auto weapons, schedule the cooldown notification
-		GetWorld()->GetTimerManager().SetTimer(RefireTimer, this, &AShooterWeapon::FireCooldownExpired, RefireRate, false);
+		ScheduleRefire<&AShooterWeapon::FireCooldownExpired>(RefireRate);
 
 	}
 }
@@ -173,17 +279,27 @@ void AShooterWeapon::FireCooldownExpired()
 
 void AShooterWeapon::FireProjectile(const FVector& TargetLocation)
 {
+	SHOOTER_ALLOC_SCOPE(Fire);
+
+	// roll the seed for this shot's spread
+	const uint16 ShotSeed = static_cast<uint16>(FMath::Rand());
+
 	// get the projectile transform
-	FTransform ProjectileTransform = CalculateProjectileSpawnTransform(TargetLocation);
-	
-	// spawn the projectile
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
-	SpawnParams.Owner = GetOwner();
-	SpawnParams.Instigator = PawnOwner;
+	FTransform ProjectileTransform = CalculateProjectileSpawnTransform(TargetLocation, ShotSeed);
 
-	AShooterProjectile* Projectile = GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, ProjectileTransform, SpawnParams);
+	if (GetNetMode() == NM_Client)
+	{
+		// predict the shot locally so there's no round trip before we see it
+		SpawnShot(ProjectileTransform, ShotSeed, true);
+
+		// and send it to the server for validation
+		QueuePredictedShot(ProjectileTransform, ShotSeed);
+
+	} else {
+
+		// the server's shots are authoritative
+		SpawnShot(ProjectileTransform, ShotSeed, false);
+	}
 
 	// play the firing montage
 	WeaponOwner->PlayFiringMontage(FiringMontage);
@@ -192,6 +308,14 @@ void AShooterWeapon::FireProjectile(const FVector& TargetLocation)
 	WeaponOwner->AddWeaponRecoil(FiringRecoil);
 
 	// consume bullets
+	ConsumeBullet();
+
+	// update the weapon HUD
+	WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+}
+
+void AShooterWeapon::ConsumeBullet()
+{
 	--CurrentBullets;
 
 	// if the clip is depleted, reload it
@@ -199,26 +323,191 @@ void AShooterWeapon::FireProjectile(const FVector& TargetLocation)
 	{
 		CurrentBullets = MagazineSize;
 	}
+}
 
-	// update the weapon HUD
-	WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
+AShooterProjectile* AShooterWeapon::SpawnProjectile(const FTransform& SpawnTransform, bool bOwnerPredicted)
+{
+	// spawn the projectile
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
+	SpawnParams.Owner = GetOwner();
+	SpawnParams.Instigator = PawnOwner;
+
+	// the owning client already has its own copy of this projectile, so don't replicate it back
+	// flag it before it's added to the network so replication routing can see it
+	if (bOwnerPredicted && HasAuthority())
+	{
+		SpawnParams.CustomPreSpawnInitalization = [](AActor* SpawnedActor)
+		{
+			CastChecked<AShooterProjectile>(SpawnedActor)->SetPredictedByOwner(true);
+		};
+	}
+
+	return GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, SpawnTransform, SpawnParams);
+}
+
+void AShooterWeapon::SpawnShot(const FTransform& AimTransform, uint16 Seed, bool bOwnerPredicted, double ClientShotTime)
+{
+	SHOOTER_BUDGET_SCOPE(Projectile);
+
+	// spread the pellets around the aim direction. The buffer only grows the first time
+	PelletTransforms.SetNumUninitialized(SpreadPattern.GetNumPellets(), EAllowShrinking::No);
+	SpreadPattern.GenerateSpawnTransforms(AimTransform.GetLocation(), AimTransform.GetRotation(), Seed, PelletTransforms);
+
+	for (const FTransform& PelletTransform : PelletTransforms)
+	{
+		AShooterProjectile* Projectile = SpawnProjectile(PelletTransform, bOwnerPredicted);
+
+		if (Projectile && ClientShotTime >= 0.0)
+		{
+			Projectile->CatchUpToServerTime(ClientShotTime);
+		}
+	}
+
+#if SHOOTER_INPUT_LATENCY
+	// the local player's shot is on screen from here. Locally controlled NPCs on a listen server or in standalone don't count
+	if (PawnOwner && PawnOwner->IsLocallyControlled() && PawnOwner->IsPlayerControlled() && ClientShotTime < 0.0)
+	{
+		FShooterInputLatency::OnShotSpawned();
+	}
+#endif
+}
+
+void AShooterWeapon::QueuePredictedShot(const FTransform& SpawnTransform, uint16 Seed)
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
+	FShooterFireShot& Shot = PendingShots.AddDefaulted_GetRef();
+	Shot.TimestampMs = static_cast<uint32>(ServerTime * 1000.0);
+	Shot.Origin = SpawnTransform.GetLocation();
+	Shot.Direction = SpawnTransform.GetRotation().GetForwardVector();
+	Shot.Seed = Seed;
+
+	// flush the batch at the end of the frame
+	SetActorTickEnabled(true);
+}
+
+void AShooterWeapon::ServerFireShots_Implementation(const TArray<FShooterFireShot>& Shots)
+{
+	SHOOTER_ALLOC_SCOPE(Fire);
+
+	// ignore shots for weapons that can't fire
+	if (!bIsActive || !PawnOwner)
+	{
+		return;
+	}
+
+	// cap the work a single RPC can cause
+	const int32 NumShots = FMath::Min(Shots.Num(), MaxShotsPerBatch);
+
+	for (int32 ShotIndex = 0; ShotIndex < NumShots; ++ShotIndex)
+	{
+		const FShooterFireShot& Shot = Shots[ShotIndex];
+
+		if (!ValidateClientShot(Shot))
+		{
+			UE_LOG(LogFirstPersonCity, Verbose, TEXT("%s rejected a shot from %s"), *GetName(), *GetNameSafe(PawnOwner));
+			INC_DWORD_STAT(STAT_ShooterClientShotsRejected);
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_ShooterClientShotsAccepted);
+
+		// the server keeps its own magazine, so a client can't fire more rounds than the weapon holds
+		ConsumeBullet();
+
+		ServerTimeOfLastClientShot = Shot.TimestampMs / 1000.0;
+
+		// spawn the authoritative pellets and catch them up with the time the shot spent in transit
+		SpawnShot(FTransform(FVector(Shot.Direction).ToOrientationQuat(), Shot.Origin), Shot.Seed, true, ServerTimeOfLastClientShot);
+
+		// make noise so the AI perception system can hear the shot
+		MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+	}
+}
+
+bool AShooterWeapon::ValidateClientShot(const FShooterFireShot& Shot) const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	const double ShotTime = Shot.TimestampMs / 1000.0;
+
+	// the server must have a round to fire
+	if (CurrentBullets <= 0)
+	{
+		return false;
+	}
+
+	// reject shots from the future, allowing for some clock drift
+	if (ShotTime > ServerTime + 0.25)
+	{
+		return false;
+	}
+
+	// reject shots older than lag compensation can rewind to
+	const UShooterLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UShooterLagCompensationSubsystem>();
+	const double MaxShotAge = LagCompensation ? LagCompensation->GetMaxRewindTime() : 0.5;
+
+	if (ShotTime < ServerTime - MaxShotAge)
+	{
+		return false;
+	}
+
+	// reject shots faster than the refire rate, allowing for some jitter.
+	// The last shot counts as no older than the rewind window, so a backdated batch can't fit a burst into idle time
+	const double MinShotSpacing = RefireRate * 0.75;
+	const double LastShotTime = FMath::Max(ServerTimeOfLastClientShot, ServerTime - MaxShotAge - MinShotSpacing);
+
+	if (ShotTime < LastShotTime + MinShotSpacing)
+	{
+		return false;
+	}
+
+	// the shot must start close to where the owner is looking from
+	if (FVector::DistSquared(Shot.Origin, PawnOwner->GetPawnViewLocation()) > FMath::Square(MaxShotOriginError))
+	{
+		return false;
+	}
+
+	// and travel roughly where the owner is aiming
+	const FVector AimDirection = PawnOwner->GetBaseAimRotation().Vector();
+
+	return FVector::DotProduct(Shot.Direction, AimDirection) >= FMath::Cos(FMath::DegreesToRadians(MaxShotAimError));
 }
 
-FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation) const
+FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation, uint16 Seed) const
 {
 	// find the muzzle location
-	const FVector MuzzleLoc = FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+	FVector MuzzleLoc = FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+
+	// the muzzle socket was posed with last frame's view. Carry it over to the view the player has already turned to
+	FTransform PosedView, LatestView;
+
+	if (UsesLatestView() && WeaponOwner && WeaponOwner->GetViewCorrection(PosedView, LatestView))
+	{
+		MuzzleLoc = LatestView.TransformPosition(PosedView.InverseTransformPosition(MuzzleLoc));
+	}
 
 	// calculate the spawn location ahead of the muzzle
 	const FVector SpawnLoc = MuzzleLoc + ((TargetLocation - MuzzleLoc).GetSafeNormal() * MuzzleOffset);
 
-	// find the aim rotation vector while applying some variance to the target 
-	const FRotator AimRot = UKismetMathLibrary::FindLookAtRotation(SpawnLoc, TargetLocation + (UKismetMathLibrary::RandomUnitVector() * AimVariance));
+	// seed the spread so the shot can be reproduced from its compact record
+	const FRandomStream SpreadStream(Seed);
+
+	// find the aim rotation while applying some variance to the target. Pellets spread around it
+	const FQuat AimRot = (TargetLocation + (SpreadStream.VRand() * AimVariance) - SpawnLoc).ToOrientationQuat();
 
 	// return the built transform
 	return FTransform(AimRot, SpawnLoc, FVector::OneVector);
 }
 
+bool AShooterWeapon::UsesLatestView()
+{
+	return CVarShooterImmediateFire.GetValueOnGameThread();
+}
+
 const TSubclassOf<UAnimInstance>& AShooterWeapon::GetFirstPersonAnimInstanceClass() const
 {
 	return FirstPersonAnimInstanceClass;
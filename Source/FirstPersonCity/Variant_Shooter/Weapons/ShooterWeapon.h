@@ -6,6 +6,9 @@
 #include "GameFramework/Actor.h"
 #include "ShooterWeaponHolder.h"
 #include "Animation/AnimInstance.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterLifetimeSubsystem.h"
+#include "ShooterSpreadPattern.h"
 #include "ShooterWeapon.generated.h"
 
 class IShooterWeaponHolder;
@@ -14,11 +17,37 @@ class USkeletalMeshComponent;
 class UAnimMontage;
 class UAnimInstance;
 
+/**
+ *  Compact record of a single shot predicted by a client and sent to the server for validation
+ */
+USTRUCT()
+struct FShooterFireShot
+{
+	GENERATED_BODY()
+
+	/** Server world time the shot was fired at, in milliseconds */
+	UPROPERTY()
+	uint32 TimestampMs = 0;
+
+	/** Projectile spawn location */
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	/** Projectile direction */
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	/** Seed for the shot's random spread */
+	UPROPERTY()
+	uint16 Seed = 0;
+};
+
 /**
  *  Base class for a simple first person shooter weapon
  *  Provides both first person and third person perspective meshes
  *  Handles ammo and firing logic
  *  Interacts with the weapon owner through the ShooterWeaponHolder interface
+ *  Owning clients predict their shots locally and send them to the server in one batched RPC per frame
  */
 UCLASS(abstract)
 class FIRSTPERSONCITY_API AShooterWeapon : public AActor
@@ -61,10 +90,22 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Animation")
 	TSubclassOf<UAnimInstance> ThirdPersonAnimInstanceClass;
 
+	/** Optional anim layers to link on the first person character mesh when this weapon is active. Switching layers keeps the AnimInstance alive instead of re-creating it */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	TSubclassOf<UAnimInstance> FirstPersonAnimLayersClass;
+
+	/** Optional anim layers to link on the third person character mesh when this weapon is active. Switching layers keeps the AnimInstance alive instead of re-creating it */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	TSubclassOf<UAnimInstance> ThirdPersonAnimLayersClass;
+
 	/** Cone half-angle for variance while aiming */
 	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 90, Units = "Degrees"))
 	float AimVariance = 0.0f;
 
+	/** Pellets fired per shot and how they spread around the aim direction */
+	UPROPERTY(EditAnywhere, Category="Aim")
+	FShooterSpreadPattern SpreadPattern;
+
 	/** Amount of firing recoil to apply to the owner */
 	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 100))
 	float FiringRecoil = 0.0f;
@@ -92,10 +133,11 @@ protected:
 	bool bIsFiring = false;
 
 	/** If true, the weapon is active and can be fired */
+	UPROPERTY(ReplicatedUsing=OnRep_IsActive)
 	bool bIsActive = false;
 
 	/** Timer to handle full auto refiring */
-	FTimerHandle RefireTimer;
+	FShooterLifetimeHandle RefireTimer;
 
 	/** Cast pawn pointer to the owner for AI perception system interactions */
 	TObjectPtr<APawn> PawnOwner;
@@ -112,6 +154,27 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Perception")
 	FName ShotNoiseTag = FName("Shot");
 
+	/** Max distance between a client shot's origin and the owner's view location for the server to accept it */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm"))
+	float MaxShotOriginError = 150.0f;
+
+	/** Max angle between a client shot's direction and the owner's aim for the server to accept it */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0, ClampMax = 180, Units = "Degrees"))
+	float MaxShotAimError = 45.0f;
+
+	/** Max number of client shots the server will process from a single RPC */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 1, ClampMax = 64))
+	int32 MaxShotsPerBatch = 16;
+
+	/** Pellet spawn transforms for the current shot. Reused between shots */
+	TArray<FTransform> PelletTransforms;
+
+	/** Shots predicted this frame, waiting to be sent to the server */
+	TArray<FShooterFireShot> PendingShots;
+
+	/** Server world time of the last client shot accepted by the server */
+	double ServerTimeOfLastClientShot = -1.0;
+
 public:	
 
 	/** Constructor */
@@ -125,6 +188,16 @@ protected:
 	/** Gameplay Cleanup */
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
+	/** Sends the shots predicted this frame to the server */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Sets up replicated properties */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Updates the weapon on clients when it's activated or deactivated on the server */
+	UFUNCTION()
+	void OnRep_IsActive();
+
 protected:
 
 	/** Called when the weapon's owner is destroyed */
@@ -156,11 +229,34 @@ protected:
 	/** Called when the refire rate time has passed while shooting semi auto weapons */
 	void FireCooldownExpired();
 
+	/** Schedules a refire event on the lifetime subsystem, replacing any pending one */
+	template<void (AShooterWeapon::*Callback)()>
+	void ScheduleRefire(float Delay);
+
 	/** Fire a projectile towards the target location */
 	virtual void FireProjectile(const FVector& TargetLocation);
 
-	/** Calculates the spawn transform for projectiles shot by this weapon */
-	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation) const;
+	/** Uses up a bullet, refilling the magazine once it's empty */
+	void ConsumeBullet();
+
+	/** Spawns a projectile. If bOwnerPredicted is set, the owning client already has its own copy of the shot */
+	AShooterProjectile* SpawnProjectile(const FTransform& SpawnTransform, bool bOwnerPredicted);
+
+	/** Spawns every pellet of a shot spread around its aim transform. Shots fired by clients are caught up to the server time they were fired at */
+	void SpawnShot(const FTransform& AimTransform, uint16 Seed, bool bOwnerPredicted, double ClientShotTime = -1.0);
+
+	/** Queues a locally predicted shot to be sent to the server */
+	void QueuePredictedShot(const FTransform& SpawnTransform, uint16 Seed);
+
+	/** Sends all queued predicted shots to the server in a single RPC */
+	void FlushPendingShots();
+
+	/** Receives a batch of shots predicted by the owning client */
+	UFUNCTION(Server, Unreliable)
+	void ServerFireShots(const TArray<FShooterFireShot>& Shots);
+
+	/** Returns true if the server should accept a shot predicted by the owning client */
+	bool ValidateClientShot(const FShooterFireShot& Shot) const;
 
 public:
 
@@ -178,9 +274,24 @@ public:
 	/** Returns the third person anim instance class */
 	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimInstanceClass() const;
 
+	/** Returns the first person anim layers class */
+	const TSubclassOf<UAnimInstance>& GetFirstPersonAnimLayersClass() const { return FirstPersonAnimLayersClass; }
+
+	/** Returns the third person anim layers class */
+	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimLayersClass() const { return ThirdPersonAnimLayersClass; }
+
 	/** Returns the magazine size */
 	int32 GetMagazineSize() const { return MagazineSize; };
 
 	/** Returns the current bullet count */
 	int32 GetBulletCount() const { return CurrentBullets; }
+
+	/** Returns the type of projectiles this weapon shoots */
+	const TSubclassOf<AShooterProjectile>& GetProjectileClass() const { return ProjectileClass; }
+
+	/** Calculates the spawn transform for projectiles shot by this weapon, using the seed for aim variance */
+	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation, uint16 Seed) const;
+
+	/** Returns true if shots are aimed with the view from this frame's input instead of the last posed one */
+	static bool UsesLatestView();
 };
@@ -52,4 +52,7 @@ public:
 
 	/** Notifies the owner that the weapon cooldown has expired and it's ready to shoot again */
 	virtual void OnSemiWeaponRefire() = 0;
+
+	/** Returns the view transform the weapon meshes were last posed with and the latest one from this frame's input. Returns false if the owner has no fresher view */
+	virtual bool GetViewCorrection(FTransform& OutPosedView, FTransform& OutLatestView) const = 0;
 };